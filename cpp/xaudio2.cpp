@@ -1427,7 +1427,7 @@ public:
 	COM_METHOD(HRESULT) CommitChanges(UINT32 OperationSet)
 	{
 		TRACE_FUNC();
-		return FAudio_CommitChanges(faudio);
+		return FAudio_CommitChanges(faudio, OperationSet);
 	}
 
 	COM_METHOD(void) GetPerformanceData(XAUDIO2_PERFORMANCE_DATA *pPerfData)
@@ -222,6 +222,20 @@ public static class FAudio
 		public ulong SamplesPlayed;
 	}
 
+	[StructLayout(LayoutKind.Sequential, Pack = 1)]
+	public struct FAudioVoiceProfile
+	{
+		public ulong TicksPerSecond;
+		public ulong PassCount;
+		public ulong DecodeTicks;
+		public ulong ResampleTicks;
+		public ulong FilterTicks;
+		public ulong EffectChainTicks;
+		public ulong SendMixTicks;
+		public ulong LastPassTicks;
+		public ulong MaximumPassTicks;
+	}
+
 	[StructLayout(LayoutKind.Sequential, Pack = 1)]
 	public struct FAudioPerformanceData
 	{
@@ -284,6 +298,9 @@ public static class FAudio
 	public const byte FAUDIO_END_OF_STREAM =	0x40;
 	public const byte FAUDIO_SEND_USEFILTER =	0x80;
 
+	public const uint FAUDIO_PULL_MODE =		0x80000000;
+	public const uint FAUDIO_VOICE_SINC_SRC =	0x40000000;
+
 	public const FAudioFilterType FAUDIO_DEFAULT_FILTER_TYPE =	FAudioFilterType.FAudioLowPassFilter;
 	public const float FAUDIO_DEFAULT_FILTER_FREQUENCY =		FAUDIO_MAX_FILTER_FREQUENCY;
 	public const float FAUDIO_DEFAULT_FILTER_ONEOVERQ =		1.0f;
@@ -400,7 +417,8 @@ public static class FAudio
 
 	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
 	public static extern uint FAudio_CommitChanges(
-		IntPtr audio /* FAudio* */
+		IntPtr audio, /* FAudio* */
+		uint OperationSet
 	);
 
 	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
@@ -416,6 +434,61 @@ public static class FAudio
 		IntPtr pReserved /* void* */
 	);
 
+	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
+	public static extern uint FAudio_SetEngineThreadCount(
+		IntPtr audio, /* FAudio* */
+		uint ThreadCount
+	);
+
+	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
+	public static extern uint FAudio_SetDecodeCacheSize(
+		IntPtr audio, /* FAudio* */
+		uint CacheBytes
+	);
+
+	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
+	public static extern uint FAudio_SetVirtualVoiceThreshold(
+		IntPtr audio, /* FAudio* */
+		float Threshold
+	);
+
+	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
+	public static extern uint FAudio_SetLoadGovernor(
+		IntPtr audio, /* FAudio* */
+		float MaxLoad
+	);
+
+	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
+	public static extern uint FAudio_SetSourceVoicePoolSize(
+		IntPtr audio, /* FAudio* */
+		uint MaxVoices
+	);
+
+	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
+	public static extern uint FAudio_StartTrace(
+		IntPtr audio, /* FAudio* */
+		uint EventCount
+	);
+
+	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
+	public static extern void FAudio_StopTrace(
+		IntPtr audio /* FAudio* */
+	);
+
+	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
+	public static extern uint FAudio_GetTraceJSON(
+		IntPtr audio, /* FAudio* */
+		byte[] pBuffer,
+		uint BufferSize
+	);
+
+	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
+	public static extern uint FAudio_Render(
+		IntPtr audio, /* FAudio* */
+		float[] pOutput,
+		uint FrameCount
+	);
+
 	/* FAudioVoice Interface */
 
 	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
@@ -554,6 +627,14 @@ public static class FAudio
 		IntPtr voice /* FAudioVoice* */
 	);
 
+	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
+	public static extern uint FAudioVoice_GetProfile(
+		IntPtr voice, /* FAudioVoice* */
+		out FAudioVoiceProfile pProfile,
+		ulong[] pEffectTicks,
+		uint EffectCount
+	);
+
 	/* FAudioSourceVoice Interface */
 
 	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
@@ -618,6 +699,12 @@ public static class FAudio
 		uint NewSourceSampleRate
 	);
 
+	[DllImport(nativeLibName, CallingConvention = CallingConvention.Cdecl)]
+	public static extern uint FAudioSourceVoice_SetPriority(
+		IntPtr voice, /* FAudioSourceVoice* */
+		uint Priority
+	);
+
 	/* FAudioEngineCallback Interface */
 
 	[UnmanagedFunctionPointer(CallingConvention.Cdecl)]
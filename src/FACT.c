@@ -157,6 +157,9 @@ uint32_t FACTAudioEngine_Initialize(
 	if (pEngine->audio == NULL)
 	{
 		FAudioCreate(&pEngine->audio, 0, FAUDIO_DEFAULT_PROCESSOR);
+
+		/* Cues create and destroy a voice per wave, recycle them */
+		FAudio_SetSourceVoicePoolSize(pEngine->audio, 64);
 	}
 
 	/* Create the audio device */
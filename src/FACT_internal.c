@@ -1374,6 +1374,7 @@ int32_t FACT_INTERNAL_APIThread(void* enginePtr)
 
 threadstart:
 	FAudio_PlatformLockMutex(engine->apiLock);
+	TRACE_BEGIN(engine->audio, "FACT Update", engine);
 
 	/* We want the timestamp to be uniform across all Cues.
 	 * Oftentimes many Cues are played at once with the expectation
@@ -1422,6 +1423,7 @@ threadstart:
 		sbList = sbList->next;
 	}
 
+	TRACE_END(engine->audio, "FACT Update", engine);
 	FAudio_PlatformUnlockMutex(engine->apiLock);
 
 	if (engine->initialized)
@@ -1481,6 +1483,11 @@ void FACT_INTERNAL_OnBufferEnd(FAudioVoiceCallback *callback, void* pContext)
 	}
 
 	/* Read! */
+	TRACE_BEGIN(
+		c->wave->parentBank->parentEngine->audio,
+		"FACT Stream Read",
+		c->wave
+	);
 	FAudio_PlatformLockMutex(c->wave->parentBank->ioLock);
 	c->wave->parentBank->io->seek(
 		c->wave->parentBank->io->data,
@@ -1494,6 +1501,11 @@ void FACT_INTERNAL_OnBufferEnd(FAudioVoiceCallback *callback, void* pContext)
 		1
 	);
 	FAudio_PlatformUnlockMutex(c->wave->parentBank->ioLock);
+	TRACE_END(
+		c->wave->parentBank->parentEngine->audio,
+		"FACT Stream Read",
+		c->wave
+	);
 
 	/* Loop if applicable */
 	c->wave->streamOffset += buffer.AudioBytes;
@@ -40,13 +40,27 @@ uint32_t FAudioCreate(
 
 uint32_t FAudio_Construct(FAudio **ppFAudio, uint8_t version)
 {
-	FAudio_PlatformAddRef();
+	uint32_t i;
 	*ppFAudio = (FAudio*) FAudio_malloc(sizeof(FAudio));
 	FAudio_zero(*ppFAudio, sizeof(FAudio));
 	(*ppFAudio)->version = version;
+	(*ppFAudio)->scratchLock = FAudio_PlatformCreateMutex();
 	(*ppFAudio)->sourceLock = FAudio_PlatformCreateMutex();
+	(*ppFAudio)->sourceTableLock = FAudio_PlatformCreateMutex();
 	(*ppFAudio)->submixLock = FAudio_PlatformCreateMutex();
 	(*ppFAudio)->callbackLock = FAudio_PlatformCreateMutex();
+	(*ppFAudio)->commandLock = FAudio_PlatformCreateMutex();
+	(*ppFAudio)->stagingLock = FAudio_PlatformCreateMutex();
+	(*ppFAudio)->perfLock = FAudio_PlatformCreateMutex();
+	for (i = 0; i < DECODE_CACHE_SHARDS; i += 1)
+	{
+		(*ppFAudio)->decodeCache[i].lock = FAudio_PlatformCreateMutex();
+	}
+	(*ppFAudio)->decodeCacheLock = FAudio_PlatformCreateMutex();
+	(*ppFAudio)->voicePoolLock = FAudio_PlatformCreateMutex();
+	(*ppFAudio)->perfLastQuery = FAudio_timecounter();
+	(*ppFAudio)->virtualThreshold = -1.0f;
+	FAudio_INTERNAL_AllocCommands(*ppFAudio);
 	(*ppFAudio)->refcount = 1;
 	return 0;
 }
@@ -59,20 +73,46 @@ uint32_t FAudio_AddRef(FAudio *audio)
 
 uint32_t FAudio_Release(FAudio *audio)
 {
-	uint32_t refcount;
+	uint32_t i, refcount;
 	audio->refcount -= 1;
 	refcount = audio->refcount;
 	if (audio->refcount == 0)
 	{
 		FAudio_StopEngine(audio);
-		FAudio_free(audio->decodeCache);
-		FAudio_free(audio->resampleCache);
-		FAudio_free(audio->effectChainCache);
+		FAudio_INTERNAL_StopMixWorkers(audio);
+		FAudio_free(audio->submixPlan);
+		FAudio_free(audio->submixTasks);
+		FAudio_free(audio->submixStageTasks);
+		FAudio_free(audio->mixQueue);
+		HandleTable_Free(&audio->sources);
+		HandleTable_Free(&audio->submixes);
+		HandleTable_Free(&audio->callbacks);
+		FAudio_free(audio->scratch.arena);
+		FAudio_PlatformDestroyMutex(audio->scratchLock);
 		FAudio_PlatformDestroyMutex(audio->sourceLock);
+		FAudio_PlatformDestroyMutex(audio->sourceTableLock);
 		FAudio_PlatformDestroyMutex(audio->submixLock);
 		FAudio_PlatformDestroyMutex(audio->callbackLock);
+		FAudio_PlatformDestroyMutex(audio->commandLock);
+		FAudio_INTERNAL_FreeCommands(audio);
+		FAudio_PlatformDestroyMutex(audio->stagingLock);
+		FAudio_PlatformDestroyMutex(audio->perfLock);
+		FAudio_INTERNAL_SetDecodeCacheSize(audio, 0);
+		for (i = 0; i < DECODE_CACHE_SHARDS; i += 1)
+		{
+			FAudio_PlatformDestroyMutex(audio->decodeCache[i].lock);
+		}
+		FAudio_PlatformDestroyMutex(audio->decodeCacheLock);
+		FAudio_INTERNAL_SetSourceVoicePoolSize(audio, 0);
+		FAudio_PlatformDestroyMutex(audio->voicePoolLock);
+		FAudio_free(audio->traceRing);
+		if (audio->initialized)
+		{
+			FAudio_PlatformRelease(
+				!(audio->initFlags & FAUDIO_PULL_MODE)
+			);
+		}
 		FAudio_free(audio);
-		FAudio_PlatformRelease();
 	}
 	return refcount;
 }
@@ -97,14 +137,14 @@ uint32_t FAudio_Initialize(
 	uint32_t Flags,
 	FAudioProcessor XAudio2Processor
 ) {
-	FAudio_assert(Flags == 0);
+	FAudio_assert((Flags & ~FAUDIO_PULL_MODE) == 0);
 	FAudio_assert(XAudio2Processor == FAUDIO_DEFAULT_PROCESSOR);
+	FAudio_assert(!audio->initialized);
+	audio->initFlags = Flags;
 
-	/* FIXME: This is lazy... */
-	audio->decodeCache = (float*) FAudio_malloc(sizeof(float));
-	audio->resampleCache = (float*) FAudio_malloc(sizeof(float));
-	audio->decodeSamples = 1;
-	audio->resampleSamples = 1;
+	/* Pull mode has no device, so it does not need the audio subsystem */
+	FAudio_PlatformAddRef(!(Flags & FAUDIO_PULL_MODE));
+	audio->initialized = 1;
 
 	FAudio_StartEngine(audio);
 	return 0;
@@ -114,7 +154,7 @@ uint32_t FAudio_RegisterForCallbacks(
 	FAudio *audio,
 	FAudioEngineCallback *pCallback
 ) {
-	LinkedList_AddEntry(
+	HandleTable_AddEntry(
 		&audio->callbacks,
 		pCallback,
 		audio->callbackLock
@@ -126,7 +166,7 @@ void FAudio_UnregisterForCallbacks(
 	FAudio *audio,
 	FAudioEngineCallback *pCallback
 ) {
-	LinkedList_RemoveEntry(
+	HandleTable_RemoveValue(
 		&audio->callbacks,
 		pCallback,
 		audio->callbackLock
@@ -146,18 +186,32 @@ uint32_t FAudio_CreateSourceVoice(
 	uint32_t i;
 	uint16_t realFormat;
 
-	*ppSourceVoice = (FAudioSourceVoice*) FAudio_malloc(sizeof(FAudioVoice));
-	FAudio_zero(*ppSourceVoice, sizeof(FAudioSourceVoice));
+	/* Recycle a parked voice if one fits, see FAudio_SetSourceVoicePoolSize.
+	 * Its locks and buffers are kept, the rest was zeroed when it was parked.
+	 */
+	*ppSourceVoice = FAudio_INTERNAL_TakePooledVoice(
+		audio,
+		pSourceFormat,
+		Flags
+	);
+	if (*ppSourceVoice == NULL)
+	{
+		*ppSourceVoice = (FAudioSourceVoice*) FAudio_malloc(sizeof(FAudioVoice));
+		FAudio_zero(*ppSourceVoice, sizeof(FAudioSourceVoice));
+		(*ppSourceVoice)->filterLock = FAudio_PlatformCreateMutex();
+		(*ppSourceVoice)->volumeLock = FAudio_PlatformCreateMutex();
+		(*ppSourceVoice)->src.bufferQueue = (FAudioBuffer*) FAudio_malloc(
+			sizeof(FAudioBuffer) * FAUDIO_MAX_QUEUED_BUFFERS
+		);
+		(*ppSourceVoice)->src.bufferLock = FAudio_PlatformCreateMutex();
+	}
 	(*ppSourceVoice)->audio = audio;
 	(*ppSourceVoice)->type = FAUDIO_VOICE_SOURCE;
 	(*ppSourceVoice)->flags = Flags;
 	(*ppSourceVoice)->filter.Type = FAUDIO_DEFAULT_FILTER_TYPE;
 	(*ppSourceVoice)->filter.Frequency = FAUDIO_DEFAULT_FILTER_FREQUENCY;
 	(*ppSourceVoice)->filter.OneOverQ = FAUDIO_DEFAULT_FILTER_ONEOVERQ;
-	(*ppSourceVoice)->sendLock = FAudio_PlatformCreateMutex();
-	(*ppSourceVoice)->effectLock = FAudio_PlatformCreateMutex();
-	(*ppSourceVoice)->filterLock = FAudio_PlatformCreateMutex();
-	(*ppSourceVoice)->volumeLock = FAudio_PlatformCreateMutex();
+	(*ppSourceVoice)->mixFilter = (*ppSourceVoice)->filter;
 
 	/* Source Properties */
 	FAudio_assert(MaxFrequencyRatio <= FAUDIO_MAX_FREQ_RATIO);
@@ -170,9 +224,13 @@ uint32_t FAudio_CreateSourceVoice(
 	(*ppSourceVoice)->src.callback = pCallback;
 	(*ppSourceVoice)->src.active = 0;
 	(*ppSourceVoice)->src.freqRatio = 1.0f;
+	(*ppSourceVoice)->src.mixFreqRatio = 1.0f;
 	(*ppSourceVoice)->src.totalSamples = 0;
-	(*ppSourceVoice)->src.bufferList = NULL;
-	(*ppSourceVoice)->src.bufferLock = FAudio_PlatformCreateMutex();
+	(*ppSourceVoice)->src.bufferHead = 0;
+	(*ppSourceVoice)->src.bufferTail = 0;
+	(*ppSourceVoice)->src.bufferFlush = 0;
+	(*ppSourceVoice)->src.bufferExitLoop = 0;
+	(*ppSourceVoice)->src.bufferIdle = 1;
 		
 	if (pSourceFormat->wFormatTag >= 1 && pSourceFormat->wFormatTag <= 3)
 	{
@@ -239,6 +297,25 @@ uint32_t FAudio_CreateSourceVoice(
 		(*ppSourceVoice)->src.decode = (pSourceFormat->nChannels == 2) ?
 			FAudio_INTERNAL_DecodeStereoMSADPCM :
 			FAudio_INTERNAL_DecodeMonoMSADPCM;
+
+		/* Decoded blocks, kept across updates */
+		if ((*ppSourceVoice)->src.blockCache == NULL)
+		{
+			(*ppSourceVoice)->src.blockCache = (int16_t*) FAudio_malloc(
+				sizeof(int16_t) * (
+					(pSourceFormat->nBlockAlign / pSourceFormat->nChannels) - 6
+				) * 2 * MSADPCM_LANES
+			);
+		}
+
+		/* Shared cache slots have to fit a block and its encoded copy */
+		FAudio_INTERNAL_ReserveDecodeCache(
+			audio,
+			sizeof(int16_t) * (
+				(pSourceFormat->nBlockAlign / pSourceFormat->nChannels) - 6
+			) * 2 * pSourceFormat->nChannels +
+			pSourceFormat->nBlockAlign
+		);
 	}
 	else if (realFormat == 3)
 	{
@@ -246,29 +323,90 @@ uint32_t FAudio_CreateSourceVoice(
 	}
 	(*ppSourceVoice)->src.curBufferOffset = 0;
 
-	/* Sends/Effects */
+	/* Resampler, specialized for the common channel counts. Sinc voices
+	 * keep the linear one for when the load governor sheds them.
+	 */
+	if (pSourceFormat->nChannels == 1)
+	{
+		(*ppSourceVoice)->src.linearResample = FAudio_INTERNAL_Kernels.resampleMono;
+	}
+	else if (pSourceFormat->nChannels == 2)
+	{
+		(*ppSourceVoice)->src.linearResample = FAudio_INTERNAL_Kernels.resampleStereo;
+	}
+	else if (pSourceFormat->nChannels == 6)
+	{
+		(*ppSourceVoice)->src.linearResample = FAudio_INTERNAL_Kernels.resample6Channel;
+	}
+	else if (pSourceFormat->nChannels == 8)
+	{
+		(*ppSourceVoice)->src.linearResample = FAudio_INTERNAL_Kernels.resample8Channel;
+	}
+	else
+	{
+		(*ppSourceVoice)->src.linearResample = FAudio_INTERNAL_Kernels.resampleGeneric;
+	}
+	if (Flags & FAUDIO_VOICE_SINC_SRC)
+	{
+		(*ppSourceVoice)->src.resample = (pSourceFormat->nChannels == 1) ?
+			FAudio_INTERNAL_Kernels.resampleSincMono :
+			FAudio_INTERNAL_Kernels.resampleSincGeneric;
+		if ((*ppSourceVoice)->src.sincHistory == NULL)
+		{
+			(*ppSourceVoice)->src.sincHistory = (float*) FAudio_malloc(
+				sizeof(float) * SINC_HISTORY * pSourceFormat->nChannels
+			);
+		}
+		FAudio_zero(
+			(*ppSourceVoice)->src.sincHistory,
+			sizeof(float) * SINC_HISTORY * pSourceFormat->nChannels
+		);
+	}
+	else
+	{
+		(*ppSourceVoice)->src.resample = (*ppSourceVoice)->src.linearResample;
+	}
+
+	/* Effects */
 	FAudioVoice_SetEffectChain(*ppSourceVoice, pEffectChain);
-	FAudioVoice_SetOutputVoices(*ppSourceVoice, pSendList);
 
-	/* Default Levels */
+	/* Default Levels, needed by the send matrices */
 	(*ppSourceVoice)->volume = 1.0f;
-	(*ppSourceVoice)->channelVolume = (float*) FAudio_malloc(
-		sizeof(float) * (*ppSourceVoice)->outputChannels
-	);
+	(*ppSourceVoice)->mixVolume = 1.0f;
+	if (	(*ppSourceVoice)->channelVolume == NULL ||
+		(*ppSourceVoice)->outputChannels != pSourceFormat->nChannels	)
+	{
+		/* Pooled voices keep these when sized for nChannels */
+		(*ppSourceVoice)->channelVolume = (float*) FAudio_realloc(
+			(*ppSourceVoice)->channelVolume,
+			sizeof(float) * (*ppSourceVoice)->outputChannels
+		);
+		(*ppSourceVoice)->mixChannelVolume = (float*) FAudio_realloc(
+			(*ppSourceVoice)->mixChannelVolume,
+			sizeof(float) * (*ppSourceVoice)->outputChannels
+		);
+	}
 	for (i = 0; i < (*ppSourceVoice)->outputChannels; i += 1)
 	{
 		(*ppSourceVoice)->channelVolume[i] = 1.0f;
+		(*ppSourceVoice)->mixChannelVolume[i] = 1.0f;
 	}
 
+	/* Sends */
+	FAudioVoice_SetOutputVoices(*ppSourceVoice, pSendList);
+
 	/* Filters */
 	if (Flags & FAUDIO_VOICE_USEFILTER)
 	{
-		(*ppSourceVoice)->filterState = (FAudioFilterState*) FAudio_malloc(
-			sizeof(FAudioFilterState) * (*ppSourceVoice)->src.format.nChannels
-		);
+		if ((*ppSourceVoice)->filterState == NULL)
+		{
+			(*ppSourceVoice)->filterState = (float*) FAudio_malloc(
+				sizeof(float) * FILTER_STATE_SIZE((*ppSourceVoice)->src.format.nChannels)
+			);
+		}
 		FAudio_zero(
 			(*ppSourceVoice)->filterState,
-			sizeof(FAudioFilterState) * (*ppSourceVoice)->src.format.nChannels
+			sizeof(float) * FILTER_STATE_SIZE((*ppSourceVoice)->src.format.nChannels)
 		);
 	}
 
@@ -279,17 +417,18 @@ uint32_t FAudio_CreateSourceVoice(
 		(double) pSourceFormat->nSamplesPerSec /
 		(double) audio->master->master.inputSampleRate
 	) + EXTRA_DECODE_PADDING * 2;
-	FAudio_INTERNAL_ResizeDecodeCache(
+	FAudio_INTERNAL_ReserveMixScratch(
 		audio,
-		(*ppSourceVoice)->src.decodeSamples * pSourceFormat->nChannels
+		(
+			(*ppSourceVoice)->src.decodeSamples +
+			(((*ppSourceVoice)->src.sincHistory != NULL) ? SINC_HISTORY : 0)
+		) * pSourceFormat->nChannels,
+		0,
+		0
 	);
 
-	/* Add to list, finally. */
-	LinkedList_PrependEntry(
-		&audio->sources,
-		*ppSourceVoice,
-		audio->sourceLock
-	);
+	/* Add to table, finally. */
+	FAudio_INTERNAL_AddSourceVoice(audio, *ppSourceVoice);
 	FAudio_AddRef(audio);
 	return 0;
 }
@@ -314,8 +453,7 @@ uint32_t FAudio_CreateSubmixVoice(
 	(*ppSubmixVoice)->filter.Type = FAUDIO_DEFAULT_FILTER_TYPE;
 	(*ppSubmixVoice)->filter.Frequency = FAUDIO_DEFAULT_FILTER_FREQUENCY;
 	(*ppSubmixVoice)->filter.OneOverQ = FAUDIO_DEFAULT_FILTER_ONEOVERQ;
-	(*ppSubmixVoice)->sendLock = FAudio_PlatformCreateMutex();
-	(*ppSubmixVoice)->effectLock = FAudio_PlatformCreateMutex();
+	(*ppSubmixVoice)->mixFilter = (*ppSubmixVoice)->filter;
 	(*ppSubmixVoice)->filterLock = FAudio_PlatformCreateMutex();
 	(*ppSubmixVoice)->volumeLock = FAudio_PlatformCreateMutex();
 
@@ -323,44 +461,31 @@ uint32_t FAudio_CreateSubmixVoice(
 	(*ppSubmixVoice)->mix.inputChannels = InputChannels;
 	(*ppSubmixVoice)->mix.inputSampleRate = InputSampleRate;
 	(*ppSubmixVoice)->mix.processingStage = ProcessingStage;
-	audio->submixStages = FAudio_max(
-		audio->submixStages,
-		ProcessingStage
-	);
 
-	/* Sends/Effects */
+	/* Effects */
 	FAudioVoice_SetEffectChain(*ppSubmixVoice, pEffectChain);
-	FAudioVoice_SetOutputVoices(*ppSubmixVoice, pSendList);
-	
-	/* Default Levels */
+
+	/* Default Levels, needed by the send matrices */
 	(*ppSubmixVoice)->volume = 1.0f;
+	(*ppSubmixVoice)->mixVolume = 1.0f;
 	(*ppSubmixVoice)->channelVolume = (float*)FAudio_malloc(
 		sizeof(float) * (*ppSubmixVoice)->outputChannels
 	);
+	(*ppSubmixVoice)->mixChannelVolume = (float*) FAudio_malloc(
+		sizeof(float) * (*ppSubmixVoice)->outputChannels
+	);
 	for (i = 0; i < (*ppSubmixVoice)->outputChannels; i += 1)
 	{
 		(*ppSubmixVoice)->channelVolume[i] = 1.0f;
-	}
-
-	/* Filters */
-	if (Flags & FAUDIO_VOICE_USEFILTER)
-	{
-		(*ppSubmixVoice)->filterState = (FAudioFilterState*) FAudio_malloc(
-			sizeof(FAudioFilterState) * InputChannels
-		);
-		FAudio_zero(
-			(*ppSubmixVoice)->filterState,
-			sizeof(FAudioFilterState) * InputChannels
-		);
+		(*ppSubmixVoice)->mixChannelVolume[i] = 1.0f;
 	}
 
 	/* Sample Storage */
 	(*ppSubmixVoice)->mix.inputSamples = (uint32_t) FAudio_ceil(
 		audio->updateSize *
-		InputChannels *
 		(double) InputSampleRate /
 		(double) audio->master->master.inputSampleRate
-	);
+	) * InputChannels;
 	(*ppSubmixVoice)->mix.inputCache = (float*) FAudio_malloc(
 		sizeof(float) * (*ppSubmixVoice)->mix.inputSamples
 	);
@@ -369,12 +494,53 @@ uint32_t FAudio_CreateSubmixVoice(
 		sizeof(float) * (*ppSubmixVoice)->mix.inputSamples
 	);
 
-	/* Add to list, finally. */
-	LinkedList_AddEntry(
-		&audio->submixes,
-		*ppSubmixVoice,
-		audio->submixLock
+	/* Resampler, set up for the output rate by SetOutputVoices */
+	(*ppSubmixVoice)->mix.resampleHistory = (float*) FAudio_malloc(
+		sizeof(float) * InputChannels
 	);
+	FAudio_zero(
+		(*ppSubmixVoice)->mix.resampleHistory,
+		sizeof(float) * InputChannels
+	);
+	if (InputChannels == 1)
+	{
+		(*ppSubmixVoice)->mix.resample = FAudio_INTERNAL_Kernels.resampleMono;
+	}
+	else if (InputChannels == 2)
+	{
+		(*ppSubmixVoice)->mix.resample = FAudio_INTERNAL_Kernels.resampleStereo;
+	}
+	else if (InputChannels == 6)
+	{
+		(*ppSubmixVoice)->mix.resample = FAudio_INTERNAL_Kernels.resample6Channel;
+	}
+	else if (InputChannels == 8)
+	{
+		(*ppSubmixVoice)->mix.resample = FAudio_INTERNAL_Kernels.resample8Channel;
+	}
+	else
+	{
+		(*ppSubmixVoice)->mix.resample = FAudio_INTERNAL_Kernels.resampleGeneric;
+	}
+
+	/* Sends */
+	FAudioVoice_SetOutputVoices(*ppSubmixVoice, pSendList);
+
+	/* Filters */
+	if (Flags & FAUDIO_VOICE_USEFILTER)
+	{
+		(*ppSubmixVoice)->filterState = (float*) FAudio_malloc(
+			sizeof(float) * FILTER_STATE_SIZE(InputChannels)
+		);
+		FAudio_zero(
+			(*ppSubmixVoice)->filterState,
+			sizeof(float) * FILTER_STATE_SIZE(InputChannels)
+		);
+	}
+
+	/* Add to table, finally. */
+	FAudio_INTERNAL_AddSubmixVoice(audio, *ppSubmixVoice);
+	FAudio_INTERNAL_BuildSubmixPlan(audio);
 	FAudio_AddRef(audio);
 	return 0;
 }
@@ -398,14 +564,23 @@ uint32_t FAudio_CreateMasteringVoice(
 	(*ppMasteringVoice)->audio = audio;
 	(*ppMasteringVoice)->type = FAUDIO_VOICE_MASTER;
 	(*ppMasteringVoice)->flags = Flags;
-	(*ppMasteringVoice)->effectLock = FAudio_PlatformCreateMutex();
 	(*ppMasteringVoice)->volumeLock = FAudio_PlatformCreateMutex();
 
 	/* Default Levels */
 	(*ppMasteringVoice)->volume = 1.0f;
+	(*ppMasteringVoice)->mixVolume = 1.0f;
 
 	/* Master Properties */
-	FAudio_GetDeviceDetails(audio, DeviceIndex, &details);
+	if (audio->initFlags & FAUDIO_PULL_MODE)
+	{
+		/* No device to ask, the host gets whatever it asks for */
+		details.OutputFormat.Format.nChannels = 2;
+		details.OutputFormat.Format.nSamplesPerSec = 48000;
+	}
+	else
+	{
+		FAudio_GetDeviceDetails(audio, DeviceIndex, &details);
+	}
 	(*ppMasteringVoice)->master.inputChannels = (InputChannels == FAUDIO_DEFAULT_CHANNELS) ?
 		details.OutputFormat.Format.nChannels :
 		InputChannels;
@@ -420,7 +595,28 @@ uint32_t FAudio_CreateMasteringVoice(
 	/* Platform Device */
 	audio->master = *ppMasteringVoice;
 	FAudio_AddRef(audio);
+	if (audio->initFlags & FAUDIO_PULL_MODE)
+	{
+		FAudio_INTERNAL_InitPullMode(audio);
+		FAudio_INTERNAL_ReserveEffectChain(
+			audio->master,
+			NULL,
+			audio->updateSize
+		);
+		FAudio_INTERNAL_LayoutMixBuses(audio);
+		return 0;
+	}
 	FAudio_PlatformInit(audio, DeviceIndex);
+
+	/* Now that we know the update size, make room for the master effects
+	 * and lay out the parallel mix buses
+	 */
+	FAudio_INTERNAL_ReserveEffectChain(
+		audio->master,
+		NULL,
+		audio->updateSize
+	);
+	FAudio_INTERNAL_LayoutMixBuses(audio);
 	if (audio->active)
 	{
 		FAudio_PlatformStart(audio);
@@ -453,17 +649,103 @@ void FAudio_StopEngine(FAudio *audio)
 	}
 }
 
-uint32_t FAudio_CommitChanges(FAudio *audio)
+uint32_t FAudio_Render(FAudio *audio, float *pOutput, uint32_t FrameCount)
 {
-	FAudio_assert(0 && "Batching is not supported!");
+	uint32_t channels, frames;
+
+	if (!(audio->initFlags & FAUDIO_PULL_MODE) || audio->master == NULL)
+	{
+		return FAUDIO_E_INVALID_CALL;
+	}
+	channels = audio->master->master.inputChannels;
+
+	while (FrameCount > 0)
+	{
+		if (audio->pullOffset < audio->updateSize)
+		{
+			/* Hand out what is left of the last quantum first */
+			frames = FAudio_min(
+				FrameCount,
+				audio->updateSize - audio->pullOffset
+			);
+			FAudio_memcpy(
+				pOutput,
+				audio->pullCache + (audio->pullOffset * channels),
+				sizeof(float) * frames * channels
+			);
+			audio->pullOffset += frames;
+		}
+		else if (FrameCount >= audio->updateSize)
+		{
+			/* Whole quanta are mixed straight into the host's buffer */
+			frames = audio->updateSize;
+			FAudio_zero(pOutput, sizeof(float) * frames * channels);
+			FAudio_INTERNAL_UpdateEngine(audio, pOutput);
+		}
+		else
+		{
+			FAudio_zero(
+				audio->pullCache,
+				sizeof(float) * audio->updateSize * channels
+			);
+			FAudio_INTERNAL_UpdateEngine(audio, audio->pullCache);
+			audio->pullOffset = 0;
+			continue;
+		}
+		pOutput += frames * channels;
+		FrameCount -= frames;
+	}
 	return 0;
 }
 
+uint32_t FAudio_CommitChanges(FAudio *audio, uint32_t OperationSet)
+{
+	return FAudio_INTERNAL_CommitCommands(audio, OperationSet);
+}
+
 void FAudio_GetPerformanceData(
 	FAudio *audio,
 	FAudioPerformanceData *pPerfData
 ) {
-	FAudio_assert(0 && "TODO: Performance metrics!");
+	uint64_t now;
+	uint32_t i;
+	FAudioVoice *voice;
+
+	/* The mixer hands its counters over at the end of every pass */
+	FAudio_PlatformLockMutex(audio->perfLock);
+	FAudio_memcpy(pPerfData, &audio->perfData, sizeof(FAudioPerformanceData));
+	audio->perfData.AudioCyclesSinceLastQuery = 0;
+	audio->perfData.MinimumCyclesPerQuantum = 0;
+	audio->perfData.MaximumCyclesPerQuantum = 0;
+	now = FAudio_timecounter();
+	pPerfData->TotalCyclesSinceLastQuery = now - audio->perfLastQuery;
+	audio->perfLastQuery = now;
+	FAudio_PlatformUnlockMutex(audio->perfLock);
+
+	pPerfData->CurrentLatencyInSamples = audio->updateSize;
+
+	/* The mixer counted its scratch space, add what the voices own */
+	pPerfData->MemoryUsageInBytes += (
+		sizeof(FAudio) +
+		sizeof(FAudioCommand) * COMMAND_RING_SIZE
+	);
+	FAudio_PlatformLockMutex(audio->sourceTableLock);
+	pPerfData->TotalSourceVoiceCount = audio->sources.count;
+	pPerfData->MemoryUsageInBytes += audio->sources.count * (
+		sizeof(FAudioVoice) +
+		sizeof(FAudioBuffer) * FAUDIO_MAX_QUEUED_BUFFERS
+	);
+	FAudio_PlatformUnlockMutex(audio->sourceTableLock);
+	FAudio_PlatformLockMutex(audio->submixLock);
+	for (i = 0; i < audio->submixes.count; i += 1)
+	{
+		voice = (FAudioVoice*) audio->submixes.entries[i].entry;
+		pPerfData->MemoryUsageInBytes += (
+			sizeof(FAudioVoice) +
+			sizeof(float) * voice->mix.inputSamples
+		);
+	}
+	FAudio_PlatformUnlockMutex(audio->submixLock);
 }
 
 void FAudio_SetDebugConfiguration(
@@ -474,6 +756,106 @@ void FAudio_SetDebugConfiguration(
 	FAudio_assert(0 && "TODO: Debug configuration!");
 }
 
+uint32_t FAudio_SetEngineThreadCount(FAudio *audio, uint32_t ThreadCount)
+{
+	/* The workers only run while the mixer holds scratchLock, which it
+	 * also takes before sourceLock and submixLock, so lock in that order
+	 */
+	FAudio_PlatformLockMutex(audio->scratchLock);
+	FAudio_PlatformLockMutex(audio->sourceLock);
+	FAudio_PlatformLockMutex(audio->submixLock);
+	FAudio_INTERNAL_StopMixWorkers(audio);
+	FAudio_INTERNAL_StartMixWorkers(audio, ThreadCount);
+	FAudio_PlatformUnlockMutex(audio->submixLock);
+	FAudio_PlatformUnlockMutex(audio->sourceLock);
+	FAudio_PlatformUnlockMutex(audio->scratchLock);
+	return 0;
+}
+
+uint32_t FAudio_SetDecodeCacheSize(FAudio *audio, uint32_t CacheBytes)
+{
+	FAudio_INTERNAL_SetDecodeCacheSize(audio, CacheBytes);
+	return 0;
+}
+
+uint32_t FAudio_SetVirtualVoiceThreshold(FAudio *audio, float Threshold)
+{
+	/* Source voices are only mixed while holding sourceLock */
+	FAudio_PlatformLockMutex(audio->sourceLock);
+	audio->virtualThreshold = Threshold;
+	FAudio_PlatformUnlockMutex(audio->sourceLock);
+	return 0;
+}
+
+uint32_t FAudio_SetLoadGovernor(FAudio *audio, float MaxLoad)
+{
+	/* The governor only runs while the mixer holds sourceLock */
+	FAudio_PlatformLockMutex(audio->sourceLock);
+	audio->governorMaxLoad = MaxLoad;
+	audio->governorLevel = 0;
+	audio->governorHold = 0;
+	FAudio_PlatformUnlockMutex(audio->sourceLock);
+	return 0;
+}
+
+uint32_t FAudio_SetSourceVoicePoolSize(FAudio *audio, uint32_t MaxVoices)
+{
+	FAudio_INTERNAL_SetSourceVoicePoolSize(audio, MaxVoices);
+	return 0;
+}
+
+uint32_t FAudio_StartTrace(FAudio *audio, uint32_t EventCount)
+{
+	FAudioTraceRing *ring;
+	uint32_t capacity;
+
+	/* The mixer may still be writing to the ring after StopTrace, so it is
+	 * allocated once and kept until Release.
+	 */
+	if (FAudio_PlatformAtomicGetPtr(&audio->traceRing) == NULL)
+	{
+		capacity = TRACE_MIN_EVENTS;
+		while (capacity < EventCount)
+		{
+			capacity <<= 1;
+		}
+		ring = (FAudioTraceRing*) FAudio_malloc(
+			sizeof(FAudioTraceRing) +
+			sizeof(FAudioTraceEvent) * capacity
+		);
+		ring->mask = capacity - 1;
+		ring->events = (FAudioTraceEvent*) (ring + 1);
+		FAudio_zero(
+			ring->events,
+			sizeof(FAudioTraceEvent) * capacity
+		);
+		if (!FAudio_PlatformAtomicCASPtr(&audio->traceRing, NULL, ring))
+		{
+			/* Another thread got there first */
+			FAudio_free(ring);
+		}
+	}
+
+	/* Earlier events stay in the ring but are no longer reported */
+	audio->traceStart = (uint32_t) FAudio_PlatformAtomicGet(&audio->traceHead);
+	audio->traceStartTime = FAudio_timecounter();
+	FAudio_PlatformAtomicSet(&audio->tracing, 1);
+	return 0;
+}
+
+void FAudio_StopTrace(FAudio *audio)
+{
+	FAudio_PlatformAtomicSet(&audio->tracing, 0);
+}
+
+uint32_t FAudio_GetTraceJSON(
+	FAudio *audio,
+	char *pBuffer,
+	uint32_t BufferSize
+) {
+	return FAudio_INTERNAL_WriteTraceJSON(audio, pBuffer, BufferSize);
+}
+
 /* FAudioVoice Interface */
 
 void FAudioVoice_GetVoiceDetails(
@@ -510,25 +892,45 @@ uint32_t FAudioVoice_SetOutputVoices(
 	uint32_t i;
 	uint32_t outChannels;
 	uint32_t outSampleRate;
-	uint32_t newResampleSamples;
+	uint32_t newResampleSamples = 0;
+	FAudioVoice *firstOutput;
 	FAudioVoiceSends defaultSends;
 	FAudioSendDescriptor defaultSend;
+	FAudioVoiceChange change;
+	FAudioCommand command;
+	float **sendCoefficients, **oldCoefficients;
 	FAudio_assert(voice->type != FAUDIO_VOICE_MASTER);
 
-	FAudio_PlatformLockMutex(voice->sendLock);
-
-	/* FIXME: This is lazy... */
-	for (i = 0; i < voice->sends.SendCount; i += 1)
-	{
-		FAudio_free(voice->sendCoefficients[i]);
-	}
-	if (voice->sendCoefficients != NULL)
-	{
-		FAudio_free(voice->sendCoefficients);
-	}
-	if (voice->sends.pSends != NULL)
-	{
-		FAudio_free(voice->sends.pSends);
+	/* Size the scratch for the new output rate before the mixer sees it */
+	if (pSendList == NULL || pSendList->SendCount > 0)
+	{
+		firstOutput = (pSendList == NULL) ?
+			voice->audio->master :
+			pSendList->pSends[0].pOutputVoice;
+		outSampleRate = firstOutput->type == FAUDIO_VOICE_MASTER ?
+			firstOutput->master.inputSampleRate :
+			firstOutput->mix.inputSampleRate;
+		newResampleSamples = (uint32_t) FAudio_ceil(
+			voice->audio->updateSize *
+			(double) outSampleRate /
+			(double) voice->audio->master->master.inputSampleRate
+		);
+		FAudio_INTERNAL_ReserveMixScratch(
+			voice->audio,
+			0,
+			newResampleSamples * voice->outputChannels,
+			0
+		);
+		FAudio_INTERNAL_ReserveEffectChain(
+			voice,
+			NULL,
+			(voice->type == FAUDIO_VOICE_SOURCE) ?
+				newResampleSamples :
+				FAudio_max(
+					newResampleSamples,
+					voice->mix.inputSamples / voice->mix.inputChannels
+				)
+		);
 	}
 
 	if (pSendList == NULL)
@@ -540,29 +942,38 @@ uint32_t FAudioVoice_SetOutputVoices(
 		defaultSends.pSends = &defaultSend;
 		pSendList = &defaultSends;
 	}
-	else if (pSendList->SendCount == 0)
-	{
-		/* No sends? Nothing to do... */
-		FAudio_zero(&voice->sends, sizeof(FAudioVoiceSends));
-		FAudio_PlatformUnlockMutex(voice->sendLock);
-		return 0;
-	}
 
-	/* Copy send list */
-	voice->sends.SendCount = pSendList->SendCount;
-	voice->sends.pSends = (FAudioSendDescriptor*) FAudio_malloc(
-		pSendList->SendCount * sizeof(FAudioSendDescriptor)
-	);
-	FAudio_memcpy(
-		voice->sends.pSends,
-		pSendList->pSends,
-		pSendList->SendCount * sizeof(FAudioSendDescriptor)
-	);
+	/* Build the new sends here, the mixer only swaps them in */
+	FAudio_zero(&change, sizeof(change));
+	change.outputSamples = newResampleSamples;
+	sendCoefficients = NULL;
+	if (pSendList->SendCount > 0)
+	{
+		/* Copy send list */
+		change.sends.SendCount = pSendList->SendCount;
+		change.sends.pSends = (FAudioSendDescriptor*) FAudio_malloc(
+			pSendList->SendCount * sizeof(FAudioSendDescriptor)
+		);
+		FAudio_memcpy(
+			change.sends.pSends,
+			pSendList->pSends,
+			pSendList->SendCount * sizeof(FAudioSendDescriptor)
+		);
 
-	/* Allocate/Reset default output matrix */
-	voice->sendCoefficients = (float**) FAudio_malloc(
-		sizeof(float*) * pSendList->SendCount
-	);
+		/* Allocate/Reset default output matrix */
+		sendCoefficients = (float**) FAudio_malloc(
+			sizeof(float*) * pSendList->SendCount
+		);
+		change.mixSendCoefficients = (float**) FAudio_malloc(
+			sizeof(float*) * pSendList->SendCount
+		);
+		change.mixCoefficients = (float**) FAudio_malloc(
+			sizeof(float*) * pSendList->SendCount
+		);
+		change.sendMix = (FAudioMixCallback*) FAudio_malloc(
+			sizeof(FAudioMixCallback) * pSendList->SendCount
+		);
+	}
 	for (i = 0; i < pSendList->SendCount; i += 1)
 	{
 		if (pSendList->pSends[i].pOutputVoice->type == FAUDIO_VOICE_MASTER)
@@ -573,51 +984,94 @@ uint32_t FAudioVoice_SetOutputVoices(
 		{
 			outChannels = pSendList->pSends[i].pOutputVoice->mix.inputChannels;
 		}
-		voice->sendCoefficients[i] = (float*) FAudio_malloc(
+		sendCoefficients[i] = (float*) FAudio_malloc(
+			sizeof(float) * voice->outputChannels * outChannels
+		);
+		change.mixSendCoefficients[i] = (float*) FAudio_malloc(
+			sizeof(float) * voice->outputChannels * outChannels
+		);
+		change.mixCoefficients[i] = (float*) FAudio_malloc(
 			sizeof(float) * voice->outputChannels * outChannels
 		);
 		FAudio_INTERNAL_SetDefaultMatrix(
-			voice->sendCoefficients[i],
+			sendCoefficients[i],
 			voice->outputChannels,
 			outChannels
 		);
+		FAudio_memcpy(
+			change.mixSendCoefficients[i],
+			sendCoefficients[i],
+			sizeof(float) * voice->outputChannels * outChannels
+		);
+
+		/* Send mixer, specialized for the common channel pairs */
+		change.sendMix[i] = FAudio_INTERNAL_Kernels.mixGeneric;
+		if (voice->outputChannels == 1)
+		{
+			if (outChannels == 2)
+			{
+				change.sendMix[i] = FAudio_INTERNAL_Kernels.mixMonoToStereo;
+			}
+			else if (outChannels == 6)
+			{
+				change.sendMix[i] = FAudio_INTERNAL_Kernels.mixMonoTo6Channel;
+			}
+			else if (outChannels == 8)
+			{
+				change.sendMix[i] = FAudio_INTERNAL_Kernels.mixMonoTo8Channel;
+			}
+		}
+		else if (voice->outputChannels == 2)
+		{
+			if (outChannels == 2)
+			{
+				change.sendMix[i] = FAudio_INTERNAL_Kernels.mixStereoToStereo;
+			}
+			else if (outChannels == 6)
+			{
+				change.sendMix[i] = FAudio_INTERNAL_Kernels.mixStereoTo6Channel;
+			}
+			else if (outChannels == 8)
+			{
+				change.sendMix[i] = FAudio_INTERNAL_Kernels.mixStereoTo8Channel;
+			}
+		}
 	}
 
-	/* Allocate resample cache */
-	outSampleRate = voice->sends.pSends[0].pOutputVoice->type == FAUDIO_VOICE_MASTER ?
-		voice->sends.pSends[0].pOutputVoice->master.inputSampleRate :
-		voice->sends.pSends[0].pOutputVoice->mix.inputSampleRate;
-	newResampleSamples = (uint32_t) FAudio_ceil(
-		voice->audio->updateSize *
-		(double) outSampleRate /
-		(double) voice->audio->master->master.inputSampleRate
-	);
-	FAudio_INTERNAL_ResizeResampleCache(
-		voice->audio,
-		newResampleSamples * voice->outputChannels
-	);
-	if (voice->type == FAUDIO_VOICE_SOURCE)
+	/* Anything queued against the old sends goes in first. The mix
+	 * matrices for the new ones are built when the change is applied.
+	 */
+	FAudio_PlatformLockMutex(voice->volumeLock);
+	command.type = FAUDIO_COMMAND_SETOUTPUTVOICES;
+	command.voice = voice;
+	command.index = 0;
+	command.data.change = &change;
+	FAudio_INTERNAL_QueueVoiceChange(voice->audio, &command);
+	oldCoefficients = voice->sendCoefficients;
+	voice->sendCoefficients = sendCoefficients;
+	FAudio_PlatformUnlockMutex(voice->volumeLock);
+
+	/* FIXME: This is lazy... The old sends came back in the change */
+	for (i = 0; i < change.sends.SendCount; i += 1)
 	{
-		voice->src.resampleSamples = newResampleSamples;
+		FAudio_free(oldCoefficients[i]);
+		FAudio_free(change.mixSendCoefficients[i]);
+		FAudio_free(change.mixCoefficients[i]);
 	}
-	else
-	{
-		voice->mix.outputSamples = newResampleSamples;
+	FAudio_free(oldCoefficients);
+	FAudio_free(change.mixSendCoefficients);
+	FAudio_free(change.mixCoefficients);
+	FAudio_free(change.sendMix);
+	FAudio_free(change.sends.pSends);
 
-		/* Init fixed-rate SRC if applicable */
-		if (voice->mix.resampler != NULL)
-		{
-			/* FIXME: This is lazy... */
-			FAudio_PlatformCloseFixedRateSRC(voice->mix.resampler);
-		}
-		voice->mix.resampler = FAudio_PlatformInitFixedRateSRC(
-			voice->mix.inputChannels,
-			voice->mix.inputSampleRate,
-			outSampleRate
-		);
-	}
+	/* Operation sets need room for the new matrices */
+	FAudio_INTERNAL_ReserveStagedCommands(voice, 0);
 
-	FAudio_PlatformUnlockMutex(voice->sendLock);
+	/* The submix graph changed, rebuild the execution plan */
+	if (voice->type == FAUDIO_VOICE_SUBMIX)
+	{
+		FAudio_INTERNAL_BuildSubmixPlan(voice->audio);
+	}
 	return 0;
 }
 
@@ -628,6 +1082,8 @@ uint32_t FAudioVoice_SetEffectChain(
 	uint32_t i;
 	uint32_t channelCount;
 	FAudioVoiceDetails voiceDetails;
+	FAudioVoiceChange change;
+	FAudioCommand command;
 
 	FAudioVoice_GetVoiceDetails(voice, &voiceDetails);
 
@@ -654,13 +1110,28 @@ uint32_t FAudioVoice_SetEffectChain(
 		}
 	}
 
-	FAudio_PlatformLockMutex(voice->effectLock);
+	/* The new chain must fit in the scratch before the mixer can run it */
+	if (pEffectChain != NULL)
+	{
+		FAudio_INTERNAL_ReserveEffectChain(
+			voice,
+			pEffectChain,
+			(voice->type == FAUDIO_VOICE_SOURCE) ?
+				voice->src.resampleSamples :
+			(voice->type == FAUDIO_VOICE_SUBMIX) ?
+				FAudio_max(
+					voice->mix.outputSamples,
+					voice->mix.inputSamples / voice->mix.inputChannels
+				) :
+				voice->audio->updateSize
+		);
+	}
 
+	/* Build the new chain here, the mixer only swaps it in */
+	FAudio_zero(&change, sizeof(change));
 	if (pEffectChain == NULL)
 	{
-		FAudio_INTERNAL_FreeEffectChain(voice);
-		FAudio_zero(&voice->effects, sizeof(voice->effects));
-		voice->outputChannels = voiceDetails.InputChannels;
+		change.outputChannels = voiceDetails.InputChannels;
 	}
 	else
 	{
@@ -686,35 +1157,49 @@ uint32_t FAudioVoice_SetEffectChain(
 			if (fapo->IsOutputFormatSupported(fapo, &srcFmt, &dstFmt, NULL))
 			{
 				FAudio_assert(0 && "Effect: output format not supported");
-				FAudio_PlatformUnlockMutex(voice->effectLock);
 				return FAUDIO_E_UNSUPPORTED_FORMAT;
 			}
 		}
 
-		FAudio_INTERNAL_FreeEffectChain(voice);
 		FAudio_INTERNAL_AllocEffectChain(
-			voice,
+			&change.effects,
 			pEffectChain
 		);
 
 		/* check if in-place processing is supported */
 		channelCount = voiceDetails.InputChannels;
-		for (i = 0; i < voice->effects.count; i += 1)
+		change.effects.maxChannels = 0;
+		for (i = 0; i < change.effects.count; i += 1)
 		{
 			FAPORegistrationProperties props;
 			FAPORegistrationProperties *pProps = &props;
-			FAPO *fapo = voice->effects.desc[i].pEffect;
+			FAPO *fapo = change.effects.desc[i].pEffect;
 
 			fapo->GetRegistrationProperties(fapo, &pProps);
 
-			voice->effects.inPlaceProcessing[i] = (props.Flags & FAPO_FLAG_INPLACE_SUPPORTED) == FAPO_FLAG_INPLACE_SUPPORTED;
-			voice->effects.inPlaceProcessing[i] &= (channelCount == voice->effects.desc[i].OutputChannels);
-			channelCount = voice->effects.desc[i].OutputChannels;
+			change.effects.inPlaceProcessing[i] = (props.Flags & FAPO_FLAG_INPLACE_SUPPORTED) == FAPO_FLAG_INPLACE_SUPPORTED;
+			change.effects.inPlaceProcessing[i] &= (channelCount == change.effects.desc[i].OutputChannels);
+			channelCount = change.effects.desc[i].OutputChannels;
+			change.effects.maxChannels = FAudio_max(
+				change.effects.maxChannels,
+				channelCount
+			);
 		}
-		voice->outputChannels = channelCount;
+		change.outputChannels = channelCount;
 	}
 
-	FAudio_PlatformUnlockMutex(voice->effectLock);
+	/* Parameters queued for the old chain go in before it is replaced */
+	command.type = FAUDIO_COMMAND_SETEFFECTCHAIN;
+	command.voice = voice;
+	command.index = 0;
+	command.data.change = &change;
+	FAudio_INTERNAL_QueueVoiceChange(voice->audio, &command);
+
+	/* The old chain came back in the change */
+	FAudio_INTERNAL_FreeEffectChain(&change.effects);
+
+	/* Operation sets need room for the new effects */
+	FAudio_INTERNAL_ReserveStagedCommands(voice, 0);
 	return 0;
 }
 
@@ -723,11 +1208,20 @@ uint32_t FAudioVoice_EnableEffect(
 	uint32_t EffectIndex,
 	uint32_t OperationSet
 ) {
-	FAudio_assert(OperationSet == FAUDIO_COMMIT_NOW);
+	FAudioCommand command;
 
-	FAudio_PlatformLockMutex(voice->effectLock);
+	if (OperationSet != FAUDIO_COMMIT_NOW)
+	{
+		command.type = FAUDIO_COMMAND_ENABLEEFFECT;
+		command.voice = voice;
+		command.index = EffectIndex;
+		FAudio_INTERNAL_SubmitCommand(voice->audio, &command, NULL, OperationSet);
+		return 0;
+	}
+
+	FAudio_INTERNAL_LockCommands(voice->audio);
 	voice->effects.desc[EffectIndex].InitialState = 1;
-	FAudio_PlatformUnlockMutex(voice->effectLock);
+	FAudio_INTERNAL_UnlockCommands(voice->audio);
 	return 0;
 }
 
@@ -736,11 +1230,20 @@ uint32_t FAudioVoice_DisableEffect(
 	uint32_t EffectIndex,
 	uint32_t OperationSet
 ) {
-	FAudio_assert(OperationSet == FAUDIO_COMMIT_NOW);
+	FAudioCommand command;
 
-	FAudio_PlatformLockMutex(voice->effectLock);
+	if (OperationSet != FAUDIO_COMMIT_NOW)
+	{
+		command.type = FAUDIO_COMMAND_DISABLEEFFECT;
+		command.voice = voice;
+		command.index = EffectIndex;
+		FAudio_INTERNAL_SubmitCommand(voice->audio, &command, NULL, OperationSet);
+		return 0;
+	}
+
+	FAudio_INTERNAL_LockCommands(voice->audio);
 	voice->effects.desc[EffectIndex].InitialState = 0;
-	FAudio_PlatformUnlockMutex(voice->effectLock);
+	FAudio_INTERNAL_UnlockCommands(voice->audio);
 	return 0;
 }
 
@@ -749,9 +1252,10 @@ void FAudioVoice_GetEffectState(
 	uint32_t EffectIndex,
 	uint8_t *pEnabled
 ) {
-	FAudio_PlatformLockMutex(voice->effectLock);
+	/* Changes to this are only ever applied under commandLock */
+	FAudio_PlatformLockMutex(voice->audio->commandLock);
 	*pEnabled = voice->effects.desc[EffectIndex].InitialState;
-	FAudio_PlatformUnlockMutex(voice->effectLock);
+	FAudio_PlatformUnlockMutex(voice->audio->commandLock);
 }
 
 uint32_t FAudioVoice_SetEffectParameters(
@@ -761,31 +1265,25 @@ uint32_t FAudioVoice_SetEffectParameters(
 	uint32_t ParametersByteSize,
 	uint32_t OperationSet
 ) {
-	FAudio_assert(OperationSet == FAUDIO_COMMIT_NOW);
+	FAudioCommand command;
 
-	if (voice->effects.parameters[EffectIndex] == NULL)
-	{
-		voice->effects.parameters[EffectIndex] = FAudio_malloc(
-			ParametersByteSize
-		);
-		voice->effects.parameterSizes[EffectIndex] = ParametersByteSize;
-	}
-	FAudio_PlatformLockMutex(voice->effectLock);
-	if (voice->effects.parameterSizes[EffectIndex] < ParametersByteSize)
-	{
-		voice->effects.parameters[EffectIndex] = FAudio_realloc(
-			voice->effects.parameters[EffectIndex],
-			ParametersByteSize
-		);
-		voice->effects.parameterSizes[EffectIndex] = ParametersByteSize;
-	}
-	FAudio_memcpy(
-		voice->effects.parameters[EffectIndex],
-		pParameters,
+	/* The mixer copies these into the voice's own block, sized here */
+	FAudio_INTERNAL_ReserveEffectParameters(
+		voice,
+		EffectIndex,
 		ParametersByteSize
 	);
-	voice->effects.parameterUpdates[EffectIndex] = 1;
-	FAudio_PlatformUnlockMutex(voice->effectLock);
+
+	command.type = FAUDIO_COMMAND_SETEFFECTPARAMETERS;
+	command.voice = voice;
+	command.index = EffectIndex;
+	command.data.block.size = ParametersByteSize;
+	FAudio_INTERNAL_SubmitCommand(
+		voice->audio,
+		&command,
+		pParameters,
+		OperationSet
+	);
 	return 0;
 }
 
@@ -796,10 +1294,12 @@ uint32_t FAudioVoice_GetEffectParameters(
 	uint32_t ParametersByteSize
 ) {
 	FAPO *fapo;
-	FAudio_PlatformLockMutex(voice->effectLock);
+
+	/* The chain is only ever swapped under commandLock */
+	FAudio_PlatformLockMutex(voice->audio->commandLock);
 	fapo = voice->effects.desc[EffectIndex].pEffect;
 	fapo->GetParameters(fapo, pParameters, ParametersByteSize);
-	FAudio_PlatformUnlockMutex(voice->effectLock);
+	FAudio_PlatformUnlockMutex(voice->audio->commandLock);
 	return 0;
 }
 
@@ -808,7 +1308,7 @@ uint32_t FAudioVoice_SetFilterParameters(
 	const FAudioFilterParameters *pParameters,
 	uint32_t OperationSet
 ) {
-	FAudio_assert(OperationSet == FAUDIO_COMMIT_NOW);
+	FAudioCommand command;
 
 	/* MSDN: "This method is usable only on source and submix voices and
 	 * has no effect on mastering voices."
@@ -831,6 +1331,11 @@ uint32_t FAudioVoice_SetFilterParameters(
 	);
 	FAudio_PlatformUnlockMutex(voice->filterLock);
 
+	command.type = FAUDIO_COMMAND_SETFILTERPARAMETERS;
+	command.voice = voice;
+	command.index = 0;
+	command.data.filter = *pParameters;
+	FAudio_INTERNAL_SubmitCommand(voice->audio, &command, NULL, OperationSet);
 	return 0;
 }
 
@@ -876,13 +1381,23 @@ uint32_t FAudioVoice_SetVolume(
 	float Volume,
 	uint32_t OperationSet
 ) {
-	FAudio_assert(OperationSet == FAUDIO_COMMIT_NOW);
+	FAudioCommand command;
 
-	voice->volume = FAudio_clamp(
+	Volume = FAudio_clamp(
 		Volume,
 		-FAUDIO_MAX_VOLUME_LEVEL,
 		FAUDIO_MAX_VOLUME_LEVEL
 	);
+
+	FAudio_PlatformLockMutex(voice->volumeLock);
+	voice->volume = Volume;
+	FAudio_PlatformUnlockMutex(voice->volumeLock);
+
+	command.type = FAUDIO_COMMAND_SETVOLUME;
+	command.voice = voice;
+	command.index = 0;
+	command.data.value = Volume;
+	FAudio_INTERNAL_SubmitCommand(voice->audio, &command, NULL, OperationSet);
 	return 0;
 }
 
@@ -899,8 +1414,8 @@ uint32_t FAudioVoice_SetChannelVolumes(
 	const float *pVolumes,
 	uint32_t OperationSet
 ) {
+	FAudioCommand command;
 	FAudio_assert(voice->type != FAUDIO_VOICE_MASTER);
-	FAudio_assert(OperationSet == FAUDIO_COMMIT_NOW);
 
 	if (!pVolumes)
 	{
@@ -919,6 +1434,17 @@ uint32_t FAudioVoice_SetChannelVolumes(
 		sizeof(float) * Channels
 	);
 	FAudio_PlatformUnlockMutex(voice->volumeLock);
+
+	command.type = FAUDIO_COMMAND_SETCHANNELVOLUMES;
+	command.voice = voice;
+	command.index = 0;
+	command.data.block.size = sizeof(float) * Channels;
+	FAudio_INTERNAL_SubmitCommand(
+		voice->audio,
+		&command,
+		pVolumes,
+		OperationSet
+	);
 	return 0;
 }
 
@@ -945,9 +1471,9 @@ uint32_t FAudioVoice_SetOutputMatrix(
 	uint32_t OperationSet
 ) {
 	uint32_t i;
-	FAudio_assert(OperationSet == FAUDIO_COMMIT_NOW);
+	FAudioCommand command;
 
-	FAudio_PlatformLockMutex(voice->sendLock);
+	FAudio_PlatformLockMutex(voice->volumeLock);
 
 	/* Find the send index */
 	if (pDestinationVoice == NULL && voice->sends.SendCount == 1)
@@ -982,7 +1508,18 @@ uint32_t FAudioVoice_SetOutputMatrix(
 		sizeof(float) * SourceChannels * DestinationChannels
 	);
 
-	FAudio_PlatformUnlockMutex(voice->sendLock);
+	FAudio_PlatformUnlockMutex(voice->volumeLock);
+
+	command.type = FAUDIO_COMMAND_SETOUTPUTMATRIX;
+	command.voice = voice;
+	command.index = i;
+	command.data.block.size = sizeof(float) * SourceChannels * DestinationChannels;
+	FAudio_INTERNAL_SubmitCommand(
+		voice->audio,
+		&command,
+		pLevelMatrix,
+		OperationSet
+	);
 	return 0;
 }
 
@@ -995,7 +1532,7 @@ void FAudioVoice_GetOutputMatrix(
 ) {
 	uint32_t i;
 
-	FAudio_PlatformLockMutex(voice->sendLock);
+	FAudio_PlatformLockMutex(voice->volumeLock);
 
 	/* Find the send index */
 	for (i = 0; i < voice->sends.SendCount; i += 1)
@@ -1032,96 +1569,112 @@ void FAudioVoice_GetOutputMatrix(
 		sizeof(float) * SourceChannels * DestinationChannels
 	);
 
-	FAudio_PlatformUnlockMutex(voice->sendLock);
+	FAudio_PlatformUnlockMutex(voice->volumeLock);
+}
+
+uint32_t FAudioVoice_GetProfile(
+	FAudioVoice *voice,
+	FAudioVoiceProfile *pProfile,
+	uint64_t *pEffectTicks,
+	uint32_t EffectCount
+) {
+#ifdef FAUDIO_PROFILE
+	FAudioVoiceStats stats;
+
+	/* The effect ticks belong to the chain, which only changes under
+	 * commandLock. The rest is published by the mixer after every pass.
+	 */
+	FAudio_PlatformLockMutex(voice->audio->commandLock);
+	FAudio_INTERNAL_ReadVoiceStats(
+		voice,
+		&stats,
+		pEffectTicks,
+		(pEffectTicks != NULL) ? EffectCount : 0
+	);
+	FAudio_PlatformUnlockMutex(voice->audio->commandLock);
+	FAudio_memcpy(pProfile, &stats.profile, sizeof(FAudioVoiceProfile));
+	pProfile->TicksPerSecond = FAudio_timefrequency();
+	return 0;
+#else
+	FAudio_zero(pProfile, sizeof(FAudioVoiceProfile));
+	if (pEffectTicks != NULL)
+	{
+		FAudio_zero(pEffectTicks, sizeof(uint64_t) * EffectCount);
+	}
+	return FAUDIO_E_INVALID_CALL;
+#endif
 }
 
 void FAudioVoice_DestroyVoice(FAudioVoice *voice)
 {
-	uint32_t i;
-	LinkedList *list;
-	FAudioSubmixVoice *submix;
+	FAudio *audio;
+
+	/* Nothing in the queue may outlive the voice it points to */
+	FAudio_INTERNAL_DiscardStagedCommands(voice->audio, voice);
+	FAudio_INTERNAL_ReserveStagedCommands(voice, 1);
+	FAudio_INTERNAL_FlushCommands(voice->audio);
 
 	/* TODO: Check for dependencies and fail if still in use */
 	if (voice->type == FAUDIO_VOICE_SOURCE)
 	{
-		LinkedList_RemoveEntry(
+		/* Wait out any mix in progress before leaving the table */
+		FAudio_PlatformLockMutex(voice->audio->sourceLock);
+		HandleTable_RemoveEntry(
 			&voice->audio->sources,
-			voice,
-			voice->audio->sourceLock
+			voice->handle,
+			voice->audio->sourceTableLock
 		);
+		FAudio_PlatformUnlockMutex(voice->audio->sourceLock);
+
+		/* Park it for the next voice of the same format, if there's room.
+		 * Parking resets the voice, so hold on to the engine first.
+		 */
+		audio = voice->audio;
+		if (FAudio_INTERNAL_PoolSourceVoice(voice))
+		{
+			FAudio_Release(audio);
+			return;
+		}
+		FAudio_free(voice->src.bufferQueue);
+		if (voice->src.sincHistory != NULL)
+		{
+			FAudio_free(voice->src.sincHistory);
+		}
+		if (voice->src.blockCache != NULL)
+		{
+			FAudio_free(voice->src.blockCache);
+		}
 		FAudio_PlatformDestroyMutex(voice->src.bufferLock);
 	}
 	else if (voice->type == FAUDIO_VOICE_SUBMIX)
 	{
-		/* Remove submix from list */
-		LinkedList_RemoveEntry(
-			&voice->audio->submixes,
-			voice,
-			voice->audio->submixLock
-		);
+		/* Remove submix from table */
+		FAudio_INTERNAL_RemoveSubmixVoice(voice);
 
-		/* Check submix stage count */
-		voice->audio->submixStages = 0;
-		list = voice->audio->submixes;
-		while (list != NULL)
-		{
-			submix = (FAudioSubmixVoice*) list->entry;
-			voice->audio->submixStages = FAudio_max(
-				voice->audio->submixStages,
-				submix->mix.processingStage
-			);
-			list = list->next;
-		}
+		/* Rebuild the submix plan without this voice */
+		FAudio_INTERNAL_BuildSubmixPlan(voice->audio);
 
 		/* Delete submix data */
 		FAudio_free(voice->mix.inputCache);
-		if (voice->mix.resampler != NULL)
-		{
-			FAudio_PlatformCloseFixedRateSRC(voice->mix.resampler);
-		}
+		FAudio_free(voice->mix.resampleHistory);
 	}
 	else if (voice->type == FAUDIO_VOICE_MASTER)
 	{
-		FAudio_PlatformQuit(voice->audio);
-		voice->audio->master = NULL;
-	}
-
-	if (voice->sendLock != NULL)
-	{
-		FAudio_PlatformLockMutex(voice->sendLock);
-		for (i = 0; i < voice->sends.SendCount; i += 1)
-		{
-			FAudio_free(voice->sendCoefficients[i]);
-		}
-		if (voice->sendCoefficients != NULL)
+		if (voice->audio->initFlags & FAUDIO_PULL_MODE)
 		{
-			FAudio_free(voice->sendCoefficients);
+			FAudio_free(voice->audio->pullCache);
+			voice->audio->pullCache = NULL;
 		}
-		if (voice->sends.pSends != NULL)
+		else
 		{
-			FAudio_free(voice->sends.pSends);
+			FAudio_PlatformQuit(voice->audio);
 		}
-		FAudio_PlatformUnlockMutex(voice->sendLock);
-		FAudio_PlatformDestroyMutex(voice->sendLock);
+		voice->audio->master = NULL;
 	}
 
-	if (voice->effectLock != NULL)
-	{
-		FAudio_PlatformLockMutex(voice->effectLock);
-		if (voice->effects.desc != NULL)
-		{
-			for (i = 0; i < voice->effects.count; i += 1)
-			{
-				voice->effects.desc[i].pEffect->Release(voice->effects.desc[i].pEffect);
-			}
-			FAudio_free(voice->effects.parameters);
-			FAudio_free(voice->effects.parameterSizes);
-			FAudio_free(voice->effects.parameterUpdates);
-			FAudio_free(voice->effects.desc);
-		}
-		FAudio_PlatformUnlockMutex(voice->effectLock);
-		FAudio_PlatformDestroyMutex(voice->effectLock);
-	}
+	/* The mixer can no longer reach the voice, its sends and chain are ours */
+	FAudio_INTERNAL_FreeSends(voice);
+	FAudio_INTERNAL_FreeEffectChain(&voice->effects);
 
 	if (voice->filterLock != NULL)
 	{
@@ -1140,6 +1693,7 @@ void FAudioVoice_DestroyVoice(FAudioVoice *voice)
 		if (voice->channelVolume != NULL)
 		{
 			FAudio_free(voice->channelVolume);
+			FAudio_free(voice->mixChannelVolume);
 		}
 		FAudio_PlatformUnlockMutex(voice->volumeLock);
 		FAudio_PlatformDestroyMutex(voice->volumeLock);
@@ -1156,11 +1710,27 @@ uint32_t FAudioSourceVoice_Start(
 	uint32_t Flags,
 	uint32_t OperationSet
 ) {
-	FAudio_assert(OperationSet == FAUDIO_COMMIT_NOW);
+	FAudioCommand command;
 	FAudio_assert(voice->type == FAUDIO_VOICE_SOURCE);
 
 	FAudio_assert(Flags == 0);
+
+	if (OperationSet != FAUDIO_COMMIT_NOW)
+	{
+		command.type = FAUDIO_COMMAND_START;
+		command.voice = voice;
+		command.index = Flags;
+		FAudio_INTERNAL_SubmitCommand(voice->audio, &command, NULL, OperationSet);
+		return 0;
+	}
+
 	voice->src.active = 1;
+	HandleTable_SetActive(
+		&voice->audio->sources,
+		voice->handle,
+		1,
+		voice->audio->sourceTableLock
+	);
 	return 0;
 }
 
@@ -1169,11 +1739,27 @@ uint32_t FAudioSourceVoice_Stop(
 	uint32_t Flags,
 	uint32_t OperationSet
 ) {
-	FAudio_assert(OperationSet == FAUDIO_COMMIT_NOW);
+	FAudioCommand command;
 	FAudio_assert(voice->type == FAUDIO_VOICE_SOURCE);
 
 	FAudio_assert(!(Flags & FAUDIO_PLAY_TAILS)); /* FIXME: ??? */
+
+	if (OperationSet != FAUDIO_COMMIT_NOW)
+	{
+		command.type = FAUDIO_COMMAND_STOP;
+		command.voice = voice;
+		command.index = Flags;
+		FAudio_INTERNAL_SubmitCommand(voice->audio, &command, NULL, OperationSet);
+		return 0;
+	}
+
 	voice->src.active = 0;
+	HandleTable_SetActive(
+		&voice->audio->sources,
+		voice->handle,
+		0,
+		voice->audio->sourceTableLock
+	);
 	return 0;
 }
 
@@ -1184,7 +1770,8 @@ uint32_t FAudioSourceVoice_SubmitSourceBuffer(
 ) {
 	uint32_t adpcmMask, *adpcmByteCount;
 	uint32_t playBegin, playLength, loopBegin, loopLength;
-	FAudioBufferEntry *entry, *list;
+	uint32_t head;
+	FAudioBuffer *entry;
 	FAudio_assert(voice->type == FAUDIO_VOICE_SOURCE);
 	FAudio_assert(pBufferWMA == NULL);
 
@@ -1262,44 +1849,31 @@ uint32_t FAudioSourceVoice_SubmitSourceBuffer(
 		) * voice->src.format.nBlockAlign;
 	}
 
-	/* Allocate, now that we have valid input */
-	entry = (FAudioBufferEntry*) FAudio_malloc(sizeof(FAudioBufferEntry));
-	FAudio_memcpy(&entry->buffer, pBuffer, sizeof(FAudioBuffer));
-	entry->buffer.PlayBegin = playBegin;
-	entry->buffer.PlayLength = playLength;
-	entry->buffer.LoopBegin = loopBegin;
-	entry->buffer.LoopLength = loopLength;
-	entry->next = NULL;
-
-	if (	voice->audio->version <= 7 && (
-		entry->buffer.LoopCount > 0 &&
-		entry->buffer.LoopBegin + entry->buffer.LoopLength <= entry->buffer.PlayBegin))
+	/* Claim the next slot, now that we have valid input */
+	FAudio_PlatformLockMutex(voice->src.bufferLock);
+	head = (uint32_t) voice->src.bufferHead;
+	if (	head - (uint32_t) FAudio_PlatformAtomicGet(&voice->src.bufferTail) >=
+		FAUDIO_MAX_QUEUED_BUFFERS	)
 	{
-		entry->buffer.LoopCount = 0;
+		FAudio_PlatformUnlockMutex(voice->src.bufferLock);
+		return FAUDIO_E_INVALID_CALL;
 	}
+	entry = &voice->src.bufferQueue[head & (FAUDIO_MAX_QUEUED_BUFFERS - 1)];
+	FAudio_memcpy(entry, pBuffer, sizeof(FAudioBuffer));
+	entry->PlayBegin = playBegin;
+	entry->PlayLength = playLength;
+	entry->LoopBegin = loopBegin;
+	entry->LoopLength = loopLength;
 
-	/* Submit! */
-	FAudio_PlatformLockMutex(voice->src.bufferLock);
-	if (voice->src.bufferList == NULL)
+	if (	voice->audio->version <= 7 && (
+		entry->LoopCount > 0 &&
+		entry->LoopBegin + entry->LoopLength <= entry->PlayBegin))
 	{
-		voice->src.bufferList = entry;
-		voice->src.curBufferOffset = entry->buffer.PlayBegin;
+		entry->LoopCount = 0;
 	}
-	else
-	{
-		list = voice->src.bufferList;
-		while (list->next != NULL)
-		{
-			list = list->next;
-		}
-		list->next = entry;
 
-		/* For some bizarre reason we get scenarios where a buffer is freed, only to
-		 * have the allocator give us the exact same address and somehow get a single
-		 * buffer referencing itself. I don't even know.
-		 */
-		FAudio_assert(list != entry);
-	}
+	/* Submit! */
+	FAudio_PlatformAtomicSet(&voice->src.bufferHead, (int32_t) (head + 1));
 	FAudio_PlatformUnlockMutex(voice->src.bufferLock);
 	return 0;
 }
@@ -1307,40 +1881,23 @@ uint32_t FAudioSourceVoice_SubmitSourceBuffer(
 uint32_t FAudioSourceVoice_FlushSourceBuffers(
 	FAudioSourceVoice *voice
 ) {
-	FAudioBufferEntry *entry, *next;
 	FAudio_assert(voice->type == FAUDIO_VOICE_SOURCE);
 
+	/* Everything submitted so far gets flushed */
 	FAudio_PlatformLockMutex(voice->src.bufferLock);
+	FAudio_PlatformAtomicSet(&voice->src.bufferFlush, voice->src.bufferHead);
+	FAudio_PlatformUnlockMutex(voice->src.bufferLock);
 
-	/* If the source is playing, don't flush the active buffer */
-	entry = voice->src.bufferList;
-	if (voice->src.active && entry != NULL)
-	{
-		entry = entry->next;
-		voice->src.bufferList->next = NULL;
-	}
-	else
-	{
-		voice->src.curBufferOffset = 0;
-		voice->src.bufferList = NULL;
-	}
-
-	/* Go through each buffer, send an event for each one before deleting */
-	while (entry != NULL)
+	/* If the source is playing, the mixer flushes on its next pass and
+	 * keeps the active buffer. Otherwise it's stopped and we can be the
+	 * consumer ourselves, as long as no mix is in progress.
+	 */
+	if (!voice->src.active)
 	{
-		if (voice->src.callback != NULL && voice->src.callback->OnBufferEnd != NULL)
-		{
-			voice->src.callback->OnBufferEnd(
-				voice->src.callback,
-				entry->buffer.pContext
-			);
-		}
-		next = entry->next;
-		FAudio_free(entry);
-		entry = next;
+		FAudio_PlatformLockMutex(voice->audio->sourceLock);
+		FAudio_INTERNAL_FlushSourceBuffers(voice, NULL, 0);
+		FAudio_PlatformUnlockMutex(voice->audio->sourceLock);
 	}
-
-	FAudio_PlatformUnlockMutex(voice->src.bufferLock);
 	return 0;
 }
 
@@ -1361,17 +1918,20 @@ uint32_t FAudioSourceVoice_ExitLoop(
 	FAudioSourceVoice *voice,
 	uint32_t OperationSet
 ) {
-	FAudio_assert(OperationSet == FAUDIO_COMMIT_NOW);
+	FAudioCommand command;
 	FAudio_assert(voice->type == FAUDIO_VOICE_SOURCE);
 
-	FAudio_PlatformLockMutex(voice->src.bufferLock);
-
-	if (voice->src.bufferList != NULL)
+	if (OperationSet != FAUDIO_COMMIT_NOW)
 	{
-		voice->src.bufferList->buffer.LoopCount = 0;
+		command.type = FAUDIO_COMMAND_EXITLOOP;
+		command.voice = voice;
+		command.index = 0;
+		FAudio_INTERNAL_SubmitCommand(voice->audio, &command, NULL, OperationSet);
+		return 0;
 	}
 
-	FAudio_PlatformUnlockMutex(voice->src.bufferLock);
+	/* The mixer applies this to whatever buffer is playing next pass */
+	FAudio_PlatformAtomicSet(&voice->src.bufferExitLoop, 1);
 	return 0;
 }
 
@@ -1379,22 +1939,22 @@ void FAudioSourceVoice_GetState(
 	FAudioSourceVoice *voice,
 	FAudioVoiceState *pVoiceState
 ) {
-	FAudioBufferEntry *entry;
+	uint32_t tail;
+	FAudioVoiceStats stats;
 	FAudio_assert(voice->type == FAUDIO_VOICE_SOURCE);
 
+	/* Holding bufferLock keeps the API from reusing the tail's slot */
 	FAudio_PlatformLockMutex(voice->src.bufferLock);
 
-	pVoiceState->BuffersQueued = 0;
-	pVoiceState->SamplesPlayed = voice->src.totalSamples;
-	if (voice->src.bufferList != NULL)
+	tail = (uint32_t) FAudio_PlatformAtomicGet(&voice->src.bufferTail);
+	pVoiceState->BuffersQueued = (uint32_t) voice->src.bufferHead - tail;
+	FAudio_INTERNAL_ReadVoiceStats(voice, &stats, NULL, 0);
+	pVoiceState->SamplesPlayed = stats.samplesPlayed;
+	if (pVoiceState->BuffersQueued > 0)
 	{
-		entry = voice->src.bufferList;
-		pVoiceState->pCurrentBufferContext = entry->buffer.pContext;
-		do
-		{
-			pVoiceState->BuffersQueued += 1;
-			entry = entry->next;
-		} while (entry != NULL);
+		pVoiceState->pCurrentBufferContext = voice->src.bufferQueue[
+			tail & (FAUDIO_MAX_QUEUED_BUFFERS - 1)
+		].pContext;
 	}
 	else
 	{
@@ -1409,7 +1969,7 @@ uint32_t FAudioSourceVoice_SetFrequencyRatio(
 	float Ratio,
 	uint32_t OperationSet
 ) {
-	FAudio_assert(OperationSet == FAUDIO_COMMIT_NOW);
+	FAudioCommand command;
 	FAudio_assert(voice->type == FAUDIO_VOICE_SOURCE);
 
 	if (voice->flags & FAUDIO_VOICE_NOPITCH)
@@ -1422,6 +1982,12 @@ uint32_t FAudioSourceVoice_SetFrequencyRatio(
 		FAUDIO_MIN_FREQ_RATIO,
 		voice->src.maxFreqRatio
 	);
+
+	command.type = FAUDIO_COMMAND_SETFREQUENCYRATIO;
+	command.voice = voice;
+	command.index = 0;
+	command.data.value = voice->src.freqRatio;
+	FAudio_INTERNAL_SubmitCommand(voice->audio, &command, NULL, OperationSet);
 	return 0;
 }
 
@@ -1447,7 +2013,7 @@ uint32_t FAudioSourceVoice_SetSourceSampleRate(
 
 	FAudio_PlatformLockMutex(voice->src.bufferLock);
 	if (	voice->audio->version > 7 &&
-		voice->src.bufferList != NULL	)
+		voice->src.bufferHead != FAudio_PlatformAtomicGet(&voice->src.bufferTail)	)
 	{
 		FAudio_PlatformUnlockMutex(voice->src.bufferLock);
 		return FAUDIO_E_INVALID_CALL;
@@ -1463,24 +2029,30 @@ uint32_t FAudioSourceVoice_SetSourceSampleRate(
 		(double) NewSourceSampleRate /
 		(double) voice->audio->master->master.inputSampleRate
 	) + EXTRA_DECODE_PADDING * 2;
-	FAudio_INTERNAL_ResizeDecodeCache(
+	FAudio_INTERNAL_ReserveMixScratch(
 		voice->audio,
-		newDecodeSamples * voice->src.format.nChannels
+		(
+			newDecodeSamples +
+			((voice->src.sincHistory != NULL) ? SINC_HISTORY : 0)
+		) * voice->src.format.nChannels,
+		0,
+		0
 	);
 	voice->src.decodeSamples = newDecodeSamples;
 
-	FAudio_PlatformLockMutex(voice->sendLock);
+	/* SetOutputVoices holds this until its new sends are in */
+	FAudio_PlatformLockMutex(voice->volumeLock);
 
 	if (voice->sends.SendCount == 0)
 	{
-		FAudio_PlatformUnlockMutex(voice->sendLock);
+		FAudio_PlatformUnlockMutex(voice->volumeLock);
 		return 0;
 	}
 	outSampleRate = voice->sends.pSends[0].pOutputVoice->type == FAUDIO_VOICE_MASTER ?
 		voice->sends.pSends[0].pOutputVoice->master.inputSampleRate :
 		voice->sends.pSends[0].pOutputVoice->mix.inputSampleRate;
 
-	FAudio_PlatformUnlockMutex(voice->sendLock);
+	FAudio_PlatformUnlockMutex(voice->volumeLock);
 
 	/* Resize resample cache */
 	newResampleSamples = (uint32_t) FAudio_ceil(
@@ -1488,14 +2060,27 @@ uint32_t FAudioSourceVoice_SetSourceSampleRate(
 		(double) outSampleRate /
 		(double) voice->audio->master->master.inputSampleRate
 	);
-	FAudio_INTERNAL_ResizeResampleCache(
+	FAudio_INTERNAL_ReserveMixScratch(
 		voice->audio,
-		newResampleSamples * voice->src.format.nChannels
+		0,
+		newResampleSamples * voice->src.format.nChannels,
+		0
 	);
 	voice->src.resampleSamples = newResampleSamples;
 	return 0;
 }
 
+uint32_t FAudioSourceVoice_SetPriority(
+	FAudioSourceVoice *voice,
+	uint32_t Priority
+) {
+	FAudio_assert(voice->type == FAUDIO_VOICE_SOURCE);
+
+	/* Read by the mixer without a lock */
+	FAudio_PlatformAtomicSet(&voice->src.priority, (int32_t) Priority);
+	return 0;
+}
+
 /* FAudioMasteringVoice Interface */
 
 FAUDIOAPI uint32_t FAudioMasteringVoice_GetChannelMask(
@@ -215,6 +215,20 @@ typedef struct FAudioVoiceState
 	uint64_t SamplesPlayed;
 } FAudioVoiceState;
 
+/* FAudio extension, see FAudioVoice_GetProfile */
+typedef struct FAudioVoiceProfile
+{
+	uint64_t TicksPerSecond;
+	uint64_t PassCount;
+	uint64_t DecodeTicks;
+	uint64_t ResampleTicks;
+	uint64_t FilterTicks;
+	uint64_t EffectChainTicks;
+	uint64_t SendMixTicks;
+	uint64_t LastPassTicks;
+	uint64_t MaximumPassTicks;
+} FAudioVoiceProfile;
+
 typedef struct FAudioPerformanceData
 {
 	uint64_t AudioCyclesSinceLastQuery;
@@ -284,6 +298,16 @@ typedef struct FAudioDebugConfiguration
 #define FAUDIO_END_OF_STREAM		0x40
 #define FAUDIO_SEND_USEFILTER		0x80
 
+/* FAudio extension: FAudioCreate flag, see FAudio_Render */
+#define FAUDIO_PULL_MODE		0x80000000
+
+/* FAudio extension: source voice flag. Resamples with a 16-tap polyphase
+ * windowed sinc instead of linear interpolation, which keeps aliasing out of
+ * low rate assets at roughly four times the resampling cost. The output is
+ * delayed by 7 source frames.
+ */
+#define FAUDIO_VOICE_SINC_SRC		0x40000000
+
 #define FAUDIO_DEFAULT_FILTER_TYPE	FAudioLowPassFilter
 #define FAUDIO_DEFAULT_FILTER_FREQUENCY	FAUDIO_MAX_FILTER_FREQUENCY
 #define FAUDIO_DEFAULT_FILTER_ONEOVERQ	1.0f
@@ -460,7 +484,7 @@ FAUDIOAPI uint32_t FAudio_StartEngine(FAudio *audio);
 
 FAUDIOAPI void FAudio_StopEngine(FAudio *audio);
 
-FAUDIOAPI uint32_t FAudio_CommitChanges(FAudio *audio);
+FAUDIOAPI uint32_t FAudio_CommitChanges(FAudio *audio, uint32_t OperationSet);
 
 FAUDIOAPI void FAudio_GetPerformanceData(
 	FAudio *audio,
@@ -473,6 +497,108 @@ FAUDIOAPI void FAudio_SetDebugConfiguration(
 	void* pReserved
 );
 
+/* FAudio extension: mix source voices on ThreadCount threads, the audio thread
+ * plus ThreadCount - 1 workers. 0, the default, mixes them serially on the
+ * audio thread. Every nonzero count produces the exact same output, which may
+ * differ from serial mixing by float rounding. Voice callbacks are still only
+ * called from the audio thread.
+ */
+FAUDIOAPI uint32_t FAudio_SetEngineThreadCount(
+	FAudio *audio,
+	uint32_t ThreadCount
+);
+
+/* FAudio extension: keep up to CacheBytes of decoded MSADPCM blocks in an
+ * engine-wide LRU cache shared by all source voices, so that short in-memory
+ * assets played over and over are only decoded once. Blocks are identified
+ * by their address and checked against their encoded data on every hit.
+ * The cache memory is allocated here, and again when a source voice with
+ * bigger blocks is created, so mixing never allocates; the most recently used
+ * blocks that still fit are kept. 0, the default, disables the cache and
+ * frees it.
+ */
+FAUDIOAPI uint32_t FAudio_SetDecodeCacheSize(
+	FAudio *audio,
+	uint32_t CacheBytes
+);
+
+/* FAudio extension: source voices whose every send level is at or below
+ * Threshold (a linear amplitude, so 0.001f is -60 dB) are virtualized: they
+ * keep playing through their buffers and send every buffer and loop callback
+ * on time, but are not decoded, resampled, filtered or mixed. Once a voice is
+ * above the threshold again it resumes mixing from its current position.
+ * Voices with an effect chain are never virtualized. 0 only virtualizes
+ * voices that are completely silent, a negative Threshold (the default)
+ * disables virtualization.
+ */
+FAUDIOAPI uint32_t FAudio_SetVirtualVoiceThreshold(
+	FAudio *audio,
+	float Threshold
+);
+
+/* FAudio extension: when the engine update takes more than MaxLoad of the
+ * time it has to produce a quantum (0.8f is 80% of the device period), shed
+ * work one step at a time: sinc resampled voices fall back to the linear
+ * resampler, then voices of priority 0 skip their filters, then ever louder
+ * voices of priority 0 are virtualized, see FAudio_SetVirtualVoiceThreshold.
+ * Each step is undone once the update is comfortably under MaxLoad again.
+ * 0, the default, disables the governor.
+ */
+FAUDIOAPI uint32_t FAudio_SetLoadGovernor(FAudio *audio, float MaxLoad);
+
+/* FAudio extension: keep up to MaxVoices destroyed source voices around, so
+ * that FAudio_CreateSourceVoice can reuse their locks, buffer queue and
+ * format-sized state for a new voice with the same flags, format tag,
+ * channel count, block alignment and bit depth instead of allocating them
+ * again. Sends and effect chains are always released by DestroyVoice.
+ * 0, the default, disables the pool and frees any voices still in it.
+ */
+FAUDIOAPI uint32_t FAudio_SetSourceVoicePoolSize(
+	FAudio *audio,
+	uint32_t MaxVoices
+);
+
+/* FAudio extension: record a timeline of the engine update, each voice mix,
+ * each effect Process call and the FACT update/streaming work into a ring of
+ * at least EventCount events. Effects skipped for a pass because their
+ * output did not fit the mix scratch are recorded as "FAPO Skipped" instant
+ * events. When the ring is full the oldest events are overwritten. The ring
+ * is allocated by the first call and kept until the engine is released, so
+ * EventCount only matters the first time.
+ */
+FAUDIOAPI uint32_t FAudio_StartTrace(FAudio *audio, uint32_t EventCount);
+
+FAUDIOAPI void FAudio_StopTrace(FAudio *audio);
+
+/* FAudio extension: write the events recorded since the last StartTrace as
+ * Chrome trace JSON, readable by about:tracing and Perfetto. If pBuffer is
+ * NULL, returns a BufferSize that is large enough for the current events.
+ * Otherwise returns the number of bytes written, including the null
+ * terminator. Events that do not fit are left out, the JSON stays valid.
+ * Stop the trace first for a consistent snapshot.
+ */
+FAUDIOAPI uint32_t FAudio_GetTraceJSON(
+	FAudio *audio,
+	char *pBuffer,
+	uint32_t BufferSize
+);
+
+/* FAudio extension: for engines created with FAUDIO_PULL_MODE. No audio
+ * device is opened and the platform's audio subsystem is never started,
+ * instead the host calls this from its own thread to mix FrameCount frames
+ * of interleaved float output. The output format is the mastering voice's
+ * input format, 2 channels at 48000Hz by default. The engine mixes in 10ms
+ * quanta and keeps any unused part of the last one for the next call, so
+ * FrameCount can be anything, and nothing stops the host from rendering
+ * faster than realtime. Must not be called from more than one thread at a
+ * time.
+ */
+FAUDIOAPI uint32_t FAudio_Render(
+	FAudio *audio,
+	float *pOutput,
+	uint32_t FrameCount
+);
+
 /* FAudioVoice Interface */
 
 FAUDIOAPI void FAudioVoice_GetVoiceDetails(
@@ -590,6 +716,20 @@ FAUDIOAPI void FAudioVoice_GetOutputMatrix(
 
 FAUDIOAPI void FAudioVoice_DestroyVoice(FAudioVoice *voice);
 
+/* FAudio extension: get the time this voice has spent in each mix stage since
+ * it was created, in ticks of TicksPerSecond. Decode ticks are only counted
+ * for source voices. pEffectTicks receives the time spent in each of the
+ * first EffectCount effects of the chain, and may be NULL.
+ * Only available when FAudio is built with FAUDIO_PROFILE, otherwise the
+ * outputs are zeroed and FAUDIO_E_INVALID_CALL is returned.
+ */
+FAUDIOAPI uint32_t FAudioVoice_GetProfile(
+	FAudioVoice *voice,
+	FAudioVoiceProfile *pProfile,
+	uint64_t *pEffectTicks,
+	uint32_t EffectCount
+);
+
 /* FAudioSourceVoice Interface */
 
 FAUDIOAPI uint32_t FAudioSourceVoice_Start(
@@ -644,6 +784,15 @@ FAUDIOAPI uint32_t FAudioSourceVoice_SetSourceSampleRate(
 	uint32_t NewSourceSampleRate
 );
 
+/* FAudio extension: voices of priority 0, the default, are the first to have
+ * their filters skipped and to be virtualized when the load governor sheds
+ * work, see FAudio_SetLoadGovernor. Any other priority is left alone.
+ */
+FAUDIOAPI uint32_t FAudioSourceVoice_SetPriority(
+	FAudioSourceVoice *voice,
+	uint32_t Priority
+);
+
 /* FAudioMasteringVoice Interface */
 
 FAUDIOAPI uint32_t FAudioMasteringVoice_GetChannelMask(
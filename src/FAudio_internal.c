@@ -52,20 +52,6 @@ void LinkedList_AddEntry(
 	FAudio_PlatformUnlockMutex(lock);
 }
 
-void LinkedList_PrependEntry(
-	LinkedList **start,
-	void* toAdd,
-	FAudioMutex lock
-) {
-	LinkedList *newEntry;
-	newEntry = (LinkedList*) FAudio_malloc(sizeof(LinkedList));
-	newEntry->entry = toAdd;
-	FAudio_PlatformLockMutex(lock);
-	newEntry->next = *start;
-	*start = newEntry;
-	FAudio_PlatformUnlockMutex(lock);
-}
-
 void LinkedList_RemoveEntry(
 	LinkedList **start,
 	void* toRemove,
@@ -98,6 +84,159 @@ void LinkedList_RemoveEntry(
 	FAudio_assert(0 && "LinkedList element not found!");
 }
 
+uint32_t HandleTable_AddEntry(
+	HandleTable *table,
+	void* toAdd,
+	FAudioMutex lock
+) {
+	uint32_t slot, handle;
+	FAudio_PlatformLockMutex(lock);
+
+	/* Grab a slot, reusing one from a removed entry if we can.
+	 * A zeroed table has no slots yet, whatever freeSlot says.
+	 */
+	if (table->freeSlot != HANDLETABLE_NO_SLOT && table->slotCount > 0)
+	{
+		slot = table->freeSlot;
+		table->freeSlot = table->slots[slot];
+	}
+	else
+	{
+		FAudio_assert(table->slotCount <= HANDLETABLE_SLOT_MASK);
+		slot = table->slotCount++;
+		table->slots = (uint32_t*) FAudio_realloc(
+			table->slots,
+			sizeof(uint32_t) * table->slotCount
+		);
+		table->generations = (uint32_t*) FAudio_realloc(
+			table->generations,
+			sizeof(uint32_t) * table->slotCount
+		);
+		table->generations[slot] = 1;
+		table->freeSlot = HANDLETABLE_NO_SLOT;
+	}
+
+	/* Append to the packed entries */
+	if (table->count == table->capacity)
+	{
+		table->capacity = FAudio_max(16, table->capacity * 2);
+		table->entries = (HandleTableEntry*) FAudio_realloc(
+			table->entries,
+			sizeof(HandleTableEntry) * table->capacity
+		);
+	}
+	handle = (table->generations[slot] << HANDLETABLE_SLOT_BITS) | slot;
+	table->entries[table->count].entry = toAdd;
+	table->entries[table->count].handle = handle;
+	table->entries[table->count].active = 0;
+	table->slots[slot] = table->count;
+	table->count += 1;
+
+	FAudio_PlatformUnlockMutex(lock);
+	return handle;
+}
+
+static void HandleTable_RemoveAt(HandleTable *table, uint32_t index)
+{
+	uint32_t slot;
+
+	/* Retire the slot, bumping its generation (never 0) */
+	slot = table->entries[index].handle & HANDLETABLE_SLOT_MASK;
+	table->generations[slot] = (
+		table->generations[slot] + 1
+	) & HANDLETABLE_GENERATION_MASK;
+	if (table->generations[slot] == 0)
+	{
+		table->generations[slot] = 1;
+	}
+	table->slots[slot] = table->freeSlot;
+	table->freeSlot = slot;
+
+	/* Fill the gap with the last entry */
+	table->count -= 1;
+	if (index < table->count)
+	{
+		table->entries[index] = table->entries[table->count];
+		slot = table->entries[index].handle & HANDLETABLE_SLOT_MASK;
+		table->slots[slot] = index;
+	}
+}
+
+void HandleTable_RemoveEntry(
+	HandleTable *table,
+	uint32_t handle,
+	FAudioMutex lock
+) {
+	uint32_t slot = handle & HANDLETABLE_SLOT_MASK;
+	FAudio_PlatformLockMutex(lock);
+	if (	slot < table->slotCount &&
+		table->generations[slot] == (handle >> HANDLETABLE_SLOT_BITS)	)
+	{
+		HandleTable_RemoveAt(table, table->slots[slot]);
+		FAudio_PlatformUnlockMutex(lock);
+		return;
+	}
+	FAudio_PlatformUnlockMutex(lock);
+	FAudio_assert(0 && "HandleTable handle not found!");
+}
+
+void HandleTable_RemoveValue(
+	HandleTable *table,
+	void* toRemove,
+	FAudioMutex lock
+) {
+	uint32_t i;
+
+	/* For tables whose owners never kept the handles */
+	FAudio_PlatformLockMutex(lock);
+	for (i = 0; i < table->count; i += 1)
+	{
+		if (table->entries[i].entry == toRemove)
+		{
+			HandleTable_RemoveAt(table, i);
+			FAudio_PlatformUnlockMutex(lock);
+			return;
+		}
+	}
+	FAudio_PlatformUnlockMutex(lock);
+	FAudio_assert(0 && "HandleTable element not found!");
+}
+
+void* HandleTable_GetEntry(HandleTable *table, uint32_t handle)
+{
+	uint32_t slot = handle & HANDLETABLE_SLOT_MASK;
+	if (	slot >= table->slotCount ||
+		table->generations[slot] != (handle >> HANDLETABLE_SLOT_BITS)	)
+	{
+		return NULL;
+	}
+	return table->entries[table->slots[slot]].entry;
+}
+
+void HandleTable_SetActive(
+	HandleTable *table,
+	uint32_t handle,
+	uint8_t active,
+	FAudioMutex lock
+) {
+	uint32_t slot = handle & HANDLETABLE_SLOT_MASK;
+	FAudio_PlatformLockMutex(lock);
+	if (	slot < table->slotCount &&
+		table->generations[slot] == (handle >> HANDLETABLE_SLOT_BITS)	)
+	{
+		table->entries[table->slots[slot]].active = active;
+	}
+	FAudio_PlatformUnlockMutex(lock);
+}
+
+void HandleTable_Free(HandleTable *table)
+{
+	FAudio_free(table->entries);
+	FAudio_free(table->slots);
+	FAudio_free(table->generations);
+	FAudio_zero(table, sizeof(HandleTable));
+}
+
 /* Resampling */
 
 /* Okay, so here's what all this fixed-point goo is for:
@@ -149,13 +288,150 @@ void LinkedList_RemoveEntry(
 	((fxd & FIXED_FRACTION_MASK) * (1.0 / FIXED_ONE)) /* Fraction part */ \
 )
 
+static inline FAudioBuffer* FAudio_INTERNAL_GetCurrentBuffer(
+	FAudioSourceVoice *voice
+) {
+	if (FAudio_PlatformAtomicGet(&voice->src.bufferHead) == voice->src.bufferTail)
+	{
+		return NULL;
+	}
+	return &voice->src.bufferQueue[
+		voice->src.bufferTail & (FAUDIO_MAX_QUEUED_BUFFERS - 1)
+	];
+}
+
+static void FAudio_INTERNAL_DispatchVoiceEvent(FAudioVoiceEvent *event)
+{
+	FAudioVoiceCallback *callback = event->voice->src.callback;
+
+	if (callback == NULL)
+	{
+		return;
+	}
+	switch (event->type)
+	{
+	case FAUDIO_EVENT_BUFFERSTART:
+		if (callback->OnBufferStart != NULL)
+		{
+			callback->OnBufferStart(callback, event->context);
+		}
+		break;
+	case FAUDIO_EVENT_BUFFEREND:
+		if (callback->OnBufferEnd != NULL)
+		{
+			callback->OnBufferEnd(callback, event->context);
+		}
+		break;
+	case FAUDIO_EVENT_LOOPEND:
+		if (callback->OnLoopEnd != NULL)
+		{
+			callback->OnLoopEnd(callback, event->context);
+		}
+		break;
+	case FAUDIO_EVENT_STREAMEND:
+		if (callback->OnStreamEnd != NULL)
+		{
+			callback->OnStreamEnd(callback);
+		}
+		break;
+	case FAUDIO_EVENT_PASSEND:
+		if (callback->OnVoiceProcessingPassEnd != NULL)
+		{
+			callback->OnVoiceProcessingPassEnd(callback);
+		}
+		break;
+	default:
+		FAudio_assert(0 && "Unknown voice event!");
+		break;
+	}
+}
+
+static void FAudio_INTERNAL_VoiceEvent(
+	FAudioSourceVoice *voice,
+	FAudioMixPartition *partition,
+	FAudioVoiceEventType type,
+	void *context
+) {
+	FAudioVoiceEvent event;
+
+	if (voice->src.callback == NULL)
+	{
+		return;
+	}
+	event.type = type;
+	event.voice = voice;
+	event.context = context;
+
+	/* Serial mixing calls straight back, parallel mixing has to wait */
+	if (partition == NULL)
+	{
+		FAudio_INTERNAL_DispatchVoiceEvent(&event);
+		return;
+	}
+	if (partition->eventCount == partition->eventCapacity)
+	{
+		/* See MIX_PARTITION_EVENTS, workers can't allocate more */
+		partition->eventOverflow += 1;
+		return;
+	}
+	partition->events[partition->eventCount++] = event;
+}
+
+void FAudio_INTERNAL_FlushSourceBuffers(
+	FAudioSourceVoice *voice,
+	FAudioMixPartition *partition,
+	uint8_t keepCurrent
+) {
+	uint32_t i, tail, flush;
+	FAudioBuffer *queue = voice->src.bufferQueue;
+
+	/* Only ever called by the consumer: the mixer, or an API thread
+	 * holding sourceLock while the voice is stopped.
+	 */
+	tail = (uint32_t) voice->src.bufferTail;
+	flush = (uint32_t) FAudio_PlatformAtomicGet(&voice->src.bufferFlush);
+	if ((int32_t) (flush - tail) <= (int32_t) keepCurrent)
+	{
+		return;
+	}
+
+	/* Send an event for each flushed buffer */
+	for (i = tail + keepCurrent; i != flush; i += 1)
+	{
+		FAudio_INTERNAL_VoiceEvent(
+			voice,
+			partition,
+			FAUDIO_EVENT_BUFFEREND,
+			queue[i & (FAUDIO_MAX_QUEUED_BUFFERS - 1)].pContext
+		);
+	}
+
+	if (keepCurrent)
+	{
+		/* The playing buffer moves up to sit right before the new tail */
+		queue[(flush - 1) & (FAUDIO_MAX_QUEUED_BUFFERS - 1)] =
+			queue[tail & (FAUDIO_MAX_QUEUED_BUFFERS - 1)];
+		FAudio_PlatformAtomicSet(&voice->src.bufferTail, (int32_t) (flush - 1));
+	}
+	else
+	{
+		voice->src.curBufferOffset = 0;
+		voice->src.bufferIdle = 1;
+		voice->src.blockCacheSrc = NULL;
+		FAudio_PlatformAtomicSet(&voice->src.bufferTail, (int32_t) flush);
+	}
+}
+
 static void FAudio_INTERNAL_DecodeBuffers(
 	FAudioSourceVoice *voice,
+	FAudioMixPartition *partition,
+	float *decodeCache,
 	uint64_t *toDecode
 ) {
 	uint32_t end, endRead, decoding, decoded = 0;
-	FAudioBuffer *buffer = &voice->src.bufferList->buffer;
-	FAudioBufferEntry *toDelete;
+	FAudioBuffer *buffer = FAudio_INTERNAL_GetCurrentBuffer(voice);
+	void *context;
+	uint32_t flags;
 
 	/* This should never go past the max ratio size */
 	FAudio_assert(*toDecode <= voice->src.decodeSamples);
@@ -165,12 +441,12 @@ static void FAudio_INTERNAL_DecodeBuffers(
 		decoding = (uint32_t) *toDecode - decoded;
 
 		/* Start-of-buffer behavior */
-		if (	voice->src.curBufferOffset == buffer->PlayBegin &&
-			voice->src.callback != NULL &&
-			voice->src.callback->OnBufferStart != NULL	)
+		if (voice->src.curBufferOffset == buffer->PlayBegin)
 		{
-			voice->src.callback->OnBufferStart(
-				voice->src.callback,
+			FAudio_INTERNAL_VoiceEvent(
+				voice,
+				partition,
+				FAUDIO_EVENT_BUFFERSTART,
 				buffer->pContext
 			);
 		}
@@ -185,15 +461,18 @@ static void FAudio_INTERNAL_DecodeBuffers(
 		);
 
 		/* Decode... */
-		voice->src.decode(
-			buffer,
-			voice->src.curBufferOffset,
-			voice->audio->decodeCache + (
-				decoded * voice->src.format.nChannels
-			),
-			endRead,
-			&voice->src.format
-		);
+		if (decodeCache != NULL)
+		{
+			voice->src.decode(
+				voice,
+				buffer,
+				voice->src.curBufferOffset,
+				decodeCache + (
+					decoded * voice->src.format.nChannels
+				),
+				endRead
+			);
+		}
 
 		voice->src.curBufferOffset += endRead;
 		voice->src.totalSamples += endRead;
@@ -208,14 +487,12 @@ static void FAudio_INTERNAL_DecodeBuffers(
 				{
 					buffer->LoopCount -= 1;
 				}
-				if (	voice->src.callback != NULL &&
-					voice->src.callback->OnLoopEnd != NULL	)
-				{
-					voice->src.callback->OnLoopEnd(
-						voice->src.callback,
-						buffer->pContext
-					);
-				}
+				FAudio_INTERNAL_VoiceEvent(
+					voice,
+					partition,
+					FAUDIO_EVENT_LOOPEND,
+					buffer->pContext
+				);
 			}
 			else
 			{
@@ -226,51 +503,57 @@ static void FAudio_INTERNAL_DecodeBuffers(
 					voice->src.totalSamples = 0;
 				}
 
-				/* Change active buffer, delete finished buffer */
-				toDelete = voice->src.bufferList;
-				voice->src.bufferList = voice->src.bufferList->next;
-				if (voice->src.bufferList != NULL)
+				/* Change active buffer, retire finished buffer.
+				 * Its slot may be reused as soon as the tail moves.
+				 */
+				context = buffer->pContext;
+				flags = buffer->Flags;
+				voice->src.blockCacheSrc = NULL;
+				FAudio_PlatformAtomicSet(
+					&voice->src.bufferTail,
+					(int32_t) ((uint32_t) voice->src.bufferTail + 1)
+				);
+				buffer = FAudio_INTERNAL_GetCurrentBuffer(voice);
+				if (buffer != NULL)
 				{
-					buffer = &voice->src.bufferList->buffer;
 					voice->src.curBufferOffset = buffer->PlayBegin;
 				}
 				else
 				{
-					buffer = NULL;
+					voice->src.bufferIdle = 1;
 
 					/* FIXME: I keep going past the buffer so fuck it */
-					FAudio_zero(
-						voice->audio->decodeCache + (
-							(decoded + endRead) *
-							voice->src.format.nChannels
-						),
-						sizeof(float) * (
-							(decoding - endRead) *
-							voice->src.format.nChannels
-						)
-					);
-				}
-
-				/* Callbacks */
-				if (voice->src.callback != NULL)
-				{
-					if (voice->src.callback->OnBufferEnd != NULL)
-					{
-						voice->src.callback->OnBufferEnd(
-							voice->src.callback,
-							toDelete->buffer.pContext
-						);
-					}
-					if (	toDelete->buffer.Flags & FAUDIO_END_OF_STREAM &&
-						voice->src.callback->OnStreamEnd != NULL	)
+					if (decodeCache != NULL)
 					{
-						voice->src.callback->OnStreamEnd(
-							voice->src.callback
+						FAudio_zero(
+							decodeCache + (
+								(decoded + endRead) *
+								voice->src.format.nChannels
+							),
+							sizeof(float) * (
+								(decoding - endRead) *
+								voice->src.format.nChannels
+							)
 						);
 					}
 				}
 
-				FAudio_free(toDelete);
+				/* Callbacks */
+				FAudio_INTERNAL_VoiceEvent(
+					voice,
+					partition,
+					FAUDIO_EVENT_BUFFEREND,
+					context
+				);
+				if (flags & FAUDIO_END_OF_STREAM)
+				{
+					FAudio_INTERNAL_VoiceEvent(
+						voice,
+						partition,
+						FAUDIO_EVENT_STREAMEND,
+						NULL
+					);
+				}
 			}
 		}
 
@@ -278,6 +561,13 @@ static void FAudio_INTERNAL_DecodeBuffers(
 		decoded += endRead;
 	}
 
+	/* Virtual voices only advance, there is nothing to pad */
+	if (decodeCache == NULL)
+	{
+		*toDecode = decoded;
+		return;
+	}
+
 	/* ... FIXME: I keep going past the buffer so fuck it */
 	if (buffer)
 	{
@@ -290,19 +580,19 @@ static void FAudio_INTERNAL_DecodeBuffers(
 		);
 
 		voice->src.decode(
+			voice,
 			buffer,
 			voice->src.curBufferOffset,
-			voice->audio->decodeCache + (
+			decodeCache + (
 				decoded * voice->src.format.nChannels
 			),
-			endRead,
-			&voice->src.format
+			endRead
 		);
 
 		if (endRead < EXTRA_DECODE_PADDING)
 		{
 			FAudio_zero(
-				voice->audio->decodeCache + (
+				decodeCache + (
 					decoded * voice->src.format.nChannels
 				),
 				sizeof(float) * (
@@ -315,7 +605,7 @@ static void FAudio_INTERNAL_DecodeBuffers(
 	else
 	{
 		FAudio_zero(
-			voice->audio->decodeCache + (
+			decodeCache + (
 				decoded * voice->src.format.nChannels
 			),
 			sizeof(float) * (
@@ -328,53 +618,17 @@ static void FAudio_INTERNAL_DecodeBuffers(
 	*toDecode = decoded;
 }
 
-static void FAudio_INTERNAL_ResamplePCM(
-	FAudioSourceVoice *voice,
-	float **resampleCache,
-	uint64_t toResample
-) {
-	/* Linear Resampler */
-	/* TODO: SSE */
-	uint32_t i, j;
-	float *dCache = voice->audio->decodeCache;
-	uint64_t cur = voice->src.resampleOffset & FIXED_FRACTION_MASK;
-	for (i = 0; i < toResample; i += 1)
-	{
-		for (j = 0; j < voice->src.format.nChannels; j += 1)
-		{
-			/* lerp, then convert to float value */
-			*(*resampleCache)++ = (float) (
-				dCache[j] +
-				(dCache[j + voice->src.format.nChannels] - dCache[j]) *
-				FIXED_TO_DOUBLE(cur)
-			);
-		}
-
-		/* Increment fraction offset by the stepping value */
-		voice->src.resampleOffset += voice->src.resampleStep;
-		cur += voice->src.resampleStep;
-
-		/* Only increment the sample offset by integer values.
-		 * Sometimes this will be 0 until cur accumulates
-		 * enough steps, especially for "slow" rates.
-		 */
-		dCache += (cur >> FIXED_PRECISION) * voice->src.format.nChannels;
-
-		/* Now that any integer has been added, drop it.
-		 * The offset pointer will preserve the total.
-		 */
-		cur &= FIXED_FRACTION_MASK;
-	}
-}
-
-static inline void FAudio_INTERNAL_FilterVoice(
+void FAudio_INTERNAL_FilterVoice_Scalar(
 	const FAudioFilterParameters *filter,
-	FAudioFilterState *filterState,
-	float *samples,
+	float *restrict filterState,
+	float *restrict samples,
 	uint32_t numSamples,
-	uint16_t numChannels)
-{
+	uint16_t numChannels
+) {
 	uint32_t j, ci;
+	float *lowPass = filterState;
+	float *bandPass = filterState + FILTER_STATE_SIZE(numChannels) / 2;
+	float y[4]; /* Indexed by FAudioFilterType */
 
 	/* Apply a digital state-variable filter to the voice.
 	 * The difference equations of the filter are:
@@ -394,26 +648,33 @@ static inline void FAudio_INTERNAL_FilterVoice(
 	for (j = 0; j < numSamples; j += 1)
 	for (ci = 0; ci < numChannels; ci += 1)
 	{
-		filterState[ci][FAudioLowPassFilter] = filterState[ci][FAudioLowPassFilter] + (filter->Frequency * filterState[ci][FAudioBandPassFilter]);
-		filterState[ci][FAudioHighPassFilter] = samples[j * numChannels + ci] - filterState[ci][FAudioLowPassFilter] - (filter->OneOverQ * filterState[ci][FAudioBandPassFilter]);
-		filterState[ci][FAudioBandPassFilter] = (filter->Frequency * filterState[ci][FAudioHighPassFilter]) + filterState[ci][FAudioBandPassFilter];
-		filterState[ci][FAudioNotchFilter] = filterState[ci][FAudioHighPassFilter] + filterState[ci][FAudioLowPassFilter];
-		samples[j * numChannels + ci] = filterState[ci][filter->Type];
+		y[FAudioLowPassFilter] = lowPass[ci] + (filter->Frequency * bandPass[ci]);
+		y[FAudioHighPassFilter] = samples[j * numChannels + ci] - y[FAudioLowPassFilter] - (filter->OneOverQ * bandPass[ci]);
+		y[FAudioBandPassFilter] = (filter->Frequency * y[FAudioHighPassFilter]) + bandPass[ci];
+		y[FAudioNotchFilter] = y[FAudioHighPassFilter] + y[FAudioLowPassFilter];
+		lowPass[ci] = y[FAudioLowPassFilter];
+		bandPass[ci] = y[FAudioBandPassFilter];
+		samples[j * numChannels + ci] = y[filter->Type];
 	}
 }
 
 static inline float *FAudio_INTERNAL_ProcessEffectChain(
 	FAudioVoice *voice,
+	FAudioMixScratch *scratch,
 	uint32_t channels,
 	uint32_t sampleRate,
 	float *buffer,
+	uint32_t bufferSamples,
 	uint32_t samples
 ) {
-	uint32_t i;
+	uint32_t i, capacity;
 	FAPO *fapo;
 	FAudioWaveFormatEx srcFmt, dstFmt;
 	FAPOLockForProcessBufferParameters srcLockParams, dstLockParams;
 	FAPOProcessBufferParameters srcParams, dstParams;
+#ifdef FAUDIO_PROFILE
+	uint64_t stamp;
+#endif
 
 	/* Lock in formats that the APO will expect for processing */
 	srcFmt.wBitsPerSample = 32;
@@ -440,6 +701,7 @@ static inline float *FAudio_INTERNAL_ProcessEffectChain(
 	/* Update parameters, process! */
 	for (i = 0; i < voice->effects.count; i += 1)
 	{
+		PROFILE_MARK(stamp);
 		fapo = voice->effects.desc[i].pEffect;
 
 		if (!voice->effects.inPlaceProcessing[i])
@@ -448,15 +710,26 @@ static inline float *FAudio_INTERNAL_ProcessEffectChain(
 			dstFmt.nBlockAlign = dstFmt.nChannels * (dstFmt.wBitsPerSample / 8);
 			dstFmt.nAvgBytesPerSec = dstFmt.nSamplesPerSec * dstFmt.nBlockAlign;
 			
-			if (dstParams.pBuffer == buffer)
-			{
-				FAudio_INTERNAL_ResizeEffectChainCache(voice->audio, dstFmt.nBlockAlign * samples);
-				dstParams.pBuffer = voice->audio->effectChainCache;
-			}
-			else
+			/* Never write past either buffer. Passing the
+			 * audio through keeps the voice going if the layout
+			 * doesn't change, otherwise it's silent for this pass.
+			 */
+			capacity = (dstParams.pBuffer == buffer) ?
+				scratch->effectChainSamples :
+				bufferSamples;
+			if ((dstFmt.nChannels * samples) > capacity)
 			{
-				dstParams.pBuffer = buffer;
+				TRACE_INSTANT(voice->audio, "FAPO Skipped", fapo);
+				if (dstFmt.nChannels != srcFmt.nChannels)
+				{
+					return NULL;
+				}
+				FAudio_memcpy(&dstFmt, &srcFmt, sizeof(srcFmt));
+				continue;
 			}
+			dstParams.pBuffer = (dstParams.pBuffer == buffer) ?
+				scratch->effectChainCache :
+				buffer;
 		}
 
 		if (voice->effects.parameterUpdates[i])
@@ -475,6 +748,7 @@ static inline float *FAudio_INTERNAL_ProcessEffectChain(
 			1,
 			&dstLockParams
 		);
+		TRACE_BEGIN(voice->audio, "FAPO Process", fapo);
 		fapo->Process(
 			fapo,
 			1,
@@ -483,7 +757,9 @@ static inline float *FAudio_INTERNAL_ProcessEffectChain(
 			&dstParams,
 			voice->effects.desc[i].InitialState
 		);
+		TRACE_END(voice->audio, "FAPO Process", fapo);
 		fapo->UnlockForProcess(fapo);
+		PROFILE_STAGE(voice->effects.profileTicks[i], stamp);
 
 		FAudio_memcpy(&srcFmt, &dstFmt, sizeof(dstFmt));
 		FAudio_memcpy(&srcParams, &dstParams, sizeof(dstParams));
@@ -492,76 +768,368 @@ static inline float *FAudio_INTERNAL_ProcessEffectChain(
 	return (float *) dstParams.pBuffer;
 }
 
-static void FAudio_INTERNAL_MixSource(FAudioSourceVoice *voice)
+void FAudio_INTERNAL_UpdateMixCoefficients(FAudioVoice *voice)
 {
-	/* Iterators */
-	uint32_t i, j, co, ci;
-	/* Decode/Resample variables */
-	uint64_t toDecode;
-	uint64_t toResample;
-	float *resampleCache;
-	/* Output mix variables */
-	float *stream;
-	uint32_t mixed;
-	uint32_t oChan;
-	FAudioVoice *out;
-	uint32_t outputRate;
-	double stepd;
-	float *effectOut;
+	uint32_t i, co, ci, idx, dstChans;
+	float volume;
 
-	/* Calculate the resample stepping value */
-	if (voice->src.resampleFreqRatio != voice->src.freqRatio)
+	/* Caller is applying commands between passes. Only called when a level
+	 * or the sends actually changed, so the mixer just reads the result.
+	 */
+
+	/* Submix volume is applied before effects/filters, not in the sends */
+	volume = (voice->type == FAUDIO_VOICE_SOURCE) ? voice->mixVolume : 1.0f;
+
+	voice->mixPeak = 0.0f;
+	for (i = 0; i < voice->sends.SendCount; i += 1)
 	{
-		FAudio_PlatformLockMutex(voice->sendLock);
-		out = (voice->sends.SendCount == 0) ?
-			voice->audio->master : /* Barf */
-			voice->sends.pSends->pOutputVoice;
-		FAudio_PlatformUnlockMutex(voice->sendLock);
-		outputRate = (out->type == FAUDIO_VOICE_MASTER) ?
-			out->master.inputSampleRate :
-			out->mix.inputSampleRate;
-		stepd = (
-			voice->src.freqRatio *
-			(double) voice->src.format.nSamplesPerSec /
-			(double) outputRate
-		);
-		voice->src.resampleStep = DOUBLE_TO_FIXED(stepd);
-		voice->src.resampleFreqRatio = voice->src.freqRatio;
+		dstChans = (voice->sends.pSends[i].pOutputVoice->type == FAUDIO_VOICE_MASTER) ?
+			voice->sends.pSends[i].pOutputVoice->master.inputChannels :
+			voice->sends.pSends[i].pOutputVoice->mix.inputChannels;
+		for (co = 0; co < dstChans; co += 1)
+		for (ci = 0; ci < voice->outputChannels; ci += 1)
+		{
+			idx = co * voice->outputChannels + ci;
+			voice->mixCoefficients[i][idx] = (
+				voice->mixChannelVolume[ci] *
+				volume *
+				voice->mixSendCoefficients[i][idx]
+			);
+			voice->mixPeak = FAudio_max(
+				voice->mixPeak,
+				FAudio_fabsf(voice->mixCoefficients[i][idx])
+			);
+		}
 	}
+}
 
-	/* Last call for buffer data! */
-	if (	voice->src.callback != NULL &&
-		voice->src.callback->OnVoiceProcessingPassStart != NULL)
+static inline uint32_t FAudio_INTERNAL_BusSamples(FAudioVoice *out)
+{
+	return (out->type == FAUDIO_VOICE_MASTER) ?
+		out->audio->updateSize * out->master.inputChannels :
+		out->mix.inputSamples;
+}
+
+static inline float *FAudio_INTERNAL_GetPartitionBus(
+	FAudioMixPartition *partition,
+	FAudioVoice *out
+) {
+	/* Only zero the buses this partition actually sends to */
+	if (!partition->busUsed[out->busIndex])
 	{
-		voice->src.callback->OnVoiceProcessingPassStart(
-			voice->src.callback,
-			voice->src.decodeSamples * sizeof(int16_t)
+		FAudio_zero(
+			partition->bus + out->busOffset,
+			sizeof(float) * FAudio_INTERNAL_BusSamples(out)
 		);
+		partition->busUsed[out->busIndex] = 1;
 	}
+	return partition->bus + out->busOffset;
+}
 
-	FAudio_PlatformLockMutex(voice->src.bufferLock);
+static void FAudio_INTERNAL_PublishVoiceStats(FAudioVoice *voice)
+{
+	FAudioVoiceStats stats;
+	int32_t words[VOICE_STATS_WORDS];
+	uint32_t i;
+#ifdef FAUDIO_PROFILE
+	int32_t ticks[2];
+#endif
 
-	/* Nothing to do? */
-	if (voice->src.bufferList == NULL)
+	/* See FAudioVoiceStats */
+	FAudio_zero(&stats, sizeof(stats));
+	if (voice->type == FAUDIO_VOICE_SOURCE)
 	{
-		FAudio_PlatformUnlockMutex(voice->src.bufferLock);
-		goto end;
+		stats.samplesPlayed = voice->src.totalSamples;
 	}
+#ifdef FAUDIO_PROFILE
+	stats.profile = voice->profile;
+#endif
+	FAudio_memcpy(words, &stats, sizeof(stats));
 
-	mixed = 0;
-	resampleCache = voice->audio->resampleCache;
-	while (mixed < voice->src.resampleSamples && voice->src.bufferList != NULL)
+	FAudio_PlatformAtomicAdd(&voice->statsSequence, 1);
+	for (i = 0; i < VOICE_STATS_WORDS; i += 1)
 	{
-
-		/* Base decode size, int to fixed... */
-		toDecode = (voice->src.resampleSamples - mixed) * voice->src.resampleStep;
-		/* ... rounded up based on current offset... */
+		FAudio_PlatformAtomicSet(&voice->stats[i], words[i]);
+	}
+#ifdef FAUDIO_PROFILE
+	for (i = 0; i < voice->effects.count; i += 1)
+	{
+		FAudio_memcpy(ticks, &voice->effects.profileTicks[i], sizeof(ticks));
+		FAudio_PlatformAtomicSet(&voice->effects.publishedTicks[i * 2], ticks[0]);
+		FAudio_PlatformAtomicSet(&voice->effects.publishedTicks[i * 2 + 1], ticks[1]);
+	}
+#endif
+	FAudio_PlatformAtomicAdd(&voice->statsSequence, 1);
+}
+
+void FAudio_INTERNAL_ReadVoiceStats(
+	FAudioVoice *voice,
+	FAudioVoiceStats *stats,
+	uint64_t *effectTicks,
+	uint32_t effectCount
+) {
+	int32_t words[VOICE_STATS_WORDS];
+	int32_t sequence;
+	uint32_t i;
+#ifdef FAUDIO_PROFILE
+	int32_t ticks[2];
+#else
+	(void) effectTicks;
+	(void) effectCount;
+#endif
+
+	/* See FAudioVoiceStats. Caller holds commandLock if it wants the
+	 * effect ticks, so the chain can't be swapped out from under us.
+	 */
+	do
+	{
+		sequence = FAudio_PlatformAtomicGet(&voice->statsSequence);
+		for (i = 0; i < VOICE_STATS_WORDS; i += 1)
+		{
+			words[i] = FAudio_PlatformAtomicGet(&voice->stats[i]);
+		}
+#ifdef FAUDIO_PROFILE
+		for (i = 0; i < effectCount; i += 1)
+		{
+			if (i < voice->effects.count)
+			{
+				ticks[0] = FAudio_PlatformAtomicGet(
+					&voice->effects.publishedTicks[i * 2]
+				);
+				ticks[1] = FAudio_PlatformAtomicGet(
+					&voice->effects.publishedTicks[i * 2 + 1]
+				);
+				FAudio_memcpy(&effectTicks[i], ticks, sizeof(ticks));
+			}
+			else
+			{
+				effectTicks[i] = 0;
+			}
+		}
+#endif
+	} while (	(sequence & 1) ||
+			sequence != FAudio_PlatformAtomicGet(&voice->statsSequence)	);
+	FAudio_memcpy(stats, words, sizeof(*stats));
+}
+
+#ifdef FAUDIO_PROFILE
+static inline void FAudio_INTERNAL_ProfilePass(
+	FAudioVoice *voice,
+	uint64_t passStart,
+	uint64_t passEnd
+) {
+	voice->profile.LastPassTicks = passEnd - passStart;
+	if (voice->profile.LastPassTicks > voice->profile.MaximumPassTicks)
+	{
+		voice->profile.MaximumPassTicks = voice->profile.LastPassTicks;
+	}
+}
+#endif
+
+/* Levels from GOVERNOR_SHED_VIRTUAL up virtualize priority 0 voices below
+ * -60 dB, -40 dB and then -20 dB.
+ */
+static const float GOVERNOR_THRESHOLDS[] =
+{
+	0.001f, 0.01f, 0.1f
+};
+
+static void FAudio_INTERNAL_MixSource(
+	FAudioSourceVoice *voice,
+	FAudioMixScratch *scratch,
+	FAudioMixPartition *partition
+) {
+	/* Iterators */
+	uint32_t i;
+	/* Decode/Resample variables */
+	uint64_t toDecode;
+	uint64_t toResample;
+	float *decodeCache;
+	float *resampleCache;
+	/* Output mix variables */
+	float *stream;
+	uint32_t mixed;
+	uint32_t oChan;
+	FAudioVoice *out;
+	uint32_t outputRate;
+	double stepd;
+	float *effectOut;
+	FAudioBuffer *buffer;
+	uint8_t isVirtual;
+	/* Load governor variables */
+	uint32_t level;
+	uint32_t resampleDelay;
+	uint8_t useFilter;
+	float threshold;
+	FAudioResampleCallback resample;
+#ifdef FAUDIO_PROFILE
+	uint64_t passStart, stamp;
+	uint64_t decodeTicks = 0, resampleTicks = 0;
+
+	PROFILE_MARK(passStart);
+#endif
+
+	TRACE_BEGIN(voice->audio, "MixSource", voice);
+
+	/* Calculate the resample stepping value */
+	if (voice->src.resampleFreqRatio != voice->src.mixFreqRatio)
+	{
+		out = (voice->sends.SendCount == 0) ?
+			voice->audio->master : /* Barf */
+			voice->sends.pSends->pOutputVoice;
+		outputRate = (out->type == FAUDIO_VOICE_MASTER) ?
+			out->master.inputSampleRate :
+			out->mix.inputSampleRate;
+		stepd = (
+			voice->src.mixFreqRatio *
+			(double) voice->src.format.nSamplesPerSec /
+			(double) outputRate
+		);
+		voice->src.resampleStep = DOUBLE_TO_FIXED(stepd);
+		voice->src.resampleFreqRatio = voice->src.mixFreqRatio;
+	}
+
+	/* Shed whatever the load governor asks for. The linear resampler
+	 * reads from the sinc kernel's center, so the output does not move.
+	 */
+	level = voice->audio->governorLevel;
+	resample = voice->src.resample;
+	resampleDelay = 0;
+	useFilter = (voice->flags & FAUDIO_VOICE_USEFILTER) != 0;
+	threshold = voice->audio->virtualThreshold;
+	if (level >= GOVERNOR_SHED_RESAMPLER && voice->src.sincHistory != NULL)
+	{
+		resample = voice->src.linearResample;
+		resampleDelay = SINC_DELAY;
+	}
+	if (FAudio_PlatformAtomicGet(&voice->src.priority) == 0)
+	{
+		if (level >= GOVERNOR_SHED_FILTERS)
+		{
+			useFilter = 0;
+		}
+		if (level >= GOVERNOR_SHED_VIRTUAL)
+		{
+			threshold = FAudio_max(
+				threshold,
+				GOVERNOR_THRESHOLDS[level - GOVERNOR_SHED_VIRTUAL]
+			);
+		}
+	}
+
+	/* Too quiet to hear? Then only the playback position moves. Effects
+	 * can add gain or ring on, so those voices always get mixed.
+	 */
+	isVirtual = (
+		threshold >= 0.0f &&
+		voice->mixPeak <= threshold &&
+		voice->effects.count == 0
+	);
+
+	/* Last call for buffer data! Parallel passes make this call up
+	 * front, see FAudio_INTERNAL_MixSourcesParallel.
+	 */
+	if (	partition == NULL &&
+		voice->src.callback != NULL &&
+		voice->src.callback->OnVoiceProcessingPassStart != NULL)
+	{
+		voice->src.callback->OnVoiceProcessingPassStart(
+			voice->src.callback,
+			voice->src.decodeSamples * sizeof(int16_t)
+		);
+	}
+
+	/* Pick up any flush or loop exit requested since the last pass */
+	FAudio_INTERNAL_FlushSourceBuffers(voice, partition, 1);
+	buffer = FAudio_INTERNAL_GetCurrentBuffer(voice);
+	if (FAudio_PlatformAtomicCAS(&voice->src.bufferExitLoop, 1, 0) && buffer != NULL)
+	{
+		buffer->LoopCount = 0;
+	}
+
+	/* Nothing to do? */
+	if (buffer == NULL)
+	{
+		goto end;
+	}
+	if (voice->src.bufferIdle)
+	{
+		voice->src.curBufferOffset = buffer->PlayBegin;
+		voice->src.bufferIdle = 0;
+		if (voice->src.sincHistory != NULL)
+		{
+			FAudio_zero(
+				voice->src.sincHistory,
+				sizeof(float) * SINC_HISTORY * voice->src.format.nChannels
+			);
+		}
+	}
+
+	/* Coming back from virtual, the filter and sinc history are stale */
+	if (voice->src.virtualized && !isVirtual)
+	{
+		if (voice->src.sincHistory != NULL)
+		{
+			FAudio_zero(
+				voice->src.sincHistory,
+				sizeof(float) * SINC_HISTORY * voice->src.format.nChannels
+			);
+		}
+		if (voice->filterState != NULL)
+		{
+			FAudio_zero(
+				voice->filterState,
+				sizeof(float) * FILTER_STATE_SIZE(voice->src.format.nChannels)
+			);
+		}
+	}
+	voice->src.virtualized = isVirtual;
+
+	/* Same for a filter the governor has stopped shedding */
+	if (voice->src.filterShed && useFilter)
+	{
+		FAudio_zero(
+			voice->filterState,
+			sizeof(float) * FILTER_STATE_SIZE(voice->src.format.nChannels)
+		);
+	}
+	voice->src.filterShed = !useFilter;
+
+	mixed = 0;
+	resampleCache = scratch->resampleCache;
+	while (mixed < voice->src.resampleSamples && !voice->src.bufferIdle)
+	{
+
+		/* Base decode size, int to fixed... */
+		toDecode = (voice->src.resampleSamples - mixed) * voice->src.resampleStep;
+		/* ... rounded up based on current offset... */
 		toDecode += voice->src.curBufferOffsetDec + FIXED_FRACTION_MASK;
 		/* ... fixed to int, truncating extra fraction from rounding. */
 		toDecode >>= FIXED_PRECISION;
 
+		/* The sinc taps reach back into the previous decode, so
+		 * those frames go in front of the new ones.
+		 */
+		decodeCache = scratch->decodeCache;
+		if (voice->src.sincHistory != NULL && !isVirtual)
+		{
+			FAudio_memcpy(
+				decodeCache,
+				voice->src.sincHistory,
+				sizeof(float) * SINC_HISTORY * voice->src.format.nChannels
+			);
+			decodeCache += SINC_HISTORY * voice->src.format.nChannels;
+		}
+
 		/* Decode... */
-		FAudio_INTERNAL_DecodeBuffers(voice, &toDecode);
+		PROFILE_MARK(stamp);
+		FAudio_INTERNAL_DecodeBuffers(
+			voice,
+			partition,
+			isVirtual ? NULL : decodeCache,
+			&toDecode
+		);
+		PROFILE_STAGE(decodeTicks, stamp);
 
 		/* int to fixed... */
 		toResample = toDecode << FIXED_PRECISION;
@@ -573,23 +1141,57 @@ static void FAudio_INTERNAL_MixSource(FAudioSourceVoice *voice)
 		toResample = FAudio_min(toResample, voice->src.resampleSamples - mixed);
 
 		/* Resample... */
-		if (voice->src.resampleStep == FIXED_ONE)
+		if (isVirtual)
 		{
-			/* Actually, just copy directly... */
+			/* ... or just keep the phase where mixing would have */
+			voice->src.resampleOffset += toResample * voice->src.resampleStep;
+		}
+		else if (voice->src.resampleStep == FIXED_ONE)
+		{
+			/* Actually, just copy directly... keeping the sinc
+			 * delay, so ratio changes don't make the voice jump.
+			 */
+			if (voice->src.sincHistory != NULL)
+			{
+				decodeCache -= SINC_DELAY * voice->src.format.nChannels;
+			}
 			FAudio_memcpy(
 				resampleCache,
-				voice->audio->decodeCache,
+				decodeCache,
 				(size_t) toResample * voice->src.format.nChannels * sizeof(float)
 			);
 			resampleCache += toResample * voice->src.format.nChannels;
 		}
 		else
 		{
-			FAudio_INTERNAL_ResamplePCM(voice, &resampleCache, toResample);
+			resample(
+				scratch->decodeCache + (
+					resampleDelay * voice->src.format.nChannels
+				),
+				resampleCache,
+				&voice->src.resampleOffset,
+				voice->src.resampleStep,
+				toResample,
+				(uint8_t) voice->src.format.nChannels
+			);
+			resampleCache += toResample * voice->src.format.nChannels;
+		}
+
+		if (voice->src.sincHistory != NULL && !isVirtual)
+		{
+			FAudio_memcpy(
+				voice->src.sincHistory,
+				scratch->decodeCache + (
+					toDecode * voice->src.format.nChannels
+				),
+				sizeof(float) * SINC_HISTORY * voice->src.format.nChannels
+			);
 		}
 
+		PROFILE_STAGE(resampleTicks, stamp);
+
 		/* Update buffer offsets */
-		if (voice->src.bufferList != NULL)
+		if (!voice->src.bufferIdle)
 		{
 			/* Increment fixed offset by resample size, int to fixed... */
 			voice->src.curBufferOffsetDec += toResample * voice->src.resampleStep;
@@ -605,53 +1207,65 @@ static void FAudio_INTERNAL_MixSource(FAudioSourceVoice *voice)
 		/* Finally. */
 		mixed += (uint32_t) toResample;
 	}
-	FAudio_PlatformUnlockMutex(voice->src.bufferLock);
+
+#ifdef FAUDIO_PROFILE
+	voice->profile.PassCount += 1;
+	voice->profile.DecodeTicks += decodeTicks;
+	voice->profile.ResampleTicks += resampleTicks;
+	PROFILE_MARK(stamp);
+#endif
 	if (mixed == 0)
 	{
 		goto end;
 	}
 
-	FAudio_PlatformLockMutex(voice->sendLock);
-
-	/* Nowhere to send it? Just skip resampling...*/
-	if (voice->sends.SendCount == 0)
+	/* Nowhere to send it, or nothing to hear? Just skip the rest...*/
+	if (voice->sends.SendCount == 0 || isVirtual)
 	{
-		FAudio_PlatformUnlockMutex(voice->sendLock);
 		goto end;
 	}
 
+	if (voice->src.resampleStep != FIXED_ONE)
+	{
+		scratch->resamplerCount += 1;
+	}
+
 	/* Filters */
-	if (voice->flags & FAUDIO_VOICE_USEFILTER)
+	if (useFilter)
 	{
-		FAudio_PlatformLockMutex(voice->filterLock);
-		FAudio_INTERNAL_FilterVoice(
-			&voice->filter,
+		FAudio_INTERNAL_Kernels.filterVoice(
+			&voice->mixFilter,
 			voice->filterState,
-			voice->audio->resampleCache,
+			scratch->resampleCache,
 			mixed,
 			voice->src.format.nChannels
 		);
-		FAudio_PlatformUnlockMutex(voice->filterLock);
 	}
+	PROFILE_STAGE(voice->profile.FilterTicks, stamp);
 
 	/* Process effect chain */
-	effectOut = voice->audio->resampleCache;
+	effectOut = scratch->resampleCache;
 
-	FAudio_PlatformLockMutex(voice->effectLock);
 	if (voice->effects.count > 0)
 	{
 		effectOut = FAudio_INTERNAL_ProcessEffectChain(
 			voice,
+			scratch,
 			voice->src.format.nChannels,
 			voice->src.format.nSamplesPerSec,
-			voice->audio->resampleCache,
+			scratch->resampleCache,
+			scratch->resampleSamples,
 			mixed
 		);
 	}
-	FAudio_PlatformUnlockMutex(voice->effectLock);
+	PROFILE_STAGE(voice->profile.EffectChainTicks, stamp);
+	if (effectOut == NULL)
+	{
+		goto end;
+	}
 
 	/* Send float cache to sends */
-	FAudio_PlatformLockMutex(voice->volumeLock);
+	scratch->matrixMixCount += voice->sends.SendCount;
 	for (i = 0; i < voice->sends.SendCount; i += 1)
 	{
 		out = voice->sends.pSends[i].pOutputVoice;
@@ -666,52 +1280,138 @@ static void FAudio_INTERNAL_MixSource(FAudioSourceVoice *voice)
 			oChan = out->mix.inputChannels;
 		}
 
-		/* TODO: SSE */
-		for (j = 0; j < mixed; j += 1)
-		for (co = 0; co < oChan; co += 1)
-		for (ci = 0; ci < voice->outputChannels; ci += 1)
+		/* Parallel mixing writes to the partition's copy of the bus */
+		if (partition != NULL)
 		{
-			/* Include source/channel volumes in the mix! */
-			stream[j * oChan + co] += (
-				effectOut[j * voice->outputChannels + ci] *
-				voice->channelVolume[ci] *
-				voice->volume *
-				voice->sendCoefficients[i][
-					co * voice->outputChannels + ci
-				]
-			);
-			stream[j * oChan + co] = FAudio_clamp(
-				stream[j * oChan + co],
-				-FAUDIO_MAX_VOLUME_LEVEL,
-				FAUDIO_MAX_VOLUME_LEVEL
-			);
+			stream = FAudio_INTERNAL_GetPartitionBus(partition, out);
 		}
-	}
-	FAudio_PlatformUnlockMutex(voice->volumeLock);
 
-	FAudio_PlatformUnlockMutex(voice->sendLock);
+		/* Source/channel volumes are already in the matrix! */
+		voice->sendMix[i](
+			mixed,
+			voice->outputChannels,
+			oChan,
+			effectOut,
+			stream,
+			voice->mixCoefficients[i]
+		);
+	}
+#ifdef FAUDIO_PROFILE
+	PROFILE_STAGE(voice->profile.SendMixTicks, stamp);
+	FAudio_INTERNAL_ProfilePass(voice, passStart, stamp);
+#endif
 
 	/* Done, finally. */
 end:
-	if (	voice->src.callback != NULL &&
-		voice->src.callback->OnVoiceProcessingPassEnd != NULL)
+	FAudio_INTERNAL_PublishVoiceStats(voice);
+	FAudio_INTERNAL_VoiceEvent(
+		voice,
+		partition,
+		FAUDIO_EVENT_PASSEND,
+		NULL
+	);
+	TRACE_END(voice->audio, "MixSource", voice);
+}
+
+/* Submix Resampler */
+
+void FAudio_INTERNAL_InitSubmixSRC(FAudioSubmixVoice *voice)
+{
+	/* Step by whole updates rather than by the exact rate ratio, as the
+	 * input and output sizes are both rounded up. Anything else would
+	 * leave part of a frame behind every update.
+	 */
+	voice->mix.resampleStep = (
+		((uint64_t) (voice->mix.inputSamples / voice->mix.inputChannels))
+		<< FIXED_PRECISION
+	) / voice->mix.outputSamples;
+	voice->mix.resampleOffset = 0;
+	FAudio_zero(
+		voice->mix.resampleHistory,
+		sizeof(float) * voice->mix.inputChannels
+	);
+}
+
+/* Lerps the submix input into output at the fixed rate set up by
+ * FAudio_INTERNAL_InitSubmixSRC. The offset counts from the history frame,
+ * so 0 is the last frame of the previous update and FIXED_ONE is the first
+ * frame of inputCache. Returns the number of frames written.
+ */
+static uint32_t FAudio_INTERNAL_ResampleSubmix(
+	FAudioSubmixVoice *voice,
+	float *restrict output,
+	uint32_t outFrames
+) {
+	uint32_t i, j;
+	double frac;
+	uint64_t toResample;
+	const uint32_t channels = voice->mix.inputChannels;
+	const uint32_t inFrames = voice->mix.inputSamples / channels;
+	const uint64_t inEnd = ((uint64_t) inFrames) << FIXED_PRECISION;
+	const uint64_t step = voice->mix.resampleStep;
+	float *input = voice->mix.inputCache;
+	float *history = voice->mix.resampleHistory;
+	uint64_t cur = voice->mix.resampleOffset;
+
+	/* Frames between the history and the start of this update */
+	for (i = 0; i < outFrames && cur < FIXED_ONE; i += 1)
+	{
+		frac = FIXED_TO_DOUBLE(cur);
+		for (j = 0; j < channels; j += 1)
+		{
+			*output++ = (float) (
+				history[j] +
+				(input[j] - history[j]) * frac
+			);
+		}
+		cur += step;
+	}
+
+	/* Everything else lies within inputCache, so use the SIMD lerp */
+	if (i < outFrames && cur < inEnd)
 	{
-		voice->src.callback->OnVoiceProcessingPassEnd(
-			voice->src.callback
+		toResample = (inEnd - cur + step - 1) / step;
+		toResample = FAudio_min(toResample, outFrames - i);
+		voice->mix.resample(
+			input + ((cur >> FIXED_PRECISION) - 1) * channels,
+			output,
+			&cur,
+			step,
+			toResample,
+			(uint8_t) channels
 		);
+		i += (uint32_t) toResample;
 	}
+
+	/* Carry the last frame and the leftover fraction to the next update */
+	FAudio_memcpy(
+		history,
+		input + (inFrames - 1) * channels,
+		sizeof(float) * channels
+	);
+	voice->mix.resampleOffset = (cur > inEnd) ? (cur - inEnd) : 0;
+	return i;
 }
 
-static void FAudio_INTERNAL_MixSubmix(FAudioSubmixVoice *voice)
-{
-	uint32_t i, j, co, ci;
+static void FAudio_INTERNAL_MixSubmix(
+	FAudioSubmixVoice *voice,
+	FAudioMixScratch *scratch
+) {
+	uint32_t i;
 	float *stream;
 	uint32_t oChan;
 	FAudioVoice *out;
 	uint32_t resampled;
+	float *mixBuffer;
 	float *effectOut;
+#ifdef FAUDIO_PROFILE
+	uint64_t passStart, stamp;
+
+	PROFILE_MARK(passStart);
+	stamp = passStart;
+#endif
 
-	FAudio_PlatformLockMutex(voice->sendLock);
+	TRACE_BEGIN(voice->audio, "MixSubmix", voice);
 
 	/* Nothing to do? */
 	if (voice->sends.SendCount == 0)
@@ -720,60 +1420,84 @@ static void FAudio_INTERNAL_MixSubmix(FAudioSubmixVoice *voice)
 	}
 
 	/* Resample (if necessary) */
-	resampled = FAudio_PlatformResample(
-		voice->mix.resampler,
-		voice->mix.inputCache,
-		voice->mix.inputSamples,
-		voice->audio->resampleCache,
-		voice->mix.outputSamples * voice->mix.inputChannels
-	);
+	if (voice->mix.resampleStep != FIXED_ONE)
+	{
+		resampled = FAudio_INTERNAL_ResampleSubmix(
+			voice,
+			scratch->resampleCache,
+			voice->mix.outputSamples
+		);
+		mixBuffer = scratch->resampleCache;
+		scratch->resamplerCount += 1;
+	}
+	else if (voice->effects.maxChannels <= voice->mix.inputChannels)
+	{
+		/* Same rate, so just work on the input directly. Every other
+		 * out-of-place effect writes back into this buffer, so only do
+		 * this when the widest output in the chain fits.
+		 */
+		resampled = voice->mix.inputSamples / voice->mix.inputChannels;
+		mixBuffer = voice->mix.inputCache;
+	}
+	else
+	{
+		resampled = voice->mix.inputSamples / voice->mix.inputChannels;
+		mixBuffer = scratch->resampleCache;
+		FAudio_memcpy(
+			mixBuffer,
+			voice->mix.inputCache,
+			sizeof(float) * voice->mix.inputSamples
+		);
+	}
 
 	/* Submix overall volume is applied _before_ effects/filters, blech! */
-	if (voice->volume != 1.0f)
-	for (i = 0; i < resampled; i += 1)
+	if (voice->mixVolume != 1.0f)
 	{
-		/* TODO: SSE */
-		voice->audio->resampleCache[i] *= voice->volume;
-		voice->audio->resampleCache[i] = FAudio_clamp(
-			voice->audio->resampleCache[i],
-			-FAUDIO_MAX_VOLUME_LEVEL,
-			FAUDIO_MAX_VOLUME_LEVEL
+		FAudio_INTERNAL_Kernels.applyVolume(
+			mixBuffer,
+			resampled * voice->mix.inputChannels,
+			voice->mixVolume
 		);
 	}
-	resampled /= voice->mix.inputChannels;
+	PROFILE_STAGE(voice->profile.ResampleTicks, stamp);
 
 	/* Filters */
 	if (voice->flags & FAUDIO_VOICE_USEFILTER)
 	{
-		FAudio_PlatformLockMutex(voice->filterLock);
-		FAudio_INTERNAL_FilterVoice(
-			&voice->filter,
+		FAudio_INTERNAL_Kernels.filterVoice(
+			&voice->mixFilter,
 			voice->filterState,
-			voice->audio->resampleCache,
+			mixBuffer,
 			resampled,
 			voice->mix.inputChannels
 		);
-		FAudio_PlatformUnlockMutex(voice->filterLock);
 	}
+	PROFILE_STAGE(voice->profile.FilterTicks, stamp);
 
 	/* Process effect chain */
-	effectOut = voice->audio->resampleCache;
-
-	FAudio_PlatformLockMutex(voice->effectLock);
+	effectOut = mixBuffer;
 	if (voice->effects.count > 0)
 	{
 		effectOut = FAudio_INTERNAL_ProcessEffectChain(
 			voice,
+			scratch,
 			voice->mix.inputChannels,
 			voice->mix.inputSampleRate,
-			voice->audio->resampleCache,
+			mixBuffer,
+			(mixBuffer == voice->mix.inputCache) ?
+				voice->mix.inputSamples :
+				scratch->resampleSamples,
 			resampled
 		);
 	}
-	FAudio_PlatformUnlockMutex(voice->effectLock);
+	PROFILE_STAGE(voice->profile.EffectChainTicks, stamp);
+	if (effectOut == NULL)
+	{
+		goto end;
+	}
 
 	/* Send float cache to sends */
-	FAudio_PlatformLockMutex(voice->volumeLock);
+	scratch->matrixMixCount += voice->sends.SendCount;
 	for (i = 0; i < voice->sends.SendCount; i += 1)
 	{
 		out = voice->sends.pSends[i].pOutputVoice;
@@ -788,855 +1512,5481 @@ static void FAudio_INTERNAL_MixSubmix(FAudioSubmixVoice *voice)
 			oChan = out->mix.inputChannels;
 		}
 
-		/* TODO: SSE */
-		for (j = 0; j < resampled; j += 1)
-		for (co = 0; co < oChan; co += 1)
-		for (ci = 0; ci < voice->outputChannels; ci += 1)
-		{
-			stream[j * oChan + co] += (
-				effectOut[j * voice->outputChannels + ci] *
-				voice->channelVolume[ci] *
-				voice->sendCoefficients[i][
-					co * voice->outputChannels + ci
-				]
-			);
-			stream[j * oChan + co] = FAudio_clamp(
-				stream[j * oChan + co],
-				-FAUDIO_MAX_VOLUME_LEVEL,
-				FAUDIO_MAX_VOLUME_LEVEL
-			);
-		}
+		voice->sendMix[i](
+			resampled,
+			voice->outputChannels,
+			oChan,
+			effectOut,
+			stream,
+			voice->mixCoefficients[i]
+		);
 	}
-	FAudio_PlatformUnlockMutex(voice->volumeLock);
+#ifdef FAUDIO_PROFILE
+	PROFILE_STAGE(voice->profile.SendMixTicks, stamp);
+	voice->profile.PassCount += 1;
+	FAudio_INTERNAL_ProfilePass(voice, passStart, stamp);
+#endif
 
 	/* Zero this at the end, for the next update */
 end:
-	FAudio_PlatformUnlockMutex(voice->sendLock);
+	FAudio_INTERNAL_PublishVoiceStats(voice);
 	FAudio_zero(
 		voice->mix.inputCache,
 		sizeof(float) * voice->mix.inputSamples
 	);
+	TRACE_END(voice->audio, "MixSubmix", voice);
 }
 
-void FAudio_INTERNAL_UpdateEngine(FAudio *audio, float *output)
-{
-	uint32_t i, totalSamples;
-	LinkedList *list;
-	FAudioSourceVoice *source;
-	FAudioSubmixVoice *submix;
-	FAudioEngineCallback *callback;
+/* Worker Pool */
 
-	if (!audio->active)
-	{
-		return;
-	}
+static void FAudio_INTERNAL_DoMixJobs(FAudio *audio, FAudioMixScratch *scratch)
+{
+	uint32_t i;
 
-	/* ProcessingPassStart callbacks */
-	FAudio_PlatformLockMutex(audio->callbackLock);
-	list = audio->callbacks;
-	while (list != NULL)
+	while (1)
 	{
-		callback = (FAudioEngineCallback*) list->entry;
-		if (callback->OnProcessingPassStart != NULL)
+		FAudio_PlatformLockMutex(audio->workerLock);
+		i = audio->nextJob++;
+		FAudio_PlatformUnlockMutex(audio->workerLock);
+		if (i >= audio->jobCount)
 		{
-			callback->OnProcessingPassStart(
-				callback
-			);
+			break;
 		}
-		list = list->next;
+		audio->job(audio, scratch, i);
 	}
-	FAudio_PlatformUnlockMutex(audio->callbackLock);
+}
 
-	/* Writes to master will directly write to output */
-	audio->master->master.output = output;
+static int32_t FAUDIOCALL FAudio_INTERNAL_MixWorkerThread(void *data)
+{
+	FAudioMixWorker *worker = (FAudioMixWorker*) data;
+	FAudio *audio = worker->audio;
 
-	/* Mix sources */
-	FAudio_PlatformLockMutex(audio->sourceLock);
-	list = audio->sources;
-	while (list != NULL)
+	/* Same deal as the FACT thread, match the audio thread priority */
+	FAudio_PlatformThreadPriority(FAUDIO_THREAD_PRIORITY_HIGH);
+
+	while (1)
 	{
-		source = (FAudioSourceVoice*) list->entry;
-		if (source->src.active)
+		FAudio_PlatformWaitSemaphore(audio->workerStart);
+		if (audio->workerQuit)
 		{
-			FAudio_INTERNAL_MixSource(source);
+			break;
 		}
-		list = list->next;
+		FAudio_INTERNAL_DoMixJobs(audio, &worker->scratch);
+		FAudio_PlatformSignalSemaphore(audio->workerDone);
 	}
-	FAudio_PlatformUnlockMutex(audio->sourceLock);
+	return 0;
+}
 
-	/* Mix submixes, ordered by processing stage */
-	FAudio_PlatformLockMutex(audio->submixLock);
-	for (i = 0; i <= audio->submixStages; i += 1)
+#define SCRATCH_ROUNDUP(bytes) \
+	(((bytes) + SCRATCH_ALIGNMENT - 1) & ~((size_t) SCRATCH_ALIGNMENT - 1))
+
+static void FAudio_INTERNAL_FitMixScratch(
+	FAudioMixScratch *scratch,
+	uint32_t decodeSamples,
+	uint32_t resampleSamples,
+	uint32_t effectChainSamples
+) {
+	size_t decodeSize, resampleSize, effectChainSize;
+	uint8_t *base;
+
+	decodeSamples = FAudio_max(decodeSamples, scratch->decodeSamples);
+	resampleSamples = FAudio_max(resampleSamples, scratch->resampleSamples);
+	effectChainSamples = FAudio_max(effectChainSamples, scratch->effectChainSamples);
+	if (	decodeSamples == scratch->decodeSamples &&
+		resampleSamples == scratch->resampleSamples &&
+		effectChainSamples == scratch->effectChainSamples	)
 	{
-		list = audio->submixes;
-		while (list != NULL)
-		{
-			submix = (FAudioSubmixVoice*) list->entry;
-			if (submix->mix.processingStage == i)
-			{
-				FAudio_INTERNAL_MixSubmix(submix);
-			}
-			list = list->next;
-		}
+		return;
 	}
-	FAudio_PlatformUnlockMutex(audio->submixLock);
 
-	/* Apply master volume */
-	totalSamples = audio->updateSize * audio->master->master.inputChannels;
-	if (audio->master->volume != 1.0f)
-	for (i = 0; i < totalSamples; i += 1)
+	/* It's all scratch, so there's nothing to keep from the old arena */
+	decodeSize = SCRATCH_ROUNDUP(sizeof(float) * decodeSamples);
+	resampleSize = SCRATCH_ROUNDUP(sizeof(float) * resampleSamples);
+	effectChainSize = SCRATCH_ROUNDUP(sizeof(float) * effectChainSamples);
+	FAudio_free(scratch->arena);
+	scratch->arena = FAudio_malloc(
+		decodeSize + resampleSize + effectChainSize + SCRATCH_ALIGNMENT - 1
+	);
+	base = (uint8_t*) SCRATCH_ROUNDUP((size_t) scratch->arena);
+
+	scratch->decodeSamples = decodeSamples;
+	scratch->resampleSamples = resampleSamples;
+	scratch->effectChainSamples = effectChainSamples;
+	scratch->decodeCache = (float*) base;
+	scratch->resampleCache = (float*) (base + decodeSize);
+	scratch->effectChainCache = (float*) (base + decodeSize + resampleSize);
+}
+
+static void FAudio_INTERNAL_RunMixJobs(
+	FAudio *audio,
+	FAudioMixJob job,
+	uint32_t count
+) {
+	uint32_t i;
+
+	audio->job = job;
+	audio->jobCount = count;
+	audio->nextJob = 0;
+
+	/* Kick the workers, then help out on this thread */
+	for (i = 0; i < audio->threadCount - 1; i += 1)
 	{
-		/* TODO: SSE */
-		output[i] *= audio->master->volume;
-		output[i] = FAudio_clamp(
-			output[i],
-			-FAUDIO_MAX_VOLUME_LEVEL,
-			FAUDIO_MAX_VOLUME_LEVEL
-		);
+		FAudio_PlatformSignalSemaphore(audio->workerStart);
+	}
+	FAudio_INTERNAL_DoMixJobs(audio, &audio->scratch);
+	for (i = 0; i < audio->threadCount - 1; i += 1)
+	{
+		FAudio_PlatformWaitSemaphore(audio->workerDone);
 	}
+}
 
-	/* Process master effect chain */
-	FAudio_PlatformLockMutex(audio->master->effectLock);
-	if (audio->master->effects.count > 0)
+/* Parallel Source Mixing */
+
+static void FAudio_INTERNAL_MixPartition(
+	FAudio *audio,
+	FAudioMixScratch *scratch,
+	uint32_t index
+) {
+	uint32_t i;
+
+	/* Sources are dealt out round-robin, mixed in queue order */
+	for (i = index; i < audio->mixQueueCount; i += MIX_PARTITIONS)
 	{
-		float *effectOut = FAudio_INTERNAL_ProcessEffectChain(
-			audio->master,
-			audio->master->master.inputChannels,
-			audio->master->master.inputSampleRate,
-			output,
-			audio->updateSize
+		FAudio_INTERNAL_MixSource(
+			audio->mixQueue[i],
+			scratch,
+			&audio->partitions[index]
 		);
+	}
+}
 
-		if (effectOut != output)
+static void FAudio_INTERNAL_MixSourcesParallel(FAudio *audio)
+{
+	uint32_t i, p, j, samples, dropped;
+	uint32_t cursor[MIX_PARTITIONS];
+	FAudioVoice *bus;
+	FAudioSourceVoice *voice;
+	FAudioMixPartition *partition;
+	float *stream, *partial;
+
+	/* Callbacks never run on the workers. This one comes first, so every
+	 * voice still gets its last call for buffer data before it is mixed.
+	 */
+	for (i = 0; i < audio->mixQueueCount; i += 1)
+	{
+		voice = audio->mixQueue[i];
+		if (	voice->src.callback != NULL &&
+			voice->src.callback->OnVoiceProcessingPassStart != NULL)
 		{
-			FAudio_memcpy(
-				output,
-				effectOut,
-				audio->updateSize * audio->master->outputChannels * sizeof(float)
+			voice->src.callback->OnVoiceProcessingPassStart(
+				voice->src.callback,
+				voice->src.decodeSamples * sizeof(int16_t)
 			);
 		}
 	}
-	FAudio_PlatformUnlockMutex(audio->master->effectLock);
 
-	/* OnProcessingPassEnd callbacks */
-	FAudio_PlatformLockMutex(audio->callbackLock);
-	list = audio->callbacks;
-	while (list != NULL)
+	/* The bus layout only changes under submixLock, see LayoutMixBuses */
+	FAudio_PlatformLockMutex(audio->submixLock);
+	for (p = 0; p < MIX_PARTITIONS; p += 1)
 	{
-		callback = (FAudioEngineCallback*) list->entry;
-		if (callback->OnProcessingPassEnd != NULL)
+		partition = &audio->partitions[p];
+		FAudio_zero(partition->busUsed, sizeof(uint8_t) * audio->busCount);
+		partition->eventCount = 0;
+		partition->eventOverflow = 0;
+	}
+
+	FAudio_INTERNAL_RunMixJobs(
+		audio,
+		FAudio_INTERNAL_MixPartition,
+		MIX_PARTITIONS
+	);
+
+	/* Reduce the partitions into the real buses, always in the same order */
+	for (i = 0; i <= audio->submixes.count; i += 1)
+	{
+		if (i == 0)
 		{
-			callback->OnProcessingPassEnd(
-				callback
+			bus = audio->master;
+			stream = bus->master.output;
+		}
+		else
+		{
+			bus = (FAudioVoice*) audio->submixes.entries[i - 1].entry;
+			stream = bus->mix.inputCache;
+		}
+		samples = FAudio_INTERNAL_BusSamples(bus);
+		for (p = 0; p < MIX_PARTITIONS; p += 1)
+		{
+			partition = &audio->partitions[p];
+			if (!partition->busUsed[bus->busIndex])
+			{
+				continue;
+			}
+			partial = partition->bus + bus->busOffset;
+			for (j = 0; j < samples; j += 1)
+			{
+				stream[j] += partial[j];
+				stream[j] = FAudio_clamp(
+					stream[j],
+					-FAUDIO_MAX_VOLUME_LEVEL,
+					FAUDIO_MAX_VOLUME_LEVEL
+				);
+			}
+		}
+	}
+
+	FAudio_PlatformUnlockMutex(audio->submixLock);
+
+	/* Now make the callbacks the workers held back. Each partition mixed
+	 * its voices in queue order, so walking the queue and taking each
+	 * voice's run of events gives the order a serial pass would.
+	 */
+	FAudio_zero(cursor, sizeof(cursor));
+	for (i = 0; i < audio->mixQueueCount; i += 1)
+	{
+		p = i % MIX_PARTITIONS;
+		partition = &audio->partitions[p];
+		while (	cursor[p] < partition->eventCount &&
+			partition->events[cursor[p]].voice == audio->mixQueue[i]	)
+		{
+			FAudio_INTERNAL_DispatchVoiceEvent(
+				&partition->events[cursor[p]]
 			);
+			cursor[p] += 1;
 		}
-		list = list->next;
 	}
-	FAudio_PlatformUnlockMutex(audio->callbackLock);
-}
 
-void FAudio_INTERNAL_ResizeDecodeCache(FAudio *audio, uint32_t samples)
-{
-	if (samples > audio->decodeSamples)
+	dropped = 0;
+	for (p = 0; p < MIX_PARTITIONS; p += 1)
 	{
-		audio->decodeSamples = samples;
-		audio->decodeCache = (float*) FAudio_realloc(
-			audio->decodeCache,
-			sizeof(float) * audio->decodeSamples
-		);
+		dropped += audio->partitions[p].eventOverflow;
+	}
+	if (dropped > 0)
+	{
+		TRACE_INSTANT(audio, "Voice Events Dropped", audio);
+		audio->droppedVoiceEvents += dropped;
 	}
 }
 
-void FAudio_INTERNAL_ResizeResampleCache(FAudio *audio, uint32_t samples)
-{
-	if (samples > audio->resampleSamples)
+static void FAudio_INTERNAL_LockMixBuses(
+	FAudio *audio,
+	uint32_t extraSamples
+) {
+	uint32_t i, p, count, samples;
+	float *bus[MIX_PARTITIONS], *oldBus;
+	uint8_t *busUsed[MIX_PARTITIONS], *oldBusUsed;
+	FAudioMixPartition *partition;
+
+	/* Returns holding submixLock, with partition buses big enough for the
+	 * current master and submixes, plus one more bus of extraSamples if
+	 * that is nonzero. The mixer only uses the buses under submixLock, so
+	 * bigger ones are allocated without it and swapped in.
+	 */
+	for (;;)
 	{
-		audio->resampleSamples = samples;
-		audio->resampleCache = (float*) FAudio_realloc(
-			audio->resampleCache,
-			sizeof(float) * audio->resampleSamples
-		);
+		FAudio_PlatformLockMutex(audio->submixLock);
+		count = (extraSamples > 0) ? 1 : 0;
+		samples = extraSamples;
+		if (audio->master != NULL)
+		{
+			count += 1;
+			samples += FAudio_INTERNAL_BusSamples(audio->master);
+		}
+		for (i = 0; i < audio->submixes.count; i += 1)
+		{
+			count += 1;
+			samples += ((FAudioVoice*) audio->submixes.entries[i].entry)->mix.inputSamples;
+		}
+
+		/* Partitions only exist while there are workers, and only grow */
+		partition = &audio->partitions[0];
+		if (	audio->threadCount == 0 ||
+			(	partition->busSamples >= samples &&
+				partition->busCount >= count	)	)
+		{
+			return;
+		}
+		samples = FAudio_max(partition->busSamples, samples);
+		count = FAudio_max(partition->busCount, count);
+		FAudio_PlatformUnlockMutex(audio->submixLock);
+
+		for (p = 0; p < MIX_PARTITIONS; p += 1)
+		{
+			bus[p] = (float*) FAudio_malloc(sizeof(float) * samples);
+			busUsed[p] = (uint8_t*) FAudio_malloc(sizeof(uint8_t) * count);
+		}
+		FAudio_PlatformLockMutex(audio->submixLock);
+		if (	audio->threadCount > 0 &&
+			partition->busSamples <= samples &&
+			partition->busCount <= count	)
+		{
+			for (p = 0; p < MIX_PARTITIONS; p += 1)
+			{
+				partition = &audio->partitions[p];
+				partition->busSamples = samples;
+				partition->busCount = count;
+				oldBus = partition->bus;
+				oldBusUsed = partition->busUsed;
+				partition->bus = bus[p];
+				partition->busUsed = busUsed[p];
+				bus[p] = oldBus;
+				busUsed[p] = oldBusUsed;
+			}
+		}
+		FAudio_PlatformUnlockMutex(audio->submixLock);
+
+		/* Free the old buses, or ours if others got there first */
+		for (p = 0; p < MIX_PARTITIONS; p += 1)
+		{
+			FAudio_free(bus[p]);
+			FAudio_free(busUsed[p]);
+		}
 	}
 }
 
-void FAudio_INTERNAL_ResizeEffectChainCache(FAudio *audio, uint32_t samples)
+static void FAudio_INTERNAL_AssignMixBuses(FAudio *audio)
 {
-	if (samples > audio->effectChainSamples)
+	uint32_t i;
+	FAudioVoice *voice;
+
+	/* Caller holds submixLock. Master first, then every submix. */
+	audio->busCount = 0;
+	audio->busSamples = 0;
+	if (audio->master != NULL)
 	{
-		audio->effectChainSamples = samples;
-		audio->effectChainCache = (float*)FAudio_realloc(
-			audio->effectChainCache,
-			sizeof(float) * audio->effectChainSamples
-		);
+		audio->master->busIndex = 0;
+		audio->master->busOffset = 0;
+		audio->busCount = 1;
+		audio->busSamples = FAudio_INTERNAL_BusSamples(audio->master);
+	}
+	for (i = 0; i < audio->submixes.count; i += 1)
+	{
+		voice = (FAudioVoice*) audio->submixes.entries[i].entry;
+		voice->busIndex = audio->busCount++;
+		voice->busOffset = audio->busSamples;
+		audio->busSamples += voice->mix.inputSamples;
 	}
+	FAudio_assert(	audio->threadCount == 0 ||
+			audio->busSamples <= audio->partitions[0].busSamples	);
 }
 
-static const float MATRIX_DEFAULTS[8][8][64] =
+void FAudio_INTERNAL_LayoutMixBuses(FAudio *audio)
 {
-	#include "matrix_defaults.inl"
-};
+	FAudio_INTERNAL_LockMixBuses(audio, 0);
+	FAudio_INTERNAL_AssignMixBuses(audio);
+	FAudio_PlatformUnlockMutex(audio->submixLock);
+}
 
-void FAudio_INTERNAL_SetDefaultMatrix(
-	float *matrix,
-	uint32_t srcChannels,
-	uint32_t dstChannels
+void FAudio_INTERNAL_AddSubmixVoice(
+	FAudio *audio,
+	FAudioSubmixVoice *voice
 ) {
-	FAudio_assert(srcChannels > 0 && srcChannels < 9);
-	FAudio_assert(dstChannels > 0 && dstChannels < 9);
-	FAudio_memcpy(
-		matrix,
-		MATRIX_DEFAULTS[srcChannels - 1][dstChannels - 1],
-		srcChannels * dstChannels * sizeof(float)
+	/* The layout has to cover the new bus before the mixer can see it */
+	FAudio_INTERNAL_LockMixBuses(audio, voice->mix.inputSamples);
+	voice->handle = HandleTable_AddEntry(
+		&audio->submixes,
+		voice,
+		audio->submixLock
 	);
+	FAudio_INTERNAL_AssignMixBuses(audio);
+	FAudio_PlatformUnlockMutex(audio->submixLock);
 }
 
-void FAudio_INTERNAL_AllocEffectChain(
-	FAudioVoice *voice,
-	const FAudioEffectChain *pEffectChain
+void FAudio_INTERNAL_RemoveSubmixVoice(FAudioSubmixVoice *voice)
+{
+	FAudio *audio = voice->audio;
+	FAudio_PlatformLockMutex(audio->submixLock);
+	HandleTable_RemoveEntry(
+		&audio->submixes,
+		voice->handle,
+		audio->submixLock
+	);
+	FAudio_INTERNAL_AssignMixBuses(audio);
+	FAudio_PlatformUnlockMutex(audio->submixLock);
+}
+
+static FAudioVoiceEvent *FAudio_INTERNAL_SetPartitionEvents(
+	FAudio *audio,
+	FAudioVoiceEvent *events
 ) {
-	uint32_t i;
+	uint32_t p, count;
+	FAudioVoiceEvent *old;
 
-	voice->effects.count = pEffectChain->EffectCount;
-	if (voice->effects.count == 0)
+	/* Caller holds sourceLock, so no partition is mixing */
+	count = MIX_PARTITION_EVENTS(audio->mixQueueCapacity);
+	for (p = 0; p < MIX_PARTITIONS; p += 1)
 	{
-		return;
+		audio->partitions[p].events = (events != NULL) ?
+			events + (p * count) :
+			NULL;
+		audio->partitions[p].eventCapacity = (events != NULL) ? count : 0;
+		audio->partitions[p].eventCount = 0;
 	}
+	old = audio->partitionEvents;
+	audio->partitionEvents = events;
+	return old;
+}
 
-	for (i = 0; i < pEffectChain->EffectCount; i += 1)
+/* Submix Execution Plan */
+
+static uint32_t FAudio_INTERNAL_FindTask(uint32_t *task, uint32_t i)
+{
+	while (task[i] != i)
 	{
-		pEffectChain->pEffectDescriptors[i].pEffect->AddRef(pEffectChain->pEffectDescriptors[i].pEffect);
+		task[i] = task[task[i]];
+		i = task[i];
 	}
+	return i;
+}
 
-	voice->effects.desc = (FAudioEffectDescriptor*) FAudio_malloc(
-		voice->effects.count * sizeof(FAudioEffectDescriptor)
-	);
-	FAudio_memcpy(
-		voice->effects.desc,
-		pEffectChain->pEffectDescriptors,
-		voice->effects.count * sizeof(FAudioEffectDescriptor)
-	);
-	#define ALLOC_EFFECT_PROPERTY(prop, type) \
-		voice->effects.prop = (type*) FAudio_malloc( \
-			voice->effects.count * sizeof(type) \
-		); \
-		FAudio_zero( \
-			voice->effects.prop, \
-			voice->effects.count * sizeof(type) \
-		);
-	ALLOC_EFFECT_PROPERTY(parameters, void*)
-	ALLOC_EFFECT_PROPERTY(parameterSizes, uint32_t)
-	ALLOC_EFFECT_PROPERTY(parameterUpdates, uint8_t)
-	ALLOC_EFFECT_PROPERTY(inPlaceProcessing, uint8_t)
-	#undef ALLOC_EFFECT_PROPERTY
+static uint8_t FAudio_INTERNAL_SharesOutput(FAudioVoice *a, FAudioVoice *b)
+{
+	uint32_t i, j;
+	for (i = 0; i < a->sends.SendCount; i += 1)
+	for (j = 0; j < b->sends.SendCount; j += 1)
+	{
+		if (a->sends.pSends[i].pOutputVoice == b->sends.pSends[j].pOutputVoice)
+		{
+			return 1;
+		}
+	}
+	return 0;
 }
 
-void FAudio_INTERNAL_FreeEffectChain(FAudioVoice *voice)
+void FAudio_INTERNAL_BuildSubmixPlan(FAudio *audio)
 {
-	uint32_t i;
+	uint32_t i, j, k, m, root, count, stageStart, taskCount, stageCount;
+	uint32_t *task;
+	FAudioSubmixVoice *submix;
+	FAudioSubmixVoice **sorted;
 
-	if (voice->effects.count == 0)
+	/* The sends only change under commandLock, which goes before submixLock */
+	FAudio_PlatformLockMutex(audio->commandLock);
+	FAudio_PlatformLockMutex(audio->submixLock);
+	FAudio_free(audio->submixPlan);
+	FAudio_free(audio->submixTasks);
+	FAudio_free(audio->submixStageTasks);
+	audio->submixPlan = NULL;
+	audio->submixTasks = NULL;
+	audio->submixStageTasks = NULL;
+	audio->submixStageCount = 0;
+
+	count = audio->submixes.count;
+	if (count == 0)
 	{
+		FAudio_PlatformUnlockMutex(audio->submixLock);
+		FAudio_PlatformUnlockMutex(audio->commandLock);
 		return;
 	}
 
-	for (i = 0; i < voice->effects.count; i += 1)
+	/* Stable sort by processing stage, so table order is kept within a stage */
+	sorted = (FAudioSubmixVoice**) FAudio_malloc(
+		sizeof(FAudioSubmixVoice*) * count
+	);
+	for (i = 0; i < count; i += 1)
 	{
-		voice->effects.desc[i].pEffect->Release(voice->effects.desc[i].pEffect);
+		submix = (FAudioSubmixVoice*) audio->submixes.entries[i].entry;
+		j = i;
+		while (j > 0 && sorted[j - 1]->mix.processingStage > submix->mix.processingStage)
+		{
+			sorted[j] = sorted[j - 1];
+			j -= 1;
+		}
+		sorted[j] = submix;
 	}
 
-	FAudio_free(voice->effects.desc);
-	FAudio_free(voice->effects.parameters);
-	FAudio_free(voice->effects.parameterSizes);
-	FAudio_free(voice->effects.parameterUpdates);
-	FAudio_free(voice->effects.inPlaceProcessing);
-}
+	/* Submixes in a stage that share an output have to run serially, in
+	 * table order, so that output is always summed the same way. Group
+	 * them into one task; separate tasks can then run in parallel.
+	 */
+	task = (uint32_t*) FAudio_malloc(sizeof(uint32_t) * count);
+	for (i = 0; i < count; i += 1)
+	{
+		task[i] = i;
+	}
+	for (stageStart = 0; stageStart < count; stageStart = j)
+	{
+		j = stageStart + 1;
+		while (	j < count &&
+			sorted[j]->mix.processingStage == sorted[stageStart]->mix.processingStage	)
+		{
+			j += 1;
+		}
+		for (i = stageStart; i < j; i += 1)
+		for (k = i + 1; k < j; k += 1)
+		{
+			if (FAudio_INTERNAL_SharesOutput(sorted[i], sorted[k]))
+			{
+				m = FAudio_INTERNAL_FindTask(task, i);
+				root = FAudio_INTERNAL_FindTask(task, k);
+				task[FAudio_max(m, root)] = FAudio_min(m, root);
+			}
+		}
+	}
 
-/* PCM Decoding */
+	/* Lay out the plan: stage by stage, task by task, table order within */
+	audio->submixPlan = (FAudioSubmixVoice**) FAudio_malloc(
+		sizeof(FAudioSubmixVoice*) * count
+	);
+	audio->submixTasks = (uint32_t*) FAudio_malloc(
+		sizeof(uint32_t) * (count + 1)
+	);
+	audio->submixStageTasks = (uint32_t*) FAudio_malloc(
+		sizeof(uint32_t) * (count + 1)
+	);
+	k = 0;
+	taskCount = 0;
+	stageCount = 0;
+	for (stageStart = 0; stageStart < count; stageStart = j)
+	{
+		j = stageStart + 1;
+		while (	j < count &&
+			sorted[j]->mix.processingStage == sorted[stageStart]->mix.processingStage	)
+		{
+			j += 1;
+		}
+		audio->submixStageTasks[stageCount++] = taskCount;
+		for (i = stageStart; i < j; i += 1)
+		{
+			/* Tasks are rooted at their first member */
+			if (FAudio_INTERNAL_FindTask(task, i) != i)
+			{
+				continue;
+			}
+			audio->submixTasks[taskCount++] = k;
+			for (m = i; m < j; m += 1)
+			{
+				if (FAudio_INTERNAL_FindTask(task, m) == i)
+				{
+					audio->submixPlan[k++] = sorted[m];
+				}
+			}
+		}
+	}
+	audio->submixTasks[taskCount] = k;
+	audio->submixStageTasks[stageCount] = taskCount;
+	audio->submixStageCount = stageCount;
 
-void (*FAudio_INTERNAL_Convert_U8_To_F32)(
-	const uint8_t *restrict src,
-	float *restrict dst,
-	uint32_t len
-);
-void (*FAudio_INTERNAL_Convert_S16_To_F32)(
-	const int16_t *restrict src,
-	float *restrict dst,
-	uint32_t len
-);
+	FAudio_free(task);
+	FAudio_free(sorted);
+	FAudio_PlatformUnlockMutex(audio->submixLock);
+	FAudio_PlatformUnlockMutex(audio->commandLock);
+}
 
-void FAudio_INTERNAL_DecodePCM8(
-	FAudioBuffer *buffer,
-	uint32_t curOffset,
-	float *decodeCache,
-	uint32_t samples,
-	FAudioWaveFormatEx *format
+static void FAudio_INTERNAL_MixSubmixTask(
+	FAudio *audio,
+	FAudioMixScratch *scratch,
+	uint32_t index
 ) {
-	FAudio_INTERNAL_Convert_U8_To_F32(
-		((uint8_t*) buffer->pAudioData) + (
-			curOffset * format->nChannels
-		),
-		decodeCache,
-		samples * format->nChannels
-	);
+	uint32_t i, task;
+	task = audio->submixStageTasks[audio->jobStage] + index;
+	for (i = audio->submixTasks[task]; i < audio->submixTasks[task + 1]; i += 1)
+	{
+		FAudio_INTERNAL_MixSubmix(audio->submixPlan[i], scratch);
+	}
 }
 
-void FAudio_INTERNAL_DecodePCM16(
-	FAudioBuffer *buffer,
-	uint32_t curOffset,
-	float *decodeCache,
-	uint32_t samples,
-	FAudioWaveFormatEx *format
-) {
-	FAudio_INTERNAL_Convert_S16_To_F32(
-		((int16_t*) buffer->pAudioData) + (
-			curOffset * format->nChannels
-		),
-		decodeCache,
-		samples * format->nChannels
+void FAudio_INTERNAL_StartMixWorkers(FAudio *audio, uint32_t threadCount)
+{
+	uint32_t i;
+
+	audio->threadCount = threadCount;
+	if (threadCount == 0)
+	{
+		return;
+	}
+
+	audio->workerQuit = 0;
+	audio->workerStart = FAudio_PlatformCreateSemaphore(0);
+	audio->workerDone = FAudio_PlatformCreateSemaphore(0);
+	audio->workerLock = FAudio_PlatformCreateMutex();
+
+	/* The audio thread does its share, so spawn one less than asked */
+	audio->workers = (FAudioMixWorker*) FAudio_malloc(
+		sizeof(FAudioMixWorker) * (threadCount - 1)
 	);
-}
+	FAudio_zero(audio->workers, sizeof(FAudioMixWorker) * (threadCount - 1));
+	for (i = 0; i < threadCount - 1; i += 1)
+	{
+		audio->workers[i].audio = audio;
+		FAudio_INTERNAL_FitMixScratch(
+			&audio->workers[i].scratch,
+			audio->scratch.decodeSamples,
+			audio->scratch.resampleSamples,
+			audio->scratch.effectChainSamples
+		);
+		audio->workers[i].thread = FAudio_PlatformCreateThread(
+			FAudio_INTERNAL_MixWorkerThread,
+			"FAudio Mix Worker",
+			&audio->workers[i]
+		);
+	}
 
-void FAudio_INTERNAL_DecodePCM32F(
-	FAudioBuffer *buffer,
-	uint32_t curOffset,
-	float *decodeCache,
-	uint32_t samples,
-	FAudioWaveFormatEx *format
-) {
-	FAudio_memcpy(
-		decodeCache,
-		((float*) buffer->pAudioData) + (
-			curOffset * format->nChannels
-		),
-		sizeof(float) * samples * format->nChannels
+	/* Caller holds sourceLock and submixLock, see SetEngineThreadCount */
+	FAudio_INTERNAL_SetPartitionEvents(
+		audio,
+		(FAudioVoiceEvent*) FAudio_malloc(
+			sizeof(FAudioVoiceEvent) *
+			MIX_PARTITION_EVENTS(audio->mixQueueCapacity) *
+			MIX_PARTITIONS
+		)
 	);
+	FAudio_INTERNAL_LayoutMixBuses(audio);
 }
 
-/* MSADPCM Decoding */
+void FAudio_INTERNAL_StopMixWorkers(FAudio *audio)
+{
+	uint32_t i;
 
-static inline int16_t FAudio_INTERNAL_ParseNibble(
-	uint8_t nibble,
-	uint8_t predictor,
-	int16_t *delta,
-	int16_t *sample1,
-	int16_t *sample2
-) {
-	static const int32_t AdaptionTable[16] =
+	if (audio->threadCount == 0)
 	{
-		230, 230, 230, 230, 307, 409, 512, 614,
-		768, 614, 512, 409, 307, 230, 230, 230
-	};
-	static const int32_t AdaptCoeff_1[7] =
+		return;
+	}
+
+	audio->workerQuit = 1;
+	for (i = 0; i < audio->threadCount - 1; i += 1)
 	{
-		256, 512, 0, 192, 240, 460, 392
-	};
-	static const int32_t AdaptCoeff_2[7] =
+		FAudio_PlatformSignalSemaphore(audio->workerStart);
+	}
+	for (i = 0; i < audio->threadCount - 1; i += 1)
 	{
-		0, -256, 0, 64, 0, -208, -232
-	};
+		FAudio_PlatformWaitThread(audio->workers[i].thread, NULL);
+		FAudio_free(audio->workers[i].scratch.arena);
+	}
+	FAudio_free(audio->workers);
+	audio->workers = NULL;
 
-	int8_t signedNibble;
-	int32_t sampleInt;
-	int16_t sample;
+	FAudio_PlatformDestroySemaphore(audio->workerStart);
+	FAudio_PlatformDestroySemaphore(audio->workerDone);
+	FAudio_PlatformDestroyMutex(audio->workerLock);
 
-	signedNibble = (int8_t) nibble;
-	if (signedNibble & 0x08)
+	for (i = 0; i < MIX_PARTITIONS; i += 1)
 	{
-		signedNibble -= 0x10;
+		FAudio_free(audio->partitions[i].bus);
+		FAudio_free(audio->partitions[i].busUsed);
 	}
+	FAudio_free(audio->partitionEvents);
+	audio->partitionEvents = NULL;
+	FAudio_zero(audio->partitions, sizeof(audio->partitions));
+	audio->threadCount = 0;
+}
 
-	sampleInt = (
-		(*sample1 * AdaptCoeff_1[predictor]) +
-		(*sample2 * AdaptCoeff_2[predictor])
-	) / 256;
-	sampleInt += signedNibble * (*delta);
-	sample = FAudio_clamp(sampleInt, -32768, 32767);
+/* Command Queue */
 
-	*sample2 = *sample1;
-	*sample1 = sample;
-	*delta = (int16_t) (AdaptionTable[nibble] * (int32_t) (*delta) / 256);
-	if (*delta < 16)
+void FAudio_INTERNAL_PushCommand(
+	FAudio *audio,
+	FAudioCommand *command,
+	const void *payload
+) {
+	uint32_t pos;
+	int32_t diff;
+	FAudioCommand *cell;
+
+	/* Claim a cell. Each cell's sequence says whose turn it is: equal to
+	 * pos when it is free for this lap, pos + 1 once it is published.
+	 * Positions wrap, so compare them as a signed distance.
+	 */
+	pos = (uint32_t) FAudio_PlatformAtomicGet(&audio->commandHead);
+	for (;;)
 	{
-		*delta = 16;
+		cell = &audio->commands[pos & (COMMAND_RING_SIZE - 1)];
+		diff = (int32_t) (
+			(uint32_t) FAudio_PlatformAtomicGet(&cell->sequence) - pos
+		);
+		if (diff == 0)
+		{
+			if (FAudio_PlatformAtomicCAS(
+				&audio->commandHead,
+				(int32_t) pos,
+				(int32_t) (pos + 1)
+			)) {
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			/* Full: the mixer is stopped or far behind, apply it all now */
+			FAudio_INTERNAL_FlushCommands(audio);
+		}
+		pos = (uint32_t) FAudio_PlatformAtomicGet(&audio->commandHead);
 	}
-	return sample;
+
+	/* The cell is ours until it is published. Its storage only grows
+	 * when a payload outsizes it, and is kept for the cell's next lap.
+	 */
+	if (payload != NULL)
+	{
+		if (command->data.block.size > cell->payloadCapacity)
+		{
+			if (cell->payloadCapacity > COMMAND_PAYLOAD_SIZE)
+			{
+				FAudio_free(cell->payload);
+			}
+			cell->payloadCapacity = command->data.block.size;
+			cell->payload = (uint8_t*) FAudio_malloc(
+				cell->payloadCapacity
+			);
+		}
+		FAudio_memcpy(cell->payload, payload, command->data.block.size);
+	}
+
+	cell->type = command->type;
+	cell->voice = command->voice;
+	cell->index = command->index;
+	cell->data = command->data;
+	FAudio_PlatformAtomicSet(&cell->sequence, (int32_t) (pos + 1));
 }
 
-#define READ(item, type) \
-	item = *((type*) *buf); \
-	*buf += sizeof(type);
+/* Tracing */
 
-static inline void FAudio_INTERNAL_DecodeMonoMSADPCMBlock(
-	uint8_t **buf,
-	int16_t *blockCache,
-	uint32_t align
+void FAudio_INTERNAL_Trace(
+	FAudio *audio,
+	const char *name,
+	const void *object,
+	char phase
 ) {
-	uint32_t i;
+	uint32_t pos;
+	int32_t sequence;
+	FAudioTraceRing *ring;
+	FAudioTraceEvent *event;
 
-	/* Temp storage for ADPCM blocks */
-	uint8_t predictor;
-	int16_t delta;
-	int16_t sample1;
-	int16_t sample2;
+	if (!FAudio_PlatformAtomicGet(&audio->tracing))
+	{
+		return;
+	}
+	ring = (FAudioTraceRing*) FAudio_PlatformAtomicGetPtr(&audio->traceRing);
+	if (ring == NULL)
+	{
+		return;
+	}
 
-	/* Preamble */
-	READ(predictor, uint8_t)
-	READ(delta, int16_t)
-	READ(sample1, int16_t)
-	READ(sample2, int16_t)
-	align -= 7;
+	pos = (uint32_t) FAudio_PlatformAtomicAdd(&audio->traceHead, 1);
+	if ((int32_t) (pos + 1) == TRACE_CELL_BUSY)
+	{
+		/* Once every 2^32 events the sequence would look busy */
+		return;
+	}
 
-	/* Samples */
-	*blockCache++ = sample2;
-	*blockCache++ = sample1;
-	for (i = 0; i < align; i += 1, *buf += 1)
+	/* Claim the cell, unless a writer that lapped us owns it or is done */
+	event = &ring->events[pos & ring->mask];
+	sequence = FAudio_PlatformAtomicGet(&event->sequence);
+	if (	sequence == TRACE_CELL_BUSY ||
+		(int32_t) ((uint32_t) sequence - (pos + 1)) >= 0 ||
+		!FAudio_PlatformAtomicCAS(&event->sequence, sequence, TRACE_CELL_BUSY)	)
 	{
-		*blockCache++ = FAudio_INTERNAL_ParseNibble(
-			*(*buf) >> 4,
-			predictor,
-			&delta,
-			&sample1,
-			&sample2
-		);
-		*blockCache++ = FAudio_INTERNAL_ParseNibble(
-			*(*buf) & 0x0F,
-			predictor,
-			&delta,
-			&sample1,
-			&sample2
-		);
+		return;
 	}
+	event->phase = phase;
+	event->name = name;
+	event->object = object;
+	event->thread = FAudio_PlatformGetThreadID();
+	event->time = FAudio_timecounter();
+	FAudio_PlatformAtomicSet(&event->sequence, (int32_t) (pos + 1));
 }
 
-static inline void FAudio_INTERNAL_DecodeStereoMSADPCMBlock(
-	uint8_t **buf,
-	int16_t *blockCache,
-	uint32_t align
+uint32_t FAudio_INTERNAL_WriteTraceJSON(
+	FAudio *audio,
+	char *buffer,
+	uint32_t bufferSize
 ) {
-	uint32_t i;
-
-	/* Temp storage for ADPCM blocks */
-	uint8_t l_predictor;
-	uint8_t r_predictor;
-	int16_t l_delta;
-	int16_t r_delta;
-	int16_t l_sample1;
-	int16_t r_sample1;
-	int16_t l_sample2;
-	int16_t r_sample2;
-
-	/* Preamble */
-	READ(l_predictor, uint8_t)
-	READ(r_predictor, uint8_t)
-	READ(l_delta, int16_t)
-	READ(r_delta, int16_t)
-	READ(l_sample1, int16_t)
-	READ(r_sample1, int16_t)
-	READ(l_sample2, int16_t)
-	READ(r_sample2, int16_t)
-	align -= 14;
+	static const char header[] = "{\"traceEvents\":[\n";
+	static const char footer[] = "\n],\"displayTimeUnit\":\"ms\"}\n";
+	char line[TRACE_EVENT_JSON_MAX];
+	FAudioTraceEvent event;
+	FAudioTraceEvent *cell;
+	FAudioTraceRing *ring;
+	uint32_t pos, head, len, written, first;
+	double frequency;
+
+	ring = (FAudioTraceRing*) FAudio_PlatformAtomicGetPtr(&audio->traceRing);
+	if (ring == NULL)
+	{
+		head = 0;
+		pos = 0;
+	}
+	else
+	{
+		head = (uint32_t) FAudio_PlatformAtomicGet(&audio->traceHead);
+		pos = audio->traceStart;
+		if ((head - pos) > (ring->mask + 1))
+		{
+			/* The oldest events have been overwritten */
+			pos = head - (ring->mask + 1);
+		}
+	}
 
-	/* Samples */
-	*blockCache++ = l_sample2;
-	*blockCache++ = r_sample2;
-	*blockCache++ = l_sample1;
-	*blockCache++ = r_sample1;
-	for (i = 0; i < align; i += 1, *buf += 1)
+	if (buffer == NULL)
 	{
-		*blockCache++ = FAudio_INTERNAL_ParseNibble(
-			*(*buf) >> 4,
-			l_predictor,
-			&l_delta,
-			&l_sample1,
-			&l_sample2
+		return (
+			sizeof(header) - 1 +
+			(head - pos) * TRACE_EVENT_JSON_MAX +
+			sizeof(footer)
 		);
-		*blockCache++ = FAudio_INTERNAL_ParseNibble(
-			*(*buf) & 0x0F,
-			r_predictor,
-			&r_delta,
-			&r_sample1,
-			&r_sample2
+	}
+	if (bufferSize < (sizeof(header) - 1 + sizeof(footer)))
+	{
+		return 0;
+	}
+
+	FAudio_memcpy(buffer, header, sizeof(header) - 1);
+	written = sizeof(header) - 1;
+	frequency = (double) FAudio_timefrequency() / 1000000.0;
+	first = 1;
+	for (; pos != head; pos += 1)
+	{
+		/* Skip anything that is mid-write or was lapped while we read */
+		cell = &ring->events[pos & ring->mask];
+		if ((uint32_t) FAudio_PlatformAtomicGet(&cell->sequence) != pos + 1)
+		{
+			continue;
+		}
+		FAudio_memcpy(&event, cell, sizeof(FAudioTraceEvent));
+		if ((uint32_t) FAudio_PlatformAtomicGet(&cell->sequence) != pos + 1)
+		{
+			continue;
+		}
+
+		len = FAudio_snprintf(
+			line,
+			sizeof(line),
+			"%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,"
+			"\"tid\":%llu,\"ts\":%.3f,"
+			"\"args\":{\"object\":\"%p\"}}",
+			first ? "" : ",\n",
+			event.name,
+			event.phase,
+			(unsigned long long) event.thread,
+			(double) (int64_t) (event.time - audio->traceStartTime) / frequency,
+			event.object
 		);
+		if (len >= sizeof(line))
+		{
+			continue;
+		}
+		if ((written + len + sizeof(footer)) > bufferSize)
+		{
+			break;
+		}
+		FAudio_memcpy(buffer + written, line, len);
+		written += len;
+		first = 0;
 	}
+
+	FAudio_memcpy(buffer + written, footer, sizeof(footer));
+	return written + sizeof(footer);
 }
 
-#undef READ
+static inline uint8_t FAudio_INTERNAL_IsBlockCommand(FAudioCommandType type)
+{
+	return (	type == FAUDIO_COMMAND_SETCHANNELVOLUMES ||
+			type == FAUDIO_COMMAND_SETOUTPUTMATRIX ||
+			type == FAUDIO_COMMAND_SETEFFECTPARAMETERS	);
+}
 
-void FAudio_INTERNAL_DecodeMonoMSADPCM(
-	FAudioBuffer *buffer,
-	uint32_t curOffset,
-	float *decodeCache,
-	uint32_t samples,
-	FAudioWaveFormatEx *format
+static inline void FAudio_INTERNAL_MarkMixCoefficients(
+	FAudio *audio,
+	FAudioVoice *voice
 ) {
-	/* Loop variables */
-	uint32_t copy;
-
-	/* Read pointers */
-	uint8_t *buf;
-	int32_t midOffset;
+	/* Rebuilt once per voice when the drain is done, however many of its
+	 * levels changed
+	 */
+	if (!voice->mixCoefficientsDirty)
+	{
+		voice->mixCoefficientsDirty = 1;
+		voice->nextDirty = audio->dirtyVoices;
+		audio->dirtyVoices = voice;
+	}
+}
 
-	/* PCM block cache */
-	int16_t blockCache[512]; /* Max block size */
+static void FAudio_INTERNAL_ApplyCommand(
+	FAudio *audio,
+	FAudioCommand *command,
+	const uint8_t *payload
+) {
+	FAudioVoice *voice = command->voice;
+	FAudioVoice *out;
+	FAudioCommandBatch *batch;
+	FAudioCommand *staged;
+	FAudioVoiceChange *change;
+	FAudioVoiceSends sends;
+	FAudioVoiceEffects effects;
+	FAudioMixCallback *sendMix;
+	float **coefficients;
+	uint32_t i, dstChans;
+
+	switch (command->type)
+	{
+	case FAUDIO_COMMAND_COMMIT:
+		/* The whole set lands in this pass, in the order it was made */
+		batch = command->data.batch;
+		for (i = 0; i < batch->count; i += 1)
+		{
+			staged = &batch->commands[i];
+			FAudio_INTERNAL_ApplyCommand(
+				audio,
+				staged,
+				FAudio_INTERNAL_IsBlockCommand(staged->type) ?
+					batch->arena + staged->data.block.offset :
+					NULL
+			);
+		}
+		batch->count = 0;
+		batch->arenaUsed = 0;
+		FAudio_PlatformAtomicSet(&batch->busy, 0);
+		return;
+	case FAUDIO_COMMAND_START:
+	case FAUDIO_COMMAND_STOP:
+		voice->src.active = (command->type == FAUDIO_COMMAND_START);
+		HandleTable_SetActive(
+			&audio->sources,
+			voice->handle,
+			voice->src.active,
+			audio->sourceTableLock
+		);
+		return;
+	case FAUDIO_COMMAND_ENABLEEFFECT:
+	case FAUDIO_COMMAND_DISABLEEFFECT:
+		if (command->index < voice->effects.count)
+		{
+			voice->effects.desc[command->index].InitialState =
+				(command->type == FAUDIO_COMMAND_ENABLEEFFECT);
+		}
+		return;
+	case FAUDIO_COMMAND_EXITLOOP:
+		FAudio_PlatformAtomicSet(&voice->src.bufferExitLoop, 1);
+		return;
+	case FAUDIO_COMMAND_SETOUTPUTVOICES:
+		/* Trade the voice's sends for the new ones, see FAudioVoiceChange */
+		change = command->data.change;
+		sends = voice->sends;
+		voice->sends = change->sends;
+		change->sends = sends;
+		coefficients = voice->mixSendCoefficients;
+		voice->mixSendCoefficients = change->mixSendCoefficients;
+		change->mixSendCoefficients = coefficients;
+		coefficients = voice->mixCoefficients;
+		voice->mixCoefficients = change->mixCoefficients;
+		change->mixCoefficients = coefficients;
+		sendMix = voice->sendMix;
+		voice->sendMix = change->sendMix;
+		change->sendMix = sendMix;
+
+		/* The scratch was already sized for this by the API */
+		if (voice->type == FAUDIO_VOICE_SOURCE)
+		{
+			voice->src.resampleSamples = change->outputSamples;
+		}
+		else
+		{
+			voice->mix.outputSamples = change->outputSamples;
+			FAudio_INTERNAL_InitSubmixSRC(voice);
+		}
+		FAudio_INTERNAL_MarkMixCoefficients(audio, voice);
+		change->applied = 1;
+		return;
+	case FAUDIO_COMMAND_SETEFFECTCHAIN:
+		/* Same deal for the effect chain */
+		change = command->data.change;
+		effects = voice->effects;
+		voice->effects = change->effects;
+		change->effects = effects;
+		voice->outputChannels = change->outputChannels;
+		change->applied = 1;
+		return;
+	default:
+		break;
+	}
 
-	/* Block size */
-	uint32_t bsize = (format->nBlockAlign - 6) * 2;
+	if (command->type == FAUDIO_COMMAND_SETEFFECTPARAMETERS)
+	{
+		/* The API sized the voice's block for this before queueing it,
+		 * the chain picks it up on its next pass
+		 */
+		if (	command->index < voice->effects.count &&
+			command->data.block.size <= voice->effects.parameterCapacities[command->index]	)
+		{
+			FAudio_memcpy(
+				voice->effects.parameters[command->index],
+				payload,
+				command->data.block.size
+			);
+			voice->effects.parameterSizes[command->index] =
+				command->data.block.size;
+			voice->effects.parameterUpdates[command->index] = 1;
+		}
+		return;
+	}
 
-	/* Where are we starting? */
-	buf = (uint8_t*) buffer->pAudioData + (
-		(curOffset / bsize) *
-		format->nBlockAlign
-	);
+	switch (command->type)
+	{
+	case FAUDIO_COMMAND_SETVOLUME:
+		voice->mixVolume = command->data.value;
+		FAudio_INTERNAL_MarkMixCoefficients(audio, voice);
+		break;
+	case FAUDIO_COMMAND_SETCHANNELVOLUMES:
+		FAudio_memcpy(
+			voice->mixChannelVolume,
+			payload,
+			FAudio_min(
+				command->data.block.size,
+				sizeof(float) * voice->outputChannels
+			)
+		);
+		FAudio_INTERNAL_MarkMixCoefficients(audio, voice);
+		break;
+	case FAUDIO_COMMAND_SETOUTPUTMATRIX:
+		/* Copy in the new matrix, if it still fits the send */
+		if (command->index >= voice->sends.SendCount)
+		{
+			break;
+		}
+		out = voice->sends.pSends[command->index].pOutputVoice;
+		dstChans = (out->type == FAUDIO_VOICE_MASTER) ?
+			out->master.inputChannels :
+			out->mix.inputChannels;
+		if (command->data.block.size == sizeof(float) * voice->outputChannels * dstChans)
+		{
+			FAudio_memcpy(
+				voice->mixSendCoefficients[command->index],
+				payload,
+				command->data.block.size
+			);
+			FAudio_INTERNAL_MarkMixCoefficients(audio, voice);
+		}
+		break;
+	case FAUDIO_COMMAND_SETFILTERPARAMETERS:
+		voice->mixFilter = command->data.filter;
+		break;
+	case FAUDIO_COMMAND_SETFREQUENCYRATIO:
+		voice->src.mixFreqRatio = command->data.value;
+		break;
+	default:
+		FAudio_assert(0 && "Unknown command type!");
+		break;
+	}
+}
 
-	/* Are we starting in the middle? */
-	midOffset = (curOffset % bsize);
+static void FAudio_INTERNAL_DrainCommands(FAudio *audio)
+{
+	FAudioCommand *cell;
+	FAudioVoice *voice;
 
-	/* Read in each block directly to the decode cache */
-	while (samples > 0)
+	/* Caller holds commandLock and scratchLock, so no pass is in progress
+	 * and the voices are ours. Stops at the first cell that has been
+	 * claimed but not published yet; it will be picked up next time.
+	 */
+	for (;;)
 	{
-		copy = FAudio_min(samples, bsize - midOffset);
-		FAudio_INTERNAL_DecodeMonoMSADPCMBlock(
-			&buf,
-			blockCache,
-			format->nBlockAlign
+		cell = &audio->commands[audio->commandTail & (COMMAND_RING_SIZE - 1)];
+		if (	FAudio_PlatformAtomicGet(&cell->sequence) !=
+			(int32_t) (audio->commandTail + 1)	)
+		{
+			break;
+		}
+		FAudio_INTERNAL_ApplyCommand(
+			audio,
+			cell,
+			cell->payload
 		);
-		FAudio_INTERNAL_Convert_S16_To_F32(
-			blockCache + midOffset,
-			decodeCache,
-			copy
+		FAudio_PlatformAtomicSet(
+			&cell->sequence,
+			(int32_t) (audio->commandTail + COMMAND_RING_SIZE)
 		);
-		decodeCache += copy;
-		samples -= copy;
-		midOffset = 0;
+		audio->commandTail += 1;
+	}
+
+	/* Now build the matrices the mixer will use for whatever changed */
+	while (audio->dirtyVoices != NULL)
+	{
+		voice = audio->dirtyVoices;
+		audio->dirtyVoices = voice->nextDirty;
+		voice->nextDirty = NULL;
+		voice->mixCoefficientsDirty = 0;
+		FAudio_INTERNAL_UpdateMixCoefficients(voice);
 	}
 }
 
-void FAudio_INTERNAL_DecodeStereoMSADPCM(
-	FAudioBuffer *buffer,
-	uint32_t curOffset,
-	float *decodeCache,
-	uint32_t samples,
-	FAudioWaveFormatEx *format
-) {
-	/* Loop variables */
-	uint32_t copy;
+void FAudio_INTERNAL_LockCommands(FAudio *audio)
+{
+	/* Waits out any pass in progress and applies everything queued so
+	 * far, then keeps the mixer from mixing or applying anything else
+	 * until UnlockCommands. Safe from any API thread, whether or not the
+	 * mixer is running. Keep it short, the mixer waits on this!
+	 */
+	FAudio_PlatformLockMutex(audio->commandLock);
+	FAudio_PlatformLockMutex(audio->scratchLock);
+	FAudio_INTERNAL_DrainCommands(audio);
+}
 
-	/* Read pointers */
-	uint8_t *buf;
-	int32_t midOffset;
+void FAudio_INTERNAL_UnlockCommands(FAudio *audio)
+{
+	FAudio_PlatformUnlockMutex(audio->scratchLock);
+	FAudio_PlatformUnlockMutex(audio->commandLock);
+}
 
-	/* PCM block cache */
-	int16_t blockCache[1024]; /* Max block size */
+void FAudio_INTERNAL_QueueVoiceChange(FAudio *audio, FAudioCommand *command)
+{
+	uint8_t applied;
 
-	/* Align, block size */
-	uint32_t bsize = ((format->nBlockAlign / 2) - 6) * 2;
+	/* The first flush usually applies it, unless a producer ahead of us
+	 * has yet to publish its cell. The caller frees what comes back.
+	 */
+	FAudio_INTERNAL_PushCommand(audio, command, NULL);
+	do
+	{
+		FAudio_INTERNAL_LockCommands(audio);
+		applied = command->data.change->applied;
+		FAudio_INTERNAL_UnlockCommands(audio);
+	} while (!applied);
+}
 
-	/* Where are we starting? */
-	buf = (uint8_t*) buffer->pAudioData + (
+void FAudio_INTERNAL_FlushCommands(FAudio *audio)
+{
+	FAudio_INTERNAL_LockCommands(audio);
+	FAudio_INTERNAL_UnlockCommands(audio);
+}
+
+static void FAudio_INTERNAL_FitCommandBatch(
+	FAudioCommandBatch *batch,
+	uint32_t commands,
+	uint32_t bytes
+) {
+	/* Only for batches the API side owns: free, or the staging batch */
+	if (commands > batch->capacity)
+	{
+		batch->capacity = commands;
+		batch->commands = (FAudioCommand*) FAudio_realloc(
+			batch->commands,
+			sizeof(FAudioCommand) * batch->capacity
+		);
+	}
+	if (bytes > batch->arenaCapacity)
+	{
+		batch->arenaCapacity = bytes;
+		batch->arena = (uint8_t*) FAudio_realloc(
+			batch->arena,
+			batch->arenaCapacity
+		);
+	}
+}
+
+void FAudio_INTERNAL_AllocCommands(FAudio *audio)
+{
+	uint32_t i;
+
+	/* One block backs every cell's payload until something outgrows it */
+	audio->commands = (FAudioCommand*) FAudio_malloc(
+		sizeof(FAudioCommand) * COMMAND_RING_SIZE
+	);
+	audio->commandPayloads = (uint8_t*) FAudio_malloc(
+		COMMAND_PAYLOAD_SIZE * COMMAND_RING_SIZE
+	);
+	for (i = 0; i < COMMAND_RING_SIZE; i += 1)
+	{
+		audio->commands[i].sequence = (int32_t) i;
+		audio->commands[i].payload = (
+			audio->commandPayloads + (COMMAND_PAYLOAD_SIZE * i)
+		);
+		audio->commands[i].payloadCapacity = COMMAND_PAYLOAD_SIZE;
+	}
+
+	for (i = 0; i < COMMAND_BATCHES; i += 1)
+	{
+		FAudio_INTERNAL_FitCommandBatch(
+			&audio->batches[i],
+			COMMAND_BATCH_SIZE,
+			COMMAND_BATCH_ARENA
+		);
+	}
+}
+
+static FAudioCommandBatch* FAudio_INTERNAL_GetCommandBatch(FAudio *audio)
+{
+	FAudioCommandBatch *batch;
+	uint32_t i;
+
+	/* Caller holds stagingLock. If every batch is still queued, the mixer
+	 * is stopped or far behind, so apply them here to get one back.
+	 */
+	for (;;)
+	{
+		for (i = 0; i < COMMAND_BATCHES; i += 1)
+		{
+			batch = &audio->batches[i];
+			if (!FAudio_PlatformAtomicGet(&batch->busy))
+			{
+				FAudio_PlatformAtomicSet(&batch->busy, 1);
+
+				/* Catch up on voices made while it was queued */
+				FAudio_INTERNAL_FitCommandBatch(
+					batch,
+					audio->stagingReserveCommands,
+					audio->stagingReserveBytes
+				);
+				return batch;
+			}
+		}
+		FAudio_INTERNAL_FlushCommands(audio);
+	}
+}
+
+static void FAudio_INTERNAL_StageCommand(
+	FAudioCommandBatch *batch,
+	const FAudioCommand *command,
+	const void *payload
+) {
+	FAudioCommand *staged;
+
+	/* The reserve only runs out when a set changes something more than
+	 * once, in which case the batch keeps the extra room from now on.
+	 */
+	if (batch->count == batch->capacity)
+	{
+		FAudio_INTERNAL_FitCommandBatch(
+			batch,
+			batch->capacity * 2,
+			batch->arenaCapacity
+		);
+	}
+	staged = &batch->commands[batch->count];
+	*staged = *command;
+	batch->count += 1;
+
+	if (FAudio_INTERNAL_IsBlockCommand(command->type))
+	{
+		if (batch->arenaUsed + command->data.block.size > batch->arenaCapacity)
+		{
+			FAudio_INTERNAL_FitCommandBatch(
+				batch,
+				batch->capacity,
+				FAudio_max(
+					batch->arenaCapacity * 2,
+					batch->arenaUsed + command->data.block.size
+				)
+			);
+		}
+		FAudio_memcpy(
+			batch->arena + batch->arenaUsed,
+			payload,
+			command->data.block.size
+		);
+		staged->data.block.offset = batch->arenaUsed;
+		batch->arenaUsed += command->data.block.size;
+	}
+}
+
+/* Moves the staged commands for voice (any voice if NULL) made with
+ * OperationSet (any set if FAUDIO_COMMIT_ALL) to dst, or drops them if dst
+ * is NULL. The rest keep their order, and their payloads are packed down.
+ */
+static void FAudio_INTERNAL_SplitStagedCommands(
+	FAudioCommandBatch *staged,
+	FAudioCommandBatch *dst,
+	FAudioVoice *voice,
+	uint32_t OperationSet
+) {
+	FAudioCommand *command;
+	uint8_t isBlock;
+	uint32_t i, kept, keptBytes;
+
+	kept = 0;
+	keptBytes = 0;
+	for (i = 0; i < staged->count; i += 1)
+	{
+		command = &staged->commands[i];
+		isBlock = FAudio_INTERNAL_IsBlockCommand(command->type);
+		if (	(voice == NULL || command->voice == voice) &&
+			(	OperationSet == FAUDIO_COMMIT_ALL ||
+				command->operationSet == OperationSet	)	)
+		{
+			if (dst != NULL)
+			{
+				FAudio_INTERNAL_StageCommand(
+					dst,
+					command,
+					isBlock ?
+						staged->arena + command->data.block.offset :
+						NULL
+				);
+			}
+			continue;
+		}
+		if (isBlock)
+		{
+			FAudio_memmove(
+				staged->arena + keptBytes,
+				staged->arena + command->data.block.offset,
+				command->data.block.size
+			);
+			command->data.block.offset = keptBytes;
+			keptBytes += command->data.block.size;
+		}
+		staged->commands[kept++] = *command;
+	}
+	staged->count = kept;
+	staged->arenaUsed = keptBytes;
+}
+
+void FAudio_INTERNAL_SubmitCommand(
+	FAudio *audio,
+	FAudioCommand *command,
+	const void *payload,
+	uint32_t OperationSet
+) {
+	if (OperationSet == FAUDIO_COMMIT_NOW)
+	{
+		FAudio_INTERNAL_PushCommand(
+			audio,
+			command,
+			FAudio_INTERNAL_IsBlockCommand(command->type) ?
+				payload :
+				NULL
+		);
+		return;
+	}
+
+	command->operationSet = OperationSet;
+	FAudio_PlatformLockMutex(audio->stagingLock);
+	if (audio->staged == NULL)
+	{
+		audio->staged = FAudio_INTERNAL_GetCommandBatch(audio);
+	}
+	FAudio_INTERNAL_StageCommand(audio->staged, command, payload);
+	FAudio_PlatformUnlockMutex(audio->stagingLock);
+}
+
+uint32_t FAudio_INTERNAL_CommitCommands(FAudio *audio, uint32_t OperationSet)
+{
+	FAudioCommandBatch *batch;
+	FAudioCommand command;
+
+	FAudio_PlatformLockMutex(audio->stagingLock);
+	if (audio->staged == NULL || audio->staged->count == 0)
+	{
+		FAudio_PlatformUnlockMutex(audio->stagingLock);
+		return 0;
+	}
+
+	if (OperationSet == FAUDIO_COMMIT_ALL)
+	{
+		/* Hand the whole staging batch over, a free one replaces it */
+		batch = audio->staged;
+		audio->staged = NULL;
+	}
+	else
+	{
+		/* Pull this set out, keeping the rest in order */
+		batch = FAudio_INTERNAL_GetCommandBatch(audio);
+		FAudio_INTERNAL_SplitStagedCommands(
+			audio->staged,
+			batch,
+			NULL,
+			OperationSet
+		);
+		if (batch->count == 0)
+		{
+			FAudio_PlatformAtomicSet(&batch->busy, 0);
+			FAudio_PlatformUnlockMutex(audio->stagingLock);
+			return 0;
+		}
+	}
+	FAudio_PlatformUnlockMutex(audio->stagingLock);
+
+	command.type = FAUDIO_COMMAND_COMMIT;
+	command.voice = NULL;
+	command.index = 0;
+	command.data.batch = batch;
+	FAudio_INTERNAL_PushCommand(audio, &command, NULL);
+	return 0;
+}
+
+void FAudio_INTERNAL_DiscardStagedCommands(FAudio *audio, FAudioVoice *voice)
+{
+	FAudio_PlatformLockMutex(audio->stagingLock);
+	if (audio->staged != NULL)
+	{
+		FAudio_INTERNAL_SplitStagedCommands(
+			audio->staged,
+			NULL,
+			voice,
+			FAUDIO_COMMIT_ALL
+		);
+	}
+	FAudio_PlatformUnlockMutex(audio->stagingLock);
+}
+
+void FAudio_INTERNAL_ReserveStagedCommands(
+	FAudioVoice *voice,
+	uint8_t release
+) {
+	FAudio *audio = voice->audio;
+	FAudioVoice *out;
+	FAudioCommandBatch *batch;
+	uint32_t i, dstChans;
+	uint32_t commands = 0, bytes = 0;
+
+	/* Room for one change to each of this voice's levels, parameters and
+	 * states, so a set that moves every voice once never has to grow.
+	 */
+	if (!release)
+	{
+		commands = (
+			STAGED_COMMANDS_PER_VOICE +
+			voice->sends.SendCount +
+			voice->effects.count * 2
+		);
+		bytes = sizeof(float) * voice->outputChannels;
+		for (i = 0; i < voice->sends.SendCount; i += 1)
+		{
+			out = voice->sends.pSends[i].pOutputVoice;
+			dstChans = (out->type == FAUDIO_VOICE_MASTER) ?
+				out->master.inputChannels :
+				out->mix.inputChannels;
+			bytes += sizeof(float) * voice->outputChannels * dstChans;
+		}
+		for (i = 0; i < voice->effects.count; i += 1)
+		{
+			bytes += voice->effects.parameterCapacities[i];
+		}
+	}
+
+	FAudio_PlatformLockMutex(audio->stagingLock);
+	audio->stagingReserveCommands -= voice->stagingCommands;
+	audio->stagingReserveCommands += commands;
+	audio->stagingReserveBytes -= voice->stagingBytes;
+	audio->stagingReserveBytes += bytes;
+	voice->stagingCommands = commands;
+	voice->stagingBytes = bytes;
+
+	/* Queued batches catch up when they are next taken */
+	for (i = 0; i < COMMAND_BATCHES; i += 1)
+	{
+		batch = &audio->batches[i];
+		if (	batch == audio->staged ||
+			!FAudio_PlatformAtomicGet(&batch->busy)	)
+		{
+			FAudio_INTERNAL_FitCommandBatch(
+				batch,
+				audio->stagingReserveCommands,
+				audio->stagingReserveBytes
+			);
+		}
+	}
+	FAudio_PlatformUnlockMutex(audio->stagingLock);
+}
+
+void FAudio_INTERNAL_ReserveEffectParameters(
+	FAudioVoice *voice,
+	uint32_t index,
+	uint32_t size
+) {
+	void *block, *old;
+
+	/* The mixer only ever copies into this block, the API grows it.
+	 * SetEffectChain swaps the arrays under commandLock, so check there.
+	 */
+	FAudio_PlatformLockMutex(voice->audio->commandLock);
+	if (	index >= voice->effects.count ||
+		size <= voice->effects.parameterCapacities[index]	)
+	{
+		FAudio_PlatformUnlockMutex(voice->audio->commandLock);
+		return;
+	}
+	FAudio_PlatformUnlockMutex(voice->audio->commandLock);
+
+	/* Allocate out here, then swap the new block in between passes */
+	block = FAudio_malloc(size);
+	FAudio_INTERNAL_LockCommands(voice->audio);
+	if (	index < voice->effects.count &&
+		size > voice->effects.parameterCapacities[index]	)
+	{
+		if (voice->effects.parameterSizes[index] > 0)
+		{
+			FAudio_memcpy(
+				block,
+				voice->effects.parameters[index],
+				voice->effects.parameterSizes[index]
+			);
+		}
+		old = voice->effects.parameters[index];
+		voice->effects.parameters[index] = block;
+		voice->effects.parameterCapacities[index] = size;
+		block = old;
+	}
+	FAudio_INTERNAL_UnlockCommands(voice->audio);
+	FAudio_free(block);
+
+	/* Staged sets need room for the bigger parameters too */
+	FAudio_INTERNAL_ReserveStagedCommands(voice, 0);
+}
+
+void FAudio_INTERNAL_FreeCommands(FAudio *audio)
+{
+	uint32_t i;
+
+	/* Anything still queued has no voice left to apply to, and the cells
+	 * own their payloads, so the ring can go as it is.
+	 */
+	for (i = 0; i < COMMAND_RING_SIZE; i += 1)
+	{
+		if (audio->commands[i].payloadCapacity > COMMAND_PAYLOAD_SIZE)
+		{
+			FAudio_free(audio->commands[i].payload);
+		}
+	}
+	FAudio_free(audio->commandPayloads);
+	FAudio_free(audio->commands);
+	audio->commandPayloads = NULL;
+	audio->commands = NULL;
+
+	for (i = 0; i < COMMAND_BATCHES; i += 1)
+	{
+		FAudio_free(audio->batches[i].commands);
+		FAudio_free(audio->batches[i].arena);
+	}
+	FAudio_zero(audio->batches, sizeof(audio->batches));
+	audio->staged = NULL;
+}
+
+void FAudio_INTERNAL_AddSourceVoice(
+	FAudio *audio,
+	FAudioSourceVoice *voice
+) {
+	uint32_t capacity;
+	FAudioSourceVoice **queue, **old;
+	FAudioVoiceEvent *events;
+
+	/* The mix queue has to hold every source in the table, so make room
+	 * before the mixer can see the new voice. Only growing the queue
+	 * waits out the mix, which reads it without the table lock. The
+	 * partitions' event storage is sized off the queue, so it grows too.
+	 */
+	for (;;)
+	{
+		FAudio_PlatformLockMutex(audio->sourceTableLock);
+		if (audio->sources.count < audio->mixQueueCapacity)
+		{
+			voice->handle = HandleTable_AddEntry(
+				&audio->sources,
+				voice,
+				audio->sourceTableLock
+			);
+			FAudio_PlatformUnlockMutex(audio->sourceTableLock);
+			return;
+		}
+		capacity = FAudio_max(16, audio->mixQueueCapacity * 2);
+		FAudio_PlatformUnlockMutex(audio->sourceTableLock);
+
+		queue = (FAudioSourceVoice**) FAudio_malloc(
+			sizeof(FAudioSourceVoice*) * capacity
+		);
+		events = (FAudioVoiceEvent*) FAudio_malloc(
+			sizeof(FAudioVoiceEvent) *
+			MIX_PARTITION_EVENTS(capacity) *
+			MIX_PARTITIONS
+		);
+		FAudio_PlatformLockMutex(audio->sourceLock);
+		FAudio_PlatformLockMutex(audio->sourceTableLock);
+		if (capacity > audio->mixQueueCapacity)
+		{
+			old = audio->mixQueue;
+			audio->mixQueue = queue;
+			audio->mixQueueCapacity = capacity;
+			queue = old;
+
+			/* Serial mixing has no partitions to give them to */
+			if (audio->threadCount > 0)
+			{
+				events = FAudio_INTERNAL_SetPartitionEvents(
+					audio,
+					events
+				);
+			}
+		}
+		FAudio_PlatformUnlockMutex(audio->sourceTableLock);
+		FAudio_PlatformUnlockMutex(audio->sourceLock);
+		FAudio_free(queue);
+		FAudio_free(events);
+	}
+}
+
+static void FAudio_INTERNAL_QueueSources(FAudio *audio)
+{
+	uint32_t i;
+
+	/* Only the packed table is read here, so the voices themselves stay
+	 * cold until they are actually mixed. Start/Stop only need the table
+	 * lock, so they never wait on a mix in progress.
+	 */
+	FAudio_PlatformLockMutex(audio->sourceTableLock);
+	FAudio_assert(audio->sources.count <= audio->mixQueueCapacity);
+	audio->mixQueueCount = 0;
+	for (i = 0; i < audio->sources.count; i += 1)
+	{
+		if (audio->sources.entries[i].active)
+		{
+			audio->mixQueue[audio->mixQueueCount++] =
+				(FAudioSourceVoice*) audio->sources.entries[i].entry;
+		}
+	}
+	FAudio_PlatformUnlockMutex(audio->sourceTableLock);
+}
+
+static void FAudio_INTERNAL_UpdateGovernor(FAudio *audio)
+{
+	/* Caller holds sourceLock. One step per change, then wait a few
+	 * passes for governorLoad to show what that step did.
+	 */
+	if (audio->governorMaxLoad <= 0.0f)
+	{
+		audio->governorLevel = 0;
+		return;
+	}
+	if (audio->governorHold > 0)
+	{
+		audio->governorHold -= 1;
+		return;
+	}
+	if (audio->governorLoad > audio->governorMaxLoad)
+	{
+		audio->governorCalm = 0;
+		if (audio->governorLevel < GOVERNOR_MAX_LEVEL)
+		{
+			audio->governorLevel += 1;
+			audio->governorHold = GOVERNOR_HOLD_PASSES;
+		}
+	}
+	else if (audio->governorLoad < audio->governorMaxLoad * GOVERNOR_CALM_LOAD)
+	{
+		/* Restore slowly, or we would just shed it again */
+		audio->governorCalm += 1;
+		if (	audio->governorCalm >= GOVERNOR_CALM_PASSES &&
+			audio->governorLevel > 0	)
+		{
+			audio->governorLevel -= 1;
+			audio->governorHold = GOVERNOR_HOLD_PASSES;
+			audio->governorCalm = 0;
+		}
+	}
+	else
+	{
+		audio->governorCalm = 0;
+	}
+}
+
+static inline void FAudio_INTERNAL_CountMixScratch(
+	FAudioPerformanceData *data,
+	FAudioMixScratch *scratch
+) {
+	data->ActiveResamplerCount += scratch->resamplerCount;
+	data->ActiveMatrixMixCount += scratch->matrixMixCount;
+	data->MemoryUsageInBytes += sizeof(float) * (
+		scratch->decodeSamples +
+		scratch->resampleSamples +
+		scratch->effectChainSamples
+	);
+	scratch->resamplerCount = 0;
+	scratch->matrixMixCount = 0;
+}
+
+static void FAudio_INTERNAL_CountPassData(FAudio *audio)
+{
+	FAudioPerformanceData *pending = &audio->perfPending;
+	uint32_t i;
+
+	/* Describes this pass only. Caller holds scratchLock, so neither the
+	 * scratch nor the workers can change. The partition buses change under
+	 * submixLock and their events under sourceLock.
+	 */
+	pending->ActiveSourceVoiceCount = audio->mixQueueCount;
+	pending->ActiveResamplerCount = 0;
+	pending->ActiveMatrixMixCount = 0;
+	pending->MemoryUsageInBytes = 0;
+	FAudio_INTERNAL_CountMixScratch(pending, &audio->scratch);
+	if (audio->threadCount > 0)
+	{
+		for (i = 0; i < audio->threadCount - 1; i += 1)
+		{
+			FAudio_INTERNAL_CountMixScratch(
+				pending,
+				&audio->workers[i].scratch
+			);
+		}
+		FAudio_PlatformLockMutex(audio->sourceLock);
+		FAudio_PlatformLockMutex(audio->submixLock);
+		for (i = 0; i < MIX_PARTITIONS; i += 1)
+		{
+			pending->MemoryUsageInBytes += (
+				sizeof(float) * audio->partitions[i].busSamples +
+				audio->partitions[i].busCount +
+				sizeof(FAudioVoiceEvent) * audio->partitions[i].eventCapacity
+			);
+		}
+		FAudio_PlatformUnlockMutex(audio->submixLock);
+		FAudio_PlatformUnlockMutex(audio->sourceLock);
+	}
+}
+
+static void FAudio_INTERNAL_UpdatePerformanceData(FAudio *audio, uint64_t start)
+{
+	FAudioPerformanceData *pending = &audio->perfPending;
+	FAudioPerformanceData *data = &audio->perfData;
+	uint64_t cycles, quantum;
+
+	/* A pass that took longer than the audio it made is a missed deadline */
+	cycles = FAudio_timecounter() - start;
+	quantum = (
+		audio->updateSize *
+		FAudio_timefrequency() /
+		audio->master->master.inputSampleRate
+	);
+	if (cycles > quantum)
+	{
+		pending->GlitchesSinceEngineStarted += 1;
+	}
+	audio->governorLoad += GOVERNOR_SMOOTHING * (
+		(float) cycles / (float) quantum -
+		audio->governorLoad
+	);
+	pending->AudioCyclesSinceLastQuery += cycles;
+	cycles = FAudio_clamp(cycles, 1, 0xFFFFFFFF);
+	if (	pending->MinimumCyclesPerQuantum == 0 ||
+		cycles < pending->MinimumCyclesPerQuantum	)
+	{
+		pending->MinimumCyclesPerQuantum = (uint32_t) cycles;
+	}
+	if (cycles > pending->MaximumCyclesPerQuantum)
+	{
+		pending->MaximumCyclesPerQuantum = (uint32_t) cycles;
+	}
+
+	/* Never wait on a query, just try again next pass */
+	if (!FAudio_PlatformTryLockMutex(audio->perfLock))
+	{
+		return;
+	}
+	data->AudioCyclesSinceLastQuery += pending->AudioCyclesSinceLastQuery;
+	if (	data->MinimumCyclesPerQuantum == 0 ||
+		pending->MinimumCyclesPerQuantum < data->MinimumCyclesPerQuantum	)
+	{
+		data->MinimumCyclesPerQuantum = pending->MinimumCyclesPerQuantum;
+	}
+	if (pending->MaximumCyclesPerQuantum > data->MaximumCyclesPerQuantum)
+	{
+		data->MaximumCyclesPerQuantum = pending->MaximumCyclesPerQuantum;
+	}
+	data->GlitchesSinceEngineStarted += pending->GlitchesSinceEngineStarted;
+	data->ActiveSourceVoiceCount = pending->ActiveSourceVoiceCount;
+	data->ActiveSubmixVoiceCount = pending->ActiveSubmixVoiceCount;
+	data->ActiveResamplerCount = pending->ActiveResamplerCount;
+	data->ActiveMatrixMixCount = pending->ActiveMatrixMixCount;
+	data->MemoryUsageInBytes = pending->MemoryUsageInBytes;
+	FAudio_PlatformUnlockMutex(audio->perfLock);
+
+	pending->AudioCyclesSinceLastQuery = 0;
+	pending->MinimumCyclesPerQuantum = 0;
+	pending->MaximumCyclesPerQuantum = 0;
+	pending->GlitchesSinceEngineStarted = 0;
+}
+
+void FAudio_INTERNAL_UpdateEngine(FAudio *audio, float *output)
+{
+	uint32_t i, j, first, last, totalSamples;
+	uint64_t start;
+	float volume;
+	FAudioEngineCallback *callback;
+
+	if (!audio->active)
+	{
+		return;
+	}
+	start = FAudio_timecounter();
+	TRACE_BEGIN(audio, "UpdateEngine", audio);
+
+	/* ProcessingPassStart callbacks */
+	FAudio_PlatformLockMutex(audio->callbackLock);
+	for (i = 0; i < audio->callbacks.count; i += 1)
+	{
+		callback = (FAudioEngineCallback*) audio->callbacks.entries[i].entry;
+		if (callback->OnProcessingPassStart != NULL)
+		{
+			callback->OnProcessingPassStart(
+				callback
+			);
+		}
+	}
+	FAudio_PlatformUnlockMutex(audio->callbackLock);
+
+	/* The scratch can't move while any of it is in use, and the voices
+	 * are only changed between passes, see FAudio_INTERNAL_LockCommands
+	 */
+	FAudio_PlatformLockMutex(audio->scratchLock);
+
+	/* Apply the parameter changes queued up since the last pass. If an
+	 * API thread is already flushing the queue, leave it to that thread.
+	 */
+	if (FAudio_PlatformTryLockMutex(audio->commandLock))
+	{
+		FAudio_INTERNAL_DrainCommands(audio);
+		FAudio_PlatformUnlockMutex(audio->commandLock);
+	}
+
+	/* Writes to master will directly write to output */
+	audio->master->master.output = output;
+
+	/* Mix sources */
+	FAudio_PlatformLockMutex(audio->sourceLock);
+	FAudio_INTERNAL_UpdateGovernor(audio);
+	FAudio_INTERNAL_QueueSources(audio);
+	if (audio->threadCount > 0)
+	{
+		FAudio_INTERNAL_MixSourcesParallel(audio);
+	}
+	else
+	{
+		for (i = 0; i < audio->mixQueueCount; i += 1)
+		{
+			FAudio_INTERNAL_MixSource(
+				audio->mixQueue[i],
+				&audio->scratch,
+				NULL
+			);
+		}
+	}
+	FAudio_PlatformUnlockMutex(audio->sourceLock);
+
+	/* Mix submixes, following the execution plan */
+	FAudio_PlatformLockMutex(audio->submixLock);
+	audio->perfPending.ActiveSubmixVoiceCount = audio->submixes.count;
+	for (i = 0; i < audio->submixStageCount; i += 1)
+	{
+		first = audio->submixStageTasks[i];
+		last = audio->submixStageTasks[i + 1];
+		if (audio->threadCount > 1 && (last - first) > 1)
+		{
+			audio->jobStage = i;
+			FAudio_INTERNAL_RunMixJobs(
+				audio,
+				FAudio_INTERNAL_MixSubmixTask,
+				last - first
+			);
+		}
+		else
+		{
+			for (j = audio->submixTasks[first]; j < audio->submixTasks[last]; j += 1)
+			{
+				FAudio_INTERNAL_MixSubmix(
+					audio->submixPlan[j],
+					&audio->scratch
+				);
+			}
+		}
+	}
+	FAudio_PlatformUnlockMutex(audio->submixLock);
+
+	/* Apply master volume */
+	volume = audio->master->mixVolume;
+	totalSamples = audio->updateSize * audio->master->master.inputChannels;
+	if (volume != 1.0f)
+	{
+		FAudio_INTERNAL_Kernels.applyVolume(
+			output,
+			totalSamples,
+			volume
+		);
+	}
+
+	/* Process master effect chain */
+	if (audio->master->effects.count > 0)
+	{
+		float *effectOut = FAudio_INTERNAL_ProcessEffectChain(
+			audio->master,
+			&audio->scratch,
+			audio->master->master.inputChannels,
+			audio->master->master.inputSampleRate,
+			output,
+			totalSamples,
+			audio->updateSize
+		);
+
+		if (effectOut == NULL)
+		{
+			FAudio_zero(
+				output,
+				audio->updateSize * audio->master->outputChannels * sizeof(float)
+			);
+		}
+		else if (effectOut != output)
+		{
+			FAudio_memcpy(
+				output,
+				effectOut,
+				audio->updateSize * audio->master->outputChannels * sizeof(float)
+			);
+		}
+	}
+	FAudio_INTERNAL_CountPassData(audio);
+	FAudio_PlatformUnlockMutex(audio->scratchLock);
+
+	/* OnProcessingPassEnd callbacks */
+	FAudio_PlatformLockMutex(audio->callbackLock);
+	for (i = 0; i < audio->callbacks.count; i += 1)
+	{
+		callback = (FAudioEngineCallback*) audio->callbacks.entries[i].entry;
+		if (callback->OnProcessingPassEnd != NULL)
+		{
+			callback->OnProcessingPassEnd(
+				callback
+			);
+		}
+	}
+	FAudio_PlatformUnlockMutex(audio->callbackLock);
+
+	FAudio_INTERNAL_UpdatePerformanceData(audio, start);
+	TRACE_END(audio, "UpdateEngine", audio);
+}
+
+void FAudio_INTERNAL_InitPullMode(FAudio *audio)
+{
+	FAudioWaveFormatExtensible *fmt = &audio->pullFormat;
+	uint32_t channels = audio->master->master.inputChannels;
+
+	/* Same output format a device would give us, minus the device */
+	fmt->Format.wFormatTag = 3;
+	fmt->Format.nChannels = channels;
+	fmt->Format.nSamplesPerSec = audio->master->master.inputSampleRate;
+	fmt->Format.wBitsPerSample = 32;
+	fmt->Format.nBlockAlign = channels * sizeof(float);
+	fmt->Format.nAvgBytesPerSec = (
+		fmt->Format.nSamplesPerSec *
+		fmt->Format.nBlockAlign
+	);
+	fmt->Format.cbSize = 0;
+	fmt->Samples.wValidBitsPerSample = 32;
+	if (channels == 1)
+	{
+		fmt->dwChannelMask = SPEAKER_MONO;
+	}
+	else if (channels == 2)
+	{
+		fmt->dwChannelMask = SPEAKER_STEREO;
+	}
+	else if (channels == 3)
+	{
+		fmt->dwChannelMask = SPEAKER_2POINT1;
+	}
+	else if (channels == 4)
+	{
+		fmt->dwChannelMask = SPEAKER_QUAD;
+	}
+	else if (channels == 5)
+	{
+		fmt->dwChannelMask = SPEAKER_4POINT1;
+	}
+	else if (channels == 6)
+	{
+		fmt->dwChannelMask = SPEAKER_5POINT1;
+	}
+	else if (channels == 8)
+	{
+		fmt->dwChannelMask = SPEAKER_7POINT1;
+	}
+	else
+	{
+		FAudio_assert(0 && "Unrecognized speaker layout!");
+	}
+	FAudio_zero(&fmt->SubFormat, sizeof(FAudioGUID));
+	audio->mixFormat = fmt;
+
+	/* XAudio2 mixes in 10ms quanta */
+	audio->updateSize = fmt->Format.nSamplesPerSec / 100;
+	audio->pullCache = (float*) FAudio_malloc(
+		sizeof(float) * audio->updateSize * channels
+	);
+	audio->pullOffset = audio->updateSize;
+}
+
+void FAudio_INTERNAL_ReserveMixScratch(
+	FAudio *audio,
+	uint32_t decodeSamples,
+	uint32_t resampleSamples,
+	uint32_t effectChainSamples
+) {
+	uint32_t i;
+
+	/* Only API threads grow the scratch, and the sizes only go up, so
+	 * most calls can leave without waiting for the mixer.
+	 */
+	if (	decodeSamples <= audio->scratch.decodeSamples &&
+		resampleSamples <= audio->scratch.resampleSamples &&
+		effectChainSamples <= audio->scratch.effectChainSamples	)
+	{
+		return;
+	}
+
+	/* Workers can pick up any job, so they all get the engine's size */
+	FAudio_PlatformLockMutex(audio->scratchLock);
+	FAudio_INTERNAL_FitMixScratch(
+		&audio->scratch,
+		decodeSamples,
+		resampleSamples,
+		effectChainSamples
+	);
+	for (i = 0; i + 1 < audio->threadCount; i += 1)
+	{
+		FAudio_INTERNAL_FitMixScratch(
+			&audio->workers[i].scratch,
+			audio->scratch.decodeSamples,
+			audio->scratch.resampleSamples,
+			audio->scratch.effectChainSamples
+		);
+	}
+	FAudio_PlatformUnlockMutex(audio->scratchLock);
+}
+
+void FAudio_INTERNAL_ReserveEffectChain(
+	FAudioVoice *voice,
+	const FAudioEffectChain *pEffectChain,
+	uint32_t frames
+) {
+	uint32_t i, channels = 0, resampleChannels;
+
+	/* Out of place effects write to the effect chain cache, so it needs
+	 * to hold the widest output in the chain. Every other one writes back
+	 * to the resample cache, which sources mix in. So do submixes, at
+	 * their input width, unless the chain fits in their input cache.
+	 */
+	if (pEffectChain != NULL)
+	{
+		for (i = 0; i < pEffectChain->EffectCount; i += 1)
+		{
+			channels = FAudio_max(
+				channels,
+				pEffectChain->pEffectDescriptors[i].OutputChannels
+			);
+		}
+	}
+	else
+	{
+		FAudio_PlatformLockMutex(voice->audio->commandLock);
+		for (i = 0; i < voice->effects.count; i += 1)
+		{
+			channels = FAudio_max(
+				channels,
+				voice->effects.desc[i].OutputChannels
+			);
+		}
+		FAudio_PlatformUnlockMutex(voice->audio->commandLock);
+	}
+
+	if (voice->type == FAUDIO_VOICE_SOURCE)
+	{
+		resampleChannels = channels;
+	}
+	else if (voice->type == FAUDIO_VOICE_SUBMIX)
+	{
+		resampleChannels = FAudio_max(channels, voice->mix.inputChannels);
+	}
+	else
+	{
+		resampleChannels = 0;
+	}
+
+	/* Not under commandLock, that goes before scratchLock */
+	FAudio_INTERNAL_ReserveMixScratch(
+		voice->audio,
+		0,
+		resampleChannels * frames,
+		channels * frames
+	);
+}
+
+static const float MATRIX_DEFAULTS[8][8][64] =
+{
+	#include "matrix_defaults.inl"
+};
+
+void FAudio_INTERNAL_SetDefaultMatrix(
+	float *matrix,
+	uint32_t srcChannels,
+	uint32_t dstChannels
+) {
+	FAudio_assert(srcChannels > 0 && srcChannels < 9);
+	FAudio_assert(dstChannels > 0 && dstChannels < 9);
+	FAudio_memcpy(
+		matrix,
+		MATRIX_DEFAULTS[srcChannels - 1][dstChannels - 1],
+		srcChannels * dstChannels * sizeof(float)
+	);
+}
+
+void FAudio_INTERNAL_AllocEffectChain(
+	FAudioVoiceEffects *effects,
+	const FAudioEffectChain *pEffectChain
+) {
+	uint32_t i;
+
+	effects->count = pEffectChain->EffectCount;
+	if (effects->count == 0)
+	{
+		return;
+	}
+
+	for (i = 0; i < pEffectChain->EffectCount; i += 1)
+	{
+		pEffectChain->pEffectDescriptors[i].pEffect->AddRef(pEffectChain->pEffectDescriptors[i].pEffect);
+	}
+
+	effects->desc = (FAudioEffectDescriptor*) FAudio_malloc(
+		effects->count * sizeof(FAudioEffectDescriptor)
+	);
+	FAudio_memcpy(
+		effects->desc,
+		pEffectChain->pEffectDescriptors,
+		effects->count * sizeof(FAudioEffectDescriptor)
+	);
+	#define ALLOC_EFFECT_PROPERTY(prop, type) \
+		effects->prop = (type*) FAudio_malloc( \
+			effects->count * sizeof(type) \
+		); \
+		FAudio_zero( \
+			effects->prop, \
+			effects->count * sizeof(type) \
+		);
+	ALLOC_EFFECT_PROPERTY(parameters, void*)
+	ALLOC_EFFECT_PROPERTY(parameterSizes, uint32_t)
+	ALLOC_EFFECT_PROPERTY(parameterCapacities, uint32_t)
+	ALLOC_EFFECT_PROPERTY(parameterUpdates, uint8_t)
+	ALLOC_EFFECT_PROPERTY(inPlaceProcessing, uint8_t)
+#ifdef FAUDIO_PROFILE
+	ALLOC_EFFECT_PROPERTY(profileTicks, uint64_t)
+
+	/* Each 64-bit tick count goes out as two atomic words */
+	effects->publishedTicks = (int32_t*) FAudio_malloc(
+		effects->count * sizeof(uint64_t)
+	);
+	FAudio_zero(effects->publishedTicks, effects->count * sizeof(uint64_t));
+#endif
+	#undef ALLOC_EFFECT_PROPERTY
+}
+
+void FAudio_INTERNAL_FreeEffectChain(FAudioVoiceEffects *effects)
+{
+	uint32_t i;
+
+	if (effects->count == 0)
+	{
+		return;
+	}
+
+	for (i = 0; i < effects->count; i += 1)
+	{
+		effects->desc[i].pEffect->Release(effects->desc[i].pEffect);
+		FAudio_free(effects->parameters[i]);
+	}
+
+	FAudio_free(effects->desc);
+	FAudio_free(effects->parameters);
+	FAudio_free(effects->parameterSizes);
+	FAudio_free(effects->parameterCapacities);
+	FAudio_free(effects->parameterUpdates);
+	FAudio_free(effects->inPlaceProcessing);
+#ifdef FAUDIO_PROFILE
+	FAudio_free(effects->profileTicks);
+	FAudio_free(effects->publishedTicks);
+#endif
+}
+
+void FAudio_INTERNAL_FreeSends(FAudioVoice *voice)
+{
+	uint32_t i;
+
+	for (i = 0; i < voice->sends.SendCount; i += 1)
+	{
+		FAudio_free(voice->sendCoefficients[i]);
+		FAudio_free(voice->mixSendCoefficients[i]);
+		FAudio_free(voice->mixCoefficients[i]);
+	}
+	if (voice->sendCoefficients != NULL)
+	{
+		FAudio_free(voice->sendCoefficients);
+		FAudio_free(voice->mixSendCoefficients);
+		FAudio_free(voice->mixCoefficients);
+		FAudio_free(voice->sendMix);
+	}
+	if (voice->sends.pSends != NULL)
+	{
+		FAudio_free(voice->sends.pSends);
+	}
+	FAudio_zero(&voice->sends, sizeof(FAudioVoiceSends));
+	voice->sendCoefficients = NULL;
+	voice->mixSendCoefficients = NULL;
+	voice->mixCoefficients = NULL;
+	voice->sendMix = NULL;
+}
+
+/* Source Voice Pool */
+
+static void FAudio_INTERNAL_FreePooledVoice(FAudioSourceVoice *voice)
+{
+	FAudio_PlatformDestroyMutex(voice->filterLock);
+	FAudio_PlatformDestroyMutex(voice->volumeLock);
+	FAudio_PlatformDestroyMutex(voice->src.bufferLock);
+	FAudio_free(voice->src.bufferQueue);
+	FAudio_free(voice->src.sincHistory);
+	FAudio_free(voice->src.blockCache);
+	FAudio_free(voice->filterState);
+	FAudio_free(voice->channelVolume);
+	FAudio_free(voice->mixChannelVolume);
+	FAudio_free(voice);
+}
+
+void FAudio_INTERNAL_SetSourceVoicePoolSize(FAudio *audio, uint32_t size)
+{
+	FAudio_PlatformLockMutex(audio->voicePoolLock);
+	while (audio->voicePoolCount > size)
+	{
+		audio->voicePoolCount -= 1;
+		FAudio_INTERNAL_FreePooledVoice(
+			audio->voicePool[audio->voicePoolCount]
+		);
+	}
+	if (size == 0)
+	{
+		FAudio_free(audio->voicePool);
+		audio->voicePool = NULL;
+	}
+	else
+	{
+		audio->voicePool = (FAudioSourceVoice**) FAudio_realloc(
+			audio->voicePool,
+			sizeof(FAudioSourceVoice*) * size
+		);
+	}
+	audio->voicePoolSize = size;
+	FAudio_PlatformUnlockMutex(audio->voicePoolLock);
+}
+
+uint8_t FAudio_INTERNAL_PoolSourceVoice(FAudioSourceVoice *voice)
+{
+	FAudio *audio = voice->audio;
+	FAudioVoice keep;
+
+	/* The sends and effects belong to the old owner. Releasing an effect
+	 * calls into it, so this happens before voicePoolLock is taken. If the
+	 * pool is full, DestroyVoice just finds them already gone.
+	 */
+	FAudio_INTERNAL_FreeSends(voice);
+	FAudio_INTERNAL_FreeEffectChain(&voice->effects);
+	FAudio_zero(&voice->effects, sizeof(voice->effects));
+	if (voice->outputChannels != voice->src.format.nChannels)
+	{
+		FAudio_free(voice->channelVolume);
+		FAudio_free(voice->mixChannelVolume);
+		voice->channelVolume = NULL;
+		voice->mixChannelVolume = NULL;
+	}
+
+	/* Everything else is reset, except for what only depends on the flags
+	 * and format. FAudio_CreateSourceVoice fills in the rest.
+	 */
+	FAudio_memcpy(&keep, voice, sizeof(FAudioVoice));
+	FAudio_zero(voice, sizeof(FAudioVoice));
+	voice->flags = keep.flags;
+	voice->filterLock = keep.filterLock;
+	voice->volumeLock = keep.volumeLock;
+	voice->filterState = keep.filterState;
+	voice->channelVolume = keep.channelVolume;
+	voice->mixChannelVolume = keep.mixChannelVolume;
+	voice->src.format = keep.src.format;
+	voice->src.bufferQueue = keep.src.bufferQueue;
+	voice->src.bufferLock = keep.src.bufferLock;
+	voice->src.sincHistory = keep.src.sincHistory;
+	voice->src.blockCache = keep.src.blockCache;
+
+	FAudio_PlatformLockMutex(audio->voicePoolLock);
+	if (audio->voicePoolCount == audio->voicePoolSize)
+	{
+		FAudio_PlatformUnlockMutex(audio->voicePoolLock);
+		FAudio_memcpy(voice, &keep, sizeof(FAudioVoice));
+		return 0;
+	}
+	audio->voicePool[audio->voicePoolCount] = voice;
+	audio->voicePoolCount += 1;
+	FAudio_PlatformUnlockMutex(audio->voicePoolLock);
+	return 1;
+}
+
+FAudioSourceVoice* FAudio_INTERNAL_TakePooledVoice(
+	FAudio *audio,
+	const FAudioWaveFormatEx *format,
+	uint32_t flags
+) {
+	uint32_t i;
+	FAudioSourceVoice *voice;
+
+	/* The kept allocations are sized by these, nothing else has to match */
+	FAudio_PlatformLockMutex(audio->voicePoolLock);
+	for (i = 0; i < audio->voicePoolCount; i += 1)
+	{
+		voice = audio->voicePool[i];
+		if (	voice->flags == flags &&
+			voice->src.format.wFormatTag == format->wFormatTag &&
+			voice->src.format.nChannels == format->nChannels &&
+			voice->src.format.nBlockAlign == format->nBlockAlign &&
+			voice->src.format.wBitsPerSample == format->wBitsPerSample	)
+		{
+			audio->voicePoolCount -= 1;
+			audio->voicePool[i] = audio->voicePool[audio->voicePoolCount];
+			FAudio_PlatformUnlockMutex(audio->voicePoolLock);
+			return voice;
+		}
+	}
+	FAudio_PlatformUnlockMutex(audio->voicePoolLock);
+	return NULL;
+}
+
+/* PCM Decoding */
+
+void FAudio_INTERNAL_DecodePCM8(
+	FAudioVoice *voice,
+	FAudioBuffer *buffer,
+	uint32_t curOffset,
+	float *decodeCache,
+	uint32_t samples
+) {
+	FAudio_INTERNAL_Kernels.convertU8ToF32(
+		((uint8_t*) buffer->pAudioData) + (
+			curOffset * voice->src.format.nChannels
+		),
+		decodeCache,
+		samples * voice->src.format.nChannels
+	);
+}
+
+void FAudio_INTERNAL_DecodePCM16(
+	FAudioVoice *voice,
+	FAudioBuffer *buffer,
+	uint32_t curOffset,
+	float *decodeCache,
+	uint32_t samples
+) {
+	FAudio_INTERNAL_Kernels.convertS16ToF32(
+		((int16_t*) buffer->pAudioData) + (
+			curOffset * voice->src.format.nChannels
+		),
+		decodeCache,
+		samples * voice->src.format.nChannels
+	);
+}
+
+void FAudio_INTERNAL_DecodePCM32F(
+	FAudioVoice *voice,
+	FAudioBuffer *buffer,
+	uint32_t curOffset,
+	float *decodeCache,
+	uint32_t samples
+) {
+	FAudio_memcpy(
+		decodeCache,
+		((float*) buffer->pAudioData) + (
+			curOffset * voice->src.format.nChannels
+		),
+		sizeof(float) * samples * voice->src.format.nChannels
+	);
+}
+
+/* MSADPCM Decoding */
+
+static const int32_t AdaptionTable[16] =
+{
+	230, 230, 230, 230, 307, 409, 512, 614,
+	768, 614, 512, 409, 307, 230, 230, 230
+};
+static const int32_t AdaptCoeff_1[7] =
+{
+	256, 512, 0, 192, 240, 460, 392
+};
+static const int32_t AdaptCoeff_2[7] =
+{
+	0, -256, 0, 64, 0, -208, -232
+};
+
+static inline int16_t FAudio_INTERNAL_ParseNibble(
+	uint8_t nibble,
+	uint8_t predictor,
+	int16_t *delta,
+	int16_t *sample1,
+	int16_t *sample2
+) {
+	int8_t signedNibble;
+	int32_t sampleInt;
+	int16_t sample;
+
+	signedNibble = (int8_t) nibble;
+	if (signedNibble & 0x08)
+	{
+		signedNibble -= 0x10;
+	}
+
+	sampleInt = (
+		(*sample1 * AdaptCoeff_1[predictor]) +
+		(*sample2 * AdaptCoeff_2[predictor])
+	) / 256;
+	sampleInt += signedNibble * (*delta);
+	sample = FAudio_clamp(sampleInt, -32768, 32767);
+
+	*sample2 = *sample1;
+	*sample1 = sample;
+	*delta = (int16_t) (AdaptionTable[nibble] * (int32_t) (*delta) / 256);
+	if (*delta < 16)
+	{
+		*delta = 16;
+	}
+	return sample;
+}
+
+#define READ(item, type) \
+	item = *((type*) *buf); \
+	*buf += sizeof(type);
+
+static inline void FAudio_INTERNAL_DecodeMonoMSADPCMBlock(
+	uint8_t **buf,
+	int16_t *blockCache,
+	uint32_t align
+) {
+	uint32_t i;
+
+	/* Temp storage for ADPCM blocks */
+	uint8_t predictor;
+	int16_t delta;
+	int16_t sample1;
+	int16_t sample2;
+
+	/* Preamble */
+	READ(predictor, uint8_t)
+	READ(delta, int16_t)
+	READ(sample1, int16_t)
+	READ(sample2, int16_t)
+	align -= 7;
+
+	/* Samples */
+	*blockCache++ = sample2;
+	*blockCache++ = sample1;
+	for (i = 0; i < align; i += 1, *buf += 1)
+	{
+		*blockCache++ = FAudio_INTERNAL_ParseNibble(
+			*(*buf) >> 4,
+			predictor,
+			&delta,
+			&sample1,
+			&sample2
+		);
+		*blockCache++ = FAudio_INTERNAL_ParseNibble(
+			*(*buf) & 0x0F,
+			predictor,
+			&delta,
+			&sample1,
+			&sample2
+		);
+	}
+}
+
+static inline void FAudio_INTERNAL_DecodeStereoMSADPCMBlock(
+	uint8_t **buf,
+	int16_t *blockCache,
+	uint32_t align
+) {
+	uint32_t i;
+
+	/* Temp storage for ADPCM blocks */
+	uint8_t l_predictor;
+	uint8_t r_predictor;
+	int16_t l_delta;
+	int16_t r_delta;
+	int16_t l_sample1;
+	int16_t r_sample1;
+	int16_t l_sample2;
+	int16_t r_sample2;
+
+	/* Preamble */
+	READ(l_predictor, uint8_t)
+	READ(r_predictor, uint8_t)
+	READ(l_delta, int16_t)
+	READ(r_delta, int16_t)
+	READ(l_sample1, int16_t)
+	READ(r_sample1, int16_t)
+	READ(l_sample2, int16_t)
+	READ(r_sample2, int16_t)
+	align -= 14;
+
+	/* Samples */
+	*blockCache++ = l_sample2;
+	*blockCache++ = r_sample2;
+	*blockCache++ = l_sample1;
+	*blockCache++ = r_sample1;
+	for (i = 0; i < align; i += 1, *buf += 1)
+	{
+		*blockCache++ = FAudio_INTERNAL_ParseNibble(
+			*(*buf) >> 4,
+			l_predictor,
+			&l_delta,
+			&l_sample1,
+			&l_sample2
+		);
+		*blockCache++ = FAudio_INTERNAL_ParseNibble(
+			*(*buf) & 0x0F,
+			r_predictor,
+			&r_delta,
+			&r_sample1,
+			&r_sample2
+		);
+	}
+}
+
+#undef READ
+
+void FAudio_INTERNAL_DecodeMSADPCMBlocks_Scalar(
+	uint8_t *buf,
+	int16_t *restrict blockCache,
+	uint32_t blocks,
+	uint32_t align,
+	uint16_t channels
+) {
+	uint32_t i;
+	const uint32_t blockSamples = ((align / channels) - 6) * 2 * channels;
+
+	for (i = 0; i < blocks; i += 1)
+	{
+		if (channels == 2)
+		{
+			FAudio_INTERNAL_DecodeStereoMSADPCMBlock(
+				&buf,
+				blockCache,
+				align
+			);
+		}
+		else
+		{
+			FAudio_INTERNAL_DecodeMonoMSADPCMBlock(
+				&buf,
+				blockCache,
+				align
+			);
+		}
+		blockCache += blockSamples;
+	}
+}
+
+/* Shared MSADPCM Block Cache */
+
+static inline uint32_t FAudio_INTERNAL_DecodeCacheHash(const uint8_t *src)
+{
+	return (uint32_t) (
+		((uint64_t) (size_t) src * 0x9E3779B97F4A7C15ULL) >>
+		(64 - DECODE_CACHE_BITS)
+	);
+}
+
+static inline FAudioDecodeCacheShard* FAudio_INTERNAL_DecodeCacheShard(
+	FAudio *audio,
+	const uint8_t *src
+) {
+	return &audio->decodeCache[
+		FAudio_INTERNAL_DecodeCacheHash(src) & (DECODE_CACHE_SHARDS - 1)
+	];
+}
+
+static inline FAudioDecodeCacheEntry** FAudio_INTERNAL_DecodeCacheBucket(
+	FAudioDecodeCacheShard *shard,
+	const uint8_t *src
+) {
+	return &shard->buckets[
+		FAudio_INTERNAL_DecodeCacheHash(src) >> DECODE_CACHE_SHARD_BITS
+	];
+}
+
+static FAudioDecodeCacheEntry* FAudio_INTERNAL_FindDecodeCacheEntry(
+	FAudioDecodeCacheShard *shard,
+	const uint8_t *src,
+	uint16_t align,
+	uint16_t channels
+) {
+	FAudioDecodeCacheEntry *entry;
+
+	entry = *FAudio_INTERNAL_DecodeCacheBucket(shard, src);
+	while (	entry != NULL &&
+		(entry->src != src || entry->align != align || entry->channels != channels)	)
+	{
+		entry = entry->hashNext;
+	}
+	return entry;
+}
+
+static void FAudio_INTERNAL_UnlinkDecodeCacheEntry(
+	FAudioDecodeCacheShard *shard,
+	FAudioDecodeCacheEntry *entry
+) {
+	FAudioDecodeCacheEntry **link;
+
+	link = FAudio_INTERNAL_DecodeCacheBucket(shard, entry->src);
+	while (*link != entry)
+	{
+		link = &(*link)->hashNext;
+	}
+	*link = entry->hashNext;
+
+	if (entry->newer != NULL)
+	{
+		entry->newer->older = entry->older;
+	}
+	else
+	{
+		shard->newest = entry->older;
+	}
+	if (entry->older != NULL)
+	{
+		entry->older->newer = entry->newer;
+	}
+	else
+	{
+		shard->oldest = entry->newer;
+	}
+}
+
+static void FAudio_INTERNAL_LinkDecodeCacheEntry(
+	FAudioDecodeCacheShard *shard,
+	FAudioDecodeCacheEntry *entry
+) {
+	FAudioDecodeCacheEntry **bucket = FAudio_INTERNAL_DecodeCacheBucket(
+		shard,
+		entry->src
+	);
+	entry->hashNext = *bucket;
+	*bucket = entry;
+
+	entry->newer = NULL;
+	entry->older = shard->newest;
+	if (shard->newest != NULL)
+	{
+		shard->newest->newer = entry;
+	}
+	else
+	{
+		shard->oldest = entry;
+	}
+	shard->newest = entry;
+}
+
+static void FAudio_INTERNAL_ResizeDecodeCache(FAudio *audio)
+{
+	FAudioDecodeCacheShard *shard;
+	FAudioDecodeCacheEntry *entry, *old, *freeList;
+	uint8_t *pool, *oldPool;
+	uint32_t i, j, count, slots, stride, pcmBytes;
+
+	/* Caller holds decodeCacheLock */
+	count = 0;
+	stride = 0;
+	if (audio->decodeCacheSize > 0 && audio->decodeCacheSlotBytes > 0)
+	{
+		stride = sizeof(FAudioDecodeCacheEntry) + audio->decodeCacheSlotBytes;
+		stride = (stride + 15) & ~15;
+		count = audio->decodeCacheSize / stride;
+	}
+
+	for (i = 0; i < DECODE_CACHE_SHARDS; i += 1)
+	{
+		shard = &audio->decodeCache[i];
+
+		/* Build this shard's share of the slots without its lock... */
+		slots = count / DECODE_CACHE_SHARDS;
+		if (i < (count % DECODE_CACHE_SHARDS))
+		{
+			slots += 1;
+		}
+		pool = NULL;
+		freeList = NULL;
+		if (slots > 0)
+		{
+			pool = (uint8_t*) FAudio_malloc(stride * slots);
+			for (j = 0; j < slots; j += 1)
+			{
+				entry = (FAudioDecodeCacheEntry*) (pool + (stride * j));
+				entry->pcm = (int16_t*) (entry + 1);
+				entry->hashNext = freeList;
+				freeList = entry;
+			}
+		}
+
+		/* ... then swap it in, carrying over the newest entries that fit */
+		FAudio_PlatformLockMutex(shard->lock);
+		old = (slots > 0) ? shard->newest : NULL;
+		for (j = 1; old != NULL && old->older != NULL && j < slots; j += 1)
+		{
+			old = old->older;
+		}
+		FAudio_zero(shard->buckets, sizeof(shard->buckets));
+		shard->newest = NULL;
+		shard->oldest = NULL;
+		shard->free = freeList;
+		while (old != NULL)
+		{
+			entry = shard->free;
+			shard->free = entry->hashNext;
+			pcmBytes = (uint32_t) (old->encoded - (uint8_t*) old->pcm);
+			entry->src = old->src;
+			entry->align = old->align;
+			entry->channels = old->channels;
+			entry->encoded = ((uint8_t*) entry->pcm) + pcmBytes;
+			FAudio_memcpy(entry->pcm, old->pcm, pcmBytes + old->align);
+			FAudio_INTERNAL_LinkDecodeCacheEntry(shard, entry);
+			old = old->newer;
+		}
+		oldPool = shard->pool;
+		shard->pool = pool;
+		shard->slotBytes = (slots > 0) ? audio->decodeCacheSlotBytes : 0;
+		FAudio_PlatformUnlockMutex(shard->lock);
+
+		FAudio_free(oldPool);
+	}
+}
+
+void FAudio_INTERNAL_SetDecodeCacheSize(FAudio *audio, uint32_t size)
+{
+	FAudio_PlatformLockMutex(audio->decodeCacheLock);
+	audio->decodeCacheSize = size;
+	FAudio_INTERNAL_ResizeDecodeCache(audio);
+	FAudio_PlatformUnlockMutex(audio->decodeCacheLock);
+}
+
+void FAudio_INTERNAL_ReserveDecodeCache(FAudio *audio, uint32_t slotBytes)
+{
+	FAudio_PlatformLockMutex(audio->decodeCacheLock);
+	if (slotBytes > audio->decodeCacheSlotBytes)
+	{
+		audio->decodeCacheSlotBytes = slotBytes;
+		if (audio->decodeCacheSize > 0)
+		{
+			FAudio_INTERNAL_ResizeDecodeCache(audio);
+		}
+	}
+	FAudio_PlatformUnlockMutex(audio->decodeCacheLock);
+}
+
+/* Returns the decoded block at buf, from (in order) the voice's block cache,
+ * the engine's shared cache, or by decoding it along with as many of the
+ * following blocks as fit in the lanes. end is the end of the buffer.
+ */
+static int16_t* FAudio_INTERNAL_LoadMSADPCMBlock(
+	FAudioVoice *voice,
+	uint8_t *buf,
+	uint8_t *end
+) {
+	FAudio *audio = voice->audio;
+	FAudioDecodeCacheShard *shard;
+	FAudioDecodeCacheEntry *entry;
+	const uint16_t align = voice->src.format.nBlockAlign;
+	const uint16_t channels = voice->src.format.nChannels;
+	const uint32_t blockSamples = ((align / channels) - 6) * 2 * channels;
+	const uint32_t pcmBytes = sizeof(int16_t) * blockSamples;
+	uint32_t blocks, i;
+	uint8_t *src;
+
+	if (	voice->src.blockCacheSrc != NULL &&
+		buf >= voice->src.blockCacheSrc &&
+		buf < voice->src.blockCacheSrc + (voice->src.blockCacheCount * align)	)
+	{
+		return voice->src.blockCache + (
+			((buf - voice->src.blockCacheSrc) / align) *
+			blockSamples
+		);
+	}
+	voice->src.blockCacheSrc = buf;
+	voice->src.blockCacheCount = 1;
+
+	/* Shared cache hit? Only this block's shard is locked. */
+	shard = FAudio_INTERNAL_DecodeCacheShard(audio, buf);
+	FAudio_PlatformLockMutex(shard->lock);
+	entry = FAudio_INTERNAL_FindDecodeCacheEntry(
+		shard,
+		buf,
+		align,
+		channels
+	);
+	if (entry != NULL)
+	{
+		FAudio_INTERNAL_UnlinkDecodeCacheEntry(shard, entry);
+		if (FAudio_memcmp(entry->encoded, buf, align) == 0)
+		{
+			FAudio_memcpy(voice->src.blockCache, entry->pcm, pcmBytes);
+			FAudio_INTERNAL_LinkDecodeCacheEntry(shard, entry);
+			FAudio_PlatformUnlockMutex(shard->lock);
+			return voice->src.blockCache;
+		}
+
+		/* The memory was reused for something else */
+		entry->hashNext = shard->free;
+		shard->free = entry;
+	}
+	FAudio_PlatformUnlockMutex(shard->lock);
+
+	/* Decode, reading ahead only into whole blocks of this buffer... */
+	blocks = (end > buf) ? (uint32_t) ((end - buf) / align) : 0;
+	blocks = FAudio_clamp(blocks, 1, MSADPCM_LANES / channels);
+	FAudio_INTERNAL_Kernels.decodeMSADPCMBlocks(
+		buf,
+		voice->src.blockCache,
+		blocks,
+		align,
+		channels
+	);
+	voice->src.blockCacheCount = blocks;
+
+	/* ... then share them, in a free slot or the shard's oldest */
+	for (i = 0; i < blocks; i += 1)
+	{
+		src = buf + (i * align);
+		shard = FAudio_INTERNAL_DecodeCacheShard(audio, src);
+		FAudio_PlatformLockMutex(shard->lock);
+		if ((pcmBytes + align) > shard->slotBytes)
+		{
+			/* The cache is off, or this shard got no slots */
+			FAudio_PlatformUnlockMutex(shard->lock);
+			continue;
+		}
+		entry = FAudio_INTERNAL_FindDecodeCacheEntry(
+			shard,
+			src,
+			align,
+			channels
+		);
+		if (entry == NULL && shard->free != NULL)
+		{
+			entry = shard->free;
+			shard->free = entry->hashNext;
+		}
+		else
+		{
+			if (entry == NULL)
+			{
+				entry = shard->oldest;
+			}
+			if (entry != NULL)
+			{
+				FAudio_INTERNAL_UnlinkDecodeCacheEntry(shard, entry);
+			}
+		}
+		if (entry != NULL)
+		{
+			entry->src = src;
+			entry->align = align;
+			entry->channels = channels;
+			entry->encoded = ((uint8_t*) entry->pcm) + pcmBytes;
+			FAudio_memcpy(
+				entry->pcm,
+				voice->src.blockCache + (i * blockSamples),
+				pcmBytes
+			);
+			FAudio_memcpy(entry->encoded, src, align);
+			FAudio_INTERNAL_LinkDecodeCacheEntry(shard, entry);
+		}
+		FAudio_PlatformUnlockMutex(shard->lock);
+	}
+	return voice->src.blockCache;
+}
+
+void FAudio_INTERNAL_DecodeMonoMSADPCM(
+	FAudioVoice *voice,
+	FAudioBuffer *buffer,
+	uint32_t curOffset,
+	float *decodeCache,
+	uint32_t samples
+) {
+	/* Loop variables */
+	uint32_t copy;
+
+	/* Read pointers */
+	uint8_t *buf;
+	uint8_t *end = (uint8_t*) buffer->pAudioData + buffer->AudioBytes;
+	int32_t midOffset;
+
+	/* Block size */
+	uint32_t align = voice->src.format.nBlockAlign;
+	uint32_t bsize = (align - 6) * 2;
+
+	/* Where are we starting? */
+	buf = (uint8_t*) buffer->pAudioData + (
+		(curOffset / bsize) *
+		align
+	);
+
+	/* Are we starting in the middle? */
+	midOffset = (curOffset % bsize);
+
+	/* Copy each block to the decode cache, decoding only the blocks
+	 * nobody has already decoded
+	 */
+	while (samples > 0)
+	{
+		copy = FAudio_min(samples, bsize - midOffset);
+		FAudio_INTERNAL_Kernels.convertS16ToF32(
+			FAudio_INTERNAL_LoadMSADPCMBlock(voice, buf, end) + midOffset,
+			decodeCache,
+			copy
+		);
+		buf += align;
+		decodeCache += copy;
+		samples -= copy;
+		midOffset = 0;
+	}
+}
+
+void FAudio_INTERNAL_DecodeStereoMSADPCM(
+	FAudioVoice *voice,
+	FAudioBuffer *buffer,
+	uint32_t curOffset,
+	float *decodeCache,
+	uint32_t samples
+) {
+	/* Loop variables */
+	uint32_t copy;
+
+	/* Read pointers */
+	uint8_t *buf;
+	uint8_t *end = (uint8_t*) buffer->pAudioData + buffer->AudioBytes;
+	int32_t midOffset;
+
+	/* Align, block size */
+	uint32_t align = voice->src.format.nBlockAlign;
+	uint32_t bsize = ((align / 2) - 6) * 2;
+
+	/* Where are we starting? */
+	buf = (uint8_t*) buffer->pAudioData + (
 		(curOffset / bsize) *
-		format->nBlockAlign
+		align
+	);
+
+	/* Are we starting in the middle? */
+	midOffset = (curOffset % bsize);
+
+	/* Copy each block to the decode cache, decoding only the blocks
+	 * nobody has already decoded
+	 */
+	while (samples > 0)
+	{
+		copy = FAudio_min(samples, bsize - midOffset);
+		FAudio_INTERNAL_Kernels.convertS16ToF32(
+			FAudio_INTERNAL_LoadMSADPCMBlock(voice, buf, end) + (midOffset * 2),
+			decodeCache,
+			copy * 2
+		);
+		buf += align;
+		decodeCache += copy * 2;
+		samples -= copy;
+		midOffset = 0;
+	}
+}
+
+/* Type Converters */
+
+/* The SSE/NEON converters are based on SDL_audiotypecvt:
+ * https://hg.libsdl.org/SDL/file/default/src/audio/SDL_audiotypecvt.c
+ * The SSE/NEON detection comes from MojoAL:
+ * https://hg.icculus.org/icculus/mojoAL/file/default/mojoal.c
+ */
+
+#if defined(__x86_64__)
+#define NEED_SCALAR_CONVERTER_FALLBACKS 0  /* x86_64 guarantees SSE2. */
+#elif __MACOSX__
+#define NEED_SCALAR_CONVERTER_FALLBACKS 0  /* Mac OS X/Intel guarantees SSE2. */
+#elif defined(__ARM_ARCH) && (__ARM_ARCH >= 8)
+#define NEED_SCALAR_CONVERTER_FALLBACKS 0  /* ARMv8+ promise NEON. */
+#elif defined(__APPLE__) && defined(__ARM_ARCH) && (__ARM_ARCH >= 7)
+#define NEED_SCALAR_CONVERTER_FALLBACKS 0  /* All Apple ARMv7 chips promise NEON support. */
+#else
+#define NEED_SCALAR_CONVERTER_FALLBACKS 1
+#endif
+
+/* Some platforms fail to define __ARM_NEON__, others need it or arm_neon.h will fail. */
+#if (defined(__ARM_ARCH) || defined(_M_ARM))
+#  if !NEED_SCALAR_CONVERTER_FALLBACKS && !defined(__ARM_NEON__)
+#    define __ARM_NEON__ 1
+#  endif
+#endif
+
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#define HAVE_NEON_INTRINSICS 1
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define HAVE_SSE2_INTRINSICS 1
+#endif
+
+/* AVX is never guaranteed, so unless the whole build targets it we only
+ * enable it for the functions that use it, then pick them at runtime.
+ */
+#if HAVE_SSE2_INTRINSICS
+#if defined(__AVX__)
+#include <immintrin.h>
+#define HAVE_AVX_INTRINSICS 1
+#define FAUDIO_TARGET_AVX
+#elif defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_AVX_INTRINSICS 1
+#define FAUDIO_TARGET_AVX __attribute__((target("avx")))
+#endif
+#if defined(__AVX2__)
+#define HAVE_AVX2_INTRINSICS 1
+#define FAUDIO_TARGET_AVX2
+#elif defined(__GNUC__)
+#define HAVE_AVX2_INTRINSICS 1
+#define FAUDIO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+/* ARMv7 NEON has no double lanes, which the resamplers need */
+#if HAVE_NEON_INTRINSICS && defined(__aarch64__)
+#define HAVE_NEON_F64_INTRINSICS 1
+#endif
+
+#define DIVBY128 0.0078125f
+#define DIVBY32768 0.000030517578125f
+
+void FAudio_INTERNAL_Convert_U8_To_F32_Scalar(
+	const uint8_t *restrict src,
+	float *restrict dst,
+	uint32_t len
+) {
+	uint32_t i;
+	for (i = 0; i < len; i += 1)
+	{
+		*dst++ = (*src++ * DIVBY128) - 1.0f;
+	}
+}
+
+void FAudio_INTERNAL_Convert_S16_To_F32_Scalar(
+	const int16_t *restrict src,
+	float *restrict dst,
+	uint32_t len
+) {
+	uint32_t i;
+	for (i = 0; i < len; i += 1)
+	{
+		*dst++ = *src++ * DIVBY32768;
+	}
+}
+
+#if HAVE_SSE2_INTRINSICS
+void FAudio_INTERNAL_Convert_U8_To_F32_SSE2(
+	const uint8_t *restrict src,
+	float *restrict dst,
+	uint32_t len
+) {
+    int i;
+    src += len - 1;
+    dst += len - 1;
+
+    /* Get dst aligned to 16 bytes (since buffer is growing, we don't have to worry about overreading from src) */
+    for (i = len; i && (((size_t) (dst-15)) & 15); --i, --src, --dst) {
+        *dst = (((float) *src) * DIVBY128) - 1.0f;
+    }
+
+    src -= 15; dst -= 15;  /* adjust to read SSE blocks from the start. */
+    FAudio_assert(!i || ((((size_t) dst) & 15) == 0));
+
+    /* Make sure src is aligned too. */
+    if ((((size_t) src) & 15) == 0) {
+        /* Aligned! Do SSE blocks as long as we have 16 bytes available. */
+        const __m128i *mmsrc = (const __m128i *) src;
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 divby128 = _mm_set1_ps(DIVBY128);
+        const __m128 minus1 = _mm_set1_ps(-1.0f);
+        while (i >= 16) {   /* 16 * 8-bit */
+            const __m128i bytes = _mm_load_si128(mmsrc);  /* get 16 uint8 into an XMM register. */
+            /* treat as int16, shift left to clear every other sint16, then back right with zero-extend. Now uint16. */
+            const __m128i shorts1 = _mm_srli_epi16(_mm_slli_epi16(bytes, 8), 8);
+            /* right-shift-zero-extend gets us uint16 with the other set of values. */
+            const __m128i shorts2 = _mm_srli_epi16(bytes, 8);
+            /* unpack against zero to make these int32, convert to float, multiply, add. Whew! */
+            /* Note that AVX2 can do floating point multiply+add in one instruction, fwiw. SSE2 cannot. */
+            const __m128 floats1 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(shorts1, zero)), divby128), minus1);
+            const __m128 floats2 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(shorts2, zero)), divby128), minus1);
+            const __m128 floats3 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(shorts1, zero)), divby128), minus1);
+            const __m128 floats4 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(shorts2, zero)), divby128), minus1);
+            /* Interleave back into correct order, store. */
+            _mm_store_ps(dst, _mm_unpacklo_ps(floats1, floats2));
+            _mm_store_ps(dst+4, _mm_unpackhi_ps(floats1, floats2));
+            _mm_store_ps(dst+8, _mm_unpacklo_ps(floats3, floats4));
+            _mm_store_ps(dst+12, _mm_unpackhi_ps(floats3, floats4));
+            i -= 16; mmsrc--; dst -= 16;
+        }
+
+        src = (const uint8_t *) mmsrc;
+    }
+
+    src += 15; dst += 15;  /* adjust for any scalar finishing. */
+
+    /* Finish off any leftovers with scalar operations. */
+    while (i) {
+        *dst = (((float) *src) * DIVBY128) - 1.0f;
+        i--; src--; dst--;
+    }
+}
+
+void FAudio_INTERNAL_Convert_S16_To_F32_SSE2(
+	const int16_t *restrict src,
+	float *restrict dst,
+	uint32_t len
+) {
+    int i;
+    src += len - 1;
+    dst += len - 1;
+
+    /* Get dst aligned to 16 bytes (since buffer is growing, we don't have to worry about overreading from src) */
+    for (i = len; i && (((size_t) (dst-7)) & 15); --i, --src, --dst) {
+        *dst = ((float) *src) * DIVBY32768;
+    }
+
+    src -= 7; dst -= 7;  /* adjust to read SSE blocks from the start. */
+    FAudio_assert(!i || ((((size_t) dst) & 15) == 0));
+
+    /* Make sure src is aligned too. */
+    if ((((size_t) src) & 15) == 0) {
+        /* Aligned! Do SSE blocks as long as we have 16 bytes available. */
+        const __m128 divby32768 = _mm_set1_ps(DIVBY32768);
+        while (i >= 8) {   /* 8 * 16-bit */
+            const __m128i ints = _mm_load_si128((__m128i const *) src);  /* get 8 sint16 into an XMM register. */
+            /* treat as int32, shift left to clear every other sint16, then back right with sign-extend. Now sint32. */
+            const __m128i a = _mm_srai_epi32(_mm_slli_epi32(ints, 16), 16);
+            /* right-shift-sign-extend gets us sint32 with the other set of values. */
+            const __m128i b = _mm_srai_epi32(ints, 16);
+            /* Interleave these back into the right order, convert to float, multiply, store. */
+            _mm_store_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi32(a, b)), divby32768));
+            _mm_store_ps(dst+4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi32(a, b)), divby32768));
+            i -= 8; src -= 8; dst -= 8;
+        }
+    }
+
+    src += 7; dst += 7;  /* adjust for any scalar finishing. */
+
+    /* Finish off any leftovers with scalar operations. */
+    while (i) {
+        *dst = ((float) *src) * DIVBY32768;
+        i--; src--; dst--;
+    }
+}
+#endif /* HAVE_SSE2_INTRINSICS */
+
+#if HAVE_AVX2_INTRINSICS
+/* AVX2 widens 8 samples straight to int32, so unlike the SSE2 versions these
+ * need no shuffling and can run forward with unaligned loads and stores.
+ */
+FAUDIO_TARGET_AVX2 void FAudio_INTERNAL_Convert_U8_To_F32_AVX2(
+	const uint8_t *restrict src,
+	float *restrict dst,
+	uint32_t len
+) {
+	uint32_t i;
+	const __m256 divby128 = _mm256_set1_ps(DIVBY128);
+	const __m256 minus1 = _mm256_set1_ps(-1.0f);
+	for (i = 0; i + 16 <= len; i += 16, src += 16, dst += 16)
+	{
+		const __m128i bytes = _mm_loadu_si128((const __m128i*) src);
+		const __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+		const __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
+			_mm_srli_si128(bytes, 8)
+		));
+		_mm256_storeu_ps(dst, _mm256_add_ps(_mm256_mul_ps(lo, divby128), minus1));
+		_mm256_storeu_ps(dst + 8, _mm256_add_ps(_mm256_mul_ps(hi, divby128), minus1));
+	}
+	for (; i < len; i += 1)
+	{
+		*dst++ = (*src++ * DIVBY128) - 1.0f;
+	}
+}
+
+FAUDIO_TARGET_AVX2 void FAudio_INTERNAL_Convert_S16_To_F32_AVX2(
+	const int16_t *restrict src,
+	float *restrict dst,
+	uint32_t len
+) {
+	uint32_t i;
+	const __m256 divby32768 = _mm256_set1_ps(DIVBY32768);
+	for (i = 0; i + 16 <= len; i += 16, src += 16, dst += 16)
+	{
+		const __m256i shorts = _mm256_loadu_si256((const __m256i*) src);
+		const __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+			_mm256_castsi256_si128(shorts)
+		));
+		const __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+			_mm256_extracti128_si256(shorts, 1)
+		));
+		_mm256_storeu_ps(dst, _mm256_mul_ps(lo, divby32768));
+		_mm256_storeu_ps(dst + 8, _mm256_mul_ps(hi, divby32768));
+	}
+	for (; i < len; i += 1)
+	{
+		*dst++ = *src++ * DIVBY32768;
+	}
+}
+#endif /* HAVE_AVX2_INTRINSICS */
+
+#if HAVE_NEON_INTRINSICS
+void FAudio_INTERNAL_Convert_U8_To_F32_NEON(
+	const uint8_t *restrict src,
+	float *restrict dst,
+	uint32_t len
+) {
+    int i;
+    src += len - 1;
+    dst += len - 1;
+
+    /* Get dst aligned to 16 bytes (since buffer is growing, we don't have to worry about overreading from src) */
+    for (i = len; i && (((size_t) (dst-15)) & 15); --i, --src, --dst) {
+        *dst = (((float) *src) * DIVBY128) - 1.0f;
+    }
+
+    src -= 15; dst -= 15;  /* adjust to read NEON blocks from the start. */
+    FAudio_assert(!i || ((((size_t) dst) & 15) == 0));
+
+    /* Make sure src is aligned too. */
+    if ((((size_t) src) & 15) == 0) {
+        /* Aligned! Do NEON blocks as long as we have 16 bytes available. */
+        const uint8_t *mmsrc = (const uint8_t *) src;
+        const float32x4_t divby128 = vdupq_n_f32(DIVBY128);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        while (i >= 16) {   /* 16 * 8-bit */
+            const uint8x16_t bytes = vld1q_u8(mmsrc);  /* get 16 uint8 into a NEON register. */
+            const uint16x8_t uint16hi = vmovl_u8(vget_high_u8(bytes));  /* convert top 8 bytes to 8 uint16 */
+            const uint16x8_t uint16lo = vmovl_u8(vget_low_u8(bytes));   /* convert bottom 8 bytes to 8 uint16 */
+            /* split uint16 to two uint32, then convert to float, then multiply to normalize, subtract to adjust for sign, store. */
+            vst1q_f32(dst, vmlsq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(uint16hi))), divby128, one));
+            vst1q_f32(dst+4, vmlsq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(uint16hi))), divby128, one));
+            vst1q_f32(dst+8, vmlsq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(uint16lo))), divby128, one));
+            vst1q_f32(dst+12, vmlsq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(uint16lo))), divby128, one));
+            i -= 16; mmsrc -= 16; dst -= 16;
+        }
+
+        src = (const uint8_t *) mmsrc;
+    }
+
+    src += 15; dst += 15;  /* adjust for any scalar finishing. */
+
+    /* Finish off any leftovers with scalar operations. */
+    while (i) {
+        *dst = (((float) *src) * DIVBY128) - 1.0f;
+        i--; src--; dst--;
+    }
+}
+
+void FAudio_INTERNAL_Convert_S16_To_F32_NEON(
+	const int16_t *restrict src,
+	float *restrict dst,
+	uint32_t len
+) {
+    int i;
+    src += len - 1;
+    dst += len - 1;
+
+    /* Get dst aligned to 16 bytes (since buffer is growing, we don't have to worry about overreading from src) */
+    for (i = len; i && (((size_t) (dst-7)) & 15); --i, --src, --dst) {
+        *dst = ((float) *src) * DIVBY32768;
+    }
+
+    src -= 7; dst -= 7;  /* adjust to read NEON blocks from the start. */
+    FAudio_assert(!i || ((((size_t) dst) & 15) == 0));
+
+    /* Make sure src is aligned too. */
+    if ((((size_t) src) & 15) == 0) {
+        /* Aligned! Do NEON blocks as long as we have 16 bytes available. */
+        const float32x4_t divby32768 = vdupq_n_f32(DIVBY32768);
+        while (i >= 8) {   /* 8 * 16-bit */
+            const int16x8_t ints = vld1q_s16((int16_t const *) src);  /* get 8 sint16 into a NEON register. */
+            /* split int16 to two int32, then convert to float, then multiply to normalize, store. */
+            vst1q_f32(dst, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(ints))), divby32768));
+            vst1q_f32(dst+4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(ints))), divby32768));
+            i -= 8; src -= 8; dst -= 8;
+        }
+    }
+
+    src += 7; dst += 7;  /* adjust for any scalar finishing. */
+
+    /* Finish off any leftovers with scalar operations. */
+    while (i) {
+        *dst = ((float) *src) * DIVBY32768;
+        i--; src--; dst--;
+    }
+}
+#endif /* HAVE_NEON_INTRINSICS */
+
+/* MSADPCM Lane Decoders */
+
+/* These run one channel of one block per lane, which must give the exact
+ * same output as FAudio_INTERNAL_ParseNibble. Each lane is still sequential,
+ * so the gain comes from running up to MSADPCM_LANES of them side by side.
+ * Blocks with an invalid predictor go to the scalar decoder.
+ */
+
+#if HAVE_SSE2_INTRINSICS || HAVE_NEON_INTRINSICS
+typedef struct FAudioMSADPCMLanes
+{
+	uint32_t count;
+	uint32_t bytes; /* Nibble data per block */
+	uint8_t *data[MSADPCM_LANES];
+	int16_t *output[MSADPCM_LANES]; /* Stride is the channel count */
+	int32_t predictor[MSADPCM_LANES];
+	int32_t delta[MSADPCM_LANES];
+	int32_t sample1[MSADPCM_LANES];
+	int32_t sample2[MSADPCM_LANES];
+} FAudioMSADPCMLanes;
+
+/* Reads the preambles and writes the first two samples of every lane.
+ * Returns 0 if the scalar decoder has to take these blocks instead.
+ */
+static inline uint8_t FAudio_INTERNAL_InitMSADPCMLanes(
+	FAudioMSADPCMLanes *lanes,
+	uint8_t *buf,
+	int16_t *blockCache,
+	uint32_t blocks,
+	uint32_t align,
+	uint16_t channels
+) {
+	uint32_t i, c;
+	uint8_t *block;
+	const uint32_t blockSamples = ((align / channels) - 6) * 2 * channels;
+
+	lanes->count = blocks * channels;
+	lanes->bytes = align - (channels * 7);
+	for (i = 0; i < MSADPCM_LANES; i += 1)
+	{
+		/* Unused lanes decode the first channel again, harmlessly */
+		c = (i < lanes->count) ? (i % channels) : 0;
+		block = buf + ((i < lanes->count) ? (i / channels) * align : 0);
+		lanes->predictor[i] = block[c];
+		if (lanes->predictor[i] >= 7)
+		{
+			return 0;
+		}
+		lanes->delta[i] = *((int16_t*) (block + channels + (c * 2)));
+		lanes->sample1[i] = *((int16_t*) (block + (channels * 3) + (c * 2)));
+		lanes->sample2[i] = *((int16_t*) (block + (channels * 5) + (c * 2)));
+		lanes->data[i] = block + (channels * 7);
+		lanes->output[i] = blockCache + ((i / channels) * blockSamples) + c;
+		if (i < lanes->count)
+		{
+			lanes->output[i][0] = (int16_t) lanes->sample2[i];
+			lanes->output[i][channels] = (int16_t) lanes->sample1[i];
+			lanes->output[i] += channels * 2;
+		}
+	}
+	return 1;
+}
+
+static inline void FAudio_INTERNAL_StoreMSADPCMLanes(
+	FAudioMSADPCMLanes *lanes,
+	const int32_t *sample,
+	uint32_t channels
+) {
+	uint32_t i;
+	for (i = 0; i < lanes->count; i += 1)
+	{
+		*lanes->output[i] = (int16_t) sample[i];
+		lanes->output[i] += channels;
+	}
+}
+#endif /* HAVE_SSE2_INTRINSICS || HAVE_NEON_INTRINSICS */
+
+#if HAVE_SSE2_INTRINSICS
+/* Signed x / 256, rounded toward zero like C division */
+static inline __m128i FAudio_INTERNAL_Div256_SSE2(__m128i x)
+{
+	return _mm_srai_epi32(
+		_mm_add_epi32(x, _mm_srli_epi32(_mm_srai_epi32(x, 31), 24)),
+		8
+	);
+}
+
+/* history holds an int16 pair per lane, sample1 low and sample2 high, so
+ * that _mm_madd_epi16 does the whole predictor in one go. delta is kept as
+ * zero-extended int16 for the same reason.
+ */
+static inline void FAudio_INTERNAL_ParseNibbles_SSE2(
+	FAudioMSADPCMLanes *lanes,
+	uint8_t n0,
+	uint8_t n1,
+	uint8_t n2,
+	uint8_t n3,
+	uint32_t channels,
+	__m128i coeff,
+	__m128i *history,
+	__m128i *delta
+) {
+	int32_t sample[MSADPCM_LANES];
+	__m128i signedNibble, predicted, clamped;
+	const __m128i eight = _mm_set1_epi32(8);
+	const __m128i sixteen = _mm_set1_epi32(16);
+	const __m128i lowMask = _mm_set1_epi32(0xFFFF);
+	const __m128i adapt = _mm_setr_epi32(
+		AdaptionTable[n0],
+		AdaptionTable[n1],
+		AdaptionTable[n2],
+		AdaptionTable[n3]
+	);
+
+	signedNibble = _mm_setr_epi32(n0, n1, n2, n3);
+	signedNibble = _mm_sub_epi32(_mm_xor_si128(signedNibble, eight), eight);
+
+	/* sample = clamp(predictor / 256 + nibble * delta) */
+	predicted = _mm_add_epi32(
+		FAudio_INTERNAL_Div256_SSE2(_mm_madd_epi16(*history, coeff)),
+		_mm_madd_epi16(signedNibble, *delta)
+	);
+	clamped = _mm_packs_epi32(predicted, predicted);
+	predicted = _mm_srai_epi32(_mm_unpacklo_epi16(clamped, clamped), 16);
+	*history = _mm_or_si128(
+		_mm_slli_epi32(*history, 16),
+		_mm_and_si128(predicted, lowMask)
+	);
+
+	/* delta = max((int16_t) (adapt * delta / 256), 16) */
+	*delta = FAudio_INTERNAL_Div256_SSE2(_mm_madd_epi16(adapt, *delta));
+	*delta = _mm_srai_epi32(_mm_slli_epi32(*delta, 16), 16);
+	clamped = _mm_cmplt_epi32(*delta, sixteen);
+	*delta = _mm_or_si128(
+		_mm_andnot_si128(clamped, *delta),
+		_mm_and_si128(clamped, sixteen)
+	);
+
+	_mm_storeu_si128((__m128i*) sample, predicted);
+	FAudio_INTERNAL_StoreMSADPCMLanes(lanes, sample, channels);
+}
+
+void FAudio_INTERNAL_DecodeMSADPCMBlocks_SSE2(
+	uint8_t *buf,
+	int16_t *restrict blockCache,
+	uint32_t blocks,
+	uint32_t align,
+	uint16_t channels
+) {
+	uint32_t k;
+	uint8_t b0, b1, b2, b3;
+	FAudioMSADPCMLanes lanes;
+	__m128i history, coeff, delta;
+	const __m128i lowMask = _mm_set1_epi32(0xFFFF);
+
+	if (!FAudio_INTERNAL_InitMSADPCMLanes(
+		&lanes,
+		buf,
+		blockCache,
+		blocks,
+		align,
+		channels
+	)) {
+		FAudio_INTERNAL_DecodeMSADPCMBlocks_Scalar(
+			buf,
+			blockCache,
+			blocks,
+			align,
+			channels
+		);
+		return;
+	}
+
+	history = _mm_or_si128(
+		_mm_and_si128(_mm_loadu_si128((__m128i*) lanes.sample1), lowMask),
+		_mm_slli_epi32(_mm_loadu_si128((__m128i*) lanes.sample2), 16)
+	);
+	coeff = _mm_setr_epi16(
+		(int16_t) AdaptCoeff_1[lanes.predictor[0]], (int16_t) AdaptCoeff_2[lanes.predictor[0]],
+		(int16_t) AdaptCoeff_1[lanes.predictor[1]], (int16_t) AdaptCoeff_2[lanes.predictor[1]],
+		(int16_t) AdaptCoeff_1[lanes.predictor[2]], (int16_t) AdaptCoeff_2[lanes.predictor[2]],
+		(int16_t) AdaptCoeff_1[lanes.predictor[3]], (int16_t) AdaptCoeff_2[lanes.predictor[3]]
+	);
+	delta = _mm_and_si128(_mm_loadu_si128((__m128i*) lanes.delta), lowMask);
+
+	if (channels == 2)
+	{
+		/* Left lanes take the high nibble, right lanes the low */
+		for (k = 0; k < lanes.bytes; k += 1)
+		{
+			b0 = lanes.data[0][k];
+			b2 = lanes.data[2][k];
+			FAudio_INTERNAL_ParseNibbles_SSE2(
+				&lanes,
+				b0 >> 4, b0 & 0x0F, b2 >> 4, b2 & 0x0F,
+				2,
+				coeff, &history, &delta
+			);
+		}
+	}
+	else
+	{
+		for (k = 0; k < lanes.bytes; k += 1)
+		{
+			b0 = lanes.data[0][k];
+			b1 = lanes.data[1][k];
+			b2 = lanes.data[2][k];
+			b3 = lanes.data[3][k];
+			FAudio_INTERNAL_ParseNibbles_SSE2(
+				&lanes,
+				b0 >> 4, b1 >> 4, b2 >> 4, b3 >> 4,
+				1,
+				coeff, &history, &delta
+			);
+			FAudio_INTERNAL_ParseNibbles_SSE2(
+				&lanes,
+				b0 & 0x0F, b1 & 0x0F, b2 & 0x0F, b3 & 0x0F,
+				1,
+				coeff, &history, &delta
+			);
+		}
+	}
+}
+#endif /* HAVE_SSE2_INTRINSICS */
+
+#if HAVE_NEON_INTRINSICS
+/* Signed x / 256, rounded toward zero like C division */
+static inline int32x4_t FAudio_INTERNAL_Div256_NEON(int32x4_t x)
+{
+	return vshrq_n_s32(
+		vaddq_s32(
+			x,
+			vreinterpretq_s32_u32(vshrq_n_u32(
+				vreinterpretq_u32_s32(vshrq_n_s32(x, 31)),
+				24
+			))
+		),
+		8
 	);
+}
+
+static inline void FAudio_INTERNAL_ParseNibbles_NEON(
+	FAudioMSADPCMLanes *lanes,
+	uint8_t n0,
+	uint8_t n1,
+	uint8_t n2,
+	uint8_t n3,
+	uint32_t channels,
+	int32x4_t coeff1,
+	int32x4_t coeff2,
+	int32x4_t *sample1,
+	int32x4_t *sample2,
+	int32x4_t *delta
+) {
+	int32_t sample[MSADPCM_LANES];
+	int32_t adapt[MSADPCM_LANES] =
+	{
+		AdaptionTable[n0],
+		AdaptionTable[n1],
+		AdaptionTable[n2],
+		AdaptionTable[n3]
+	};
+	int32_t nibble[MSADPCM_LANES] = { n0, n1, n2, n3 };
+	int32x4_t signedNibble, predicted;
+	const int32x4_t eight = vdupq_n_s32(8);
+	const int32x4_t sixteen = vdupq_n_s32(16);
+
+	signedNibble = vld1q_s32(nibble);
+	signedNibble = vsubq_s32(veorq_s32(signedNibble, eight), eight);
+
+	/* sample = clamp(predictor / 256 + nibble * delta) */
+	predicted = FAudio_INTERNAL_Div256_NEON(vmlaq_s32(
+		vmulq_s32(*sample1, coeff1),
+		*sample2,
+		coeff2
+	));
+	predicted = vmlaq_s32(predicted, signedNibble, *delta);
+	predicted = vmovl_s16(vqmovn_s32(predicted));
+	*sample2 = *sample1;
+	*sample1 = predicted;
+
+	/* delta = max((int16_t) (adapt * delta / 256), 16) */
+	*delta = FAudio_INTERNAL_Div256_NEON(vmulq_s32(vld1q_s32(adapt), *delta));
+	*delta = vmaxq_s32(vmovl_s16(vmovn_s32(*delta)), sixteen);
+
+	vst1q_s32(sample, predicted);
+	FAudio_INTERNAL_StoreMSADPCMLanes(lanes, sample, channels);
+}
+
+void FAudio_INTERNAL_DecodeMSADPCMBlocks_NEON(
+	uint8_t *buf,
+	int16_t *restrict blockCache,
+	uint32_t blocks,
+	uint32_t align,
+	uint16_t channels
+) {
+	uint32_t i, k;
+	uint8_t b0, b1, b2, b3;
+	int32_t coeff[MSADPCM_LANES];
+	FAudioMSADPCMLanes lanes;
+	int32x4_t sample1, sample2, coeff1, coeff2, delta;
+
+	if (!FAudio_INTERNAL_InitMSADPCMLanes(
+		&lanes,
+		buf,
+		blockCache,
+		blocks,
+		align,
+		channels
+	)) {
+		FAudio_INTERNAL_DecodeMSADPCMBlocks_Scalar(
+			buf,
+			blockCache,
+			blocks,
+			align,
+			channels
+		);
+		return;
+	}
+
+	for (i = 0; i < MSADPCM_LANES; i += 1)
+	{
+		coeff[i] = AdaptCoeff_1[lanes.predictor[i]];
+	}
+	coeff1 = vld1q_s32(coeff);
+	for (i = 0; i < MSADPCM_LANES; i += 1)
+	{
+		coeff[i] = AdaptCoeff_2[lanes.predictor[i]];
+	}
+	coeff2 = vld1q_s32(coeff);
+	sample1 = vld1q_s32(lanes.sample1);
+	sample2 = vld1q_s32(lanes.sample2);
+	delta = vld1q_s32(lanes.delta);
+
+	if (channels == 2)
+	{
+		/* Left lanes take the high nibble, right lanes the low */
+		for (k = 0; k < lanes.bytes; k += 1)
+		{
+			b0 = lanes.data[0][k];
+			b2 = lanes.data[2][k];
+			FAudio_INTERNAL_ParseNibbles_NEON(
+				&lanes,
+				b0 >> 4, b0 & 0x0F, b2 >> 4, b2 & 0x0F,
+				2,
+				coeff1, coeff2, &sample1, &sample2, &delta
+			);
+		}
+	}
+	else
+	{
+		for (k = 0; k < lanes.bytes; k += 1)
+		{
+			b0 = lanes.data[0][k];
+			b1 = lanes.data[1][k];
+			b2 = lanes.data[2][k];
+			b3 = lanes.data[3][k];
+			FAudio_INTERNAL_ParseNibbles_NEON(
+				&lanes,
+				b0 >> 4, b1 >> 4, b2 >> 4, b3 >> 4,
+				1,
+				coeff1, coeff2, &sample1, &sample2, &delta
+			);
+			FAudio_INTERNAL_ParseNibbles_NEON(
+				&lanes,
+				b0 & 0x0F, b1 & 0x0F, b2 & 0x0F, b3 & 0x0F,
+				1,
+				coeff1, coeff2, &sample1, &sample2, &delta
+			);
+		}
+	}
+}
+#endif /* HAVE_NEON_INTRINSICS */
+
+/* Linear Resamplers */
+
+/* All of these must produce the exact same output as the generic scalar
+ * lerp: the sample delta is taken in single precision, then the fraction
+ * multiply and the add are done in double precision. The SIMD versions run
+ * one channel per lane (one frame per lane for mono) and compute the
+ * fraction once per frame rather than once per channel.
+ */
+
+#define RESAMPLE_ADVANCE(channels) \
+	cur += resampleStep; \
+	dCache += (cur >> FIXED_PRECISION) * channels; \
+	cur &= FIXED_FRACTION_MASK;
+
+void FAudio_INTERNAL_ResampleGeneric_Scalar(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i, j;
+	double frac;
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		frac = FIXED_TO_DOUBLE(cur);
+		for (j = 0; j < channels; j += 1)
+		{
+			/* lerp, then convert to float value */
+			*resampleCache++ = (float) (
+				dCache[j] +
+				(dCache[j + channels] - dCache[j]) * frac
+			);
+		}
+
+		/* Increment fraction offset by the stepping value.
+		 * Only increment the sample offset by integer values.
+		 * Sometimes this will be 0 until cur accumulates
+		 * enough steps, especially for "slow" rates.
+		 * Now that any integer has been added, drop it.
+		 */
+		RESAMPLE_ADVANCE(channels)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+void FAudio_INTERNAL_ResampleMono_Scalar(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i;
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		*resampleCache++ = (float) (
+			dCache[0] +
+			(dCache[1] - dCache[0]) * FIXED_TO_DOUBLE(cur)
+		);
+		RESAMPLE_ADVANCE(1)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+#if HAVE_SSE2_INTRINSICS
+/* Lerps the low two lanes of cur/next */
+static inline __m128 FAudio_INTERNAL_Lerp2_SSE2(
+	__m128 cur,
+	__m128 next,
+	__m128d frac
+) {
+	const __m128d delta = _mm_cvtps_pd(_mm_sub_ps(next, cur));
+	return _mm_cvtpd_ps(_mm_add_pd(
+		_mm_cvtps_pd(cur),
+		_mm_mul_pd(delta, frac)
+	));
+}
+
+void FAudio_INTERNAL_ResampleMono_SSE2(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i;
+	float *first;
+	double frac0;
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+
+	/* Two frames at a time, one per lane */
+	for (i = 0; (i + 1) < toResample; i += 2)
+	{
+		first = dCache;
+		frac0 = FIXED_TO_DOUBLE(cur);
+		RESAMPLE_ADVANCE(1)
+		_mm_storel_pi((__m64*) resampleCache, FAudio_INTERNAL_Lerp2_SSE2(
+			_mm_setr_ps(first[0], dCache[0], 0.0f, 0.0f),
+			_mm_setr_ps(first[1], dCache[1], 0.0f, 0.0f),
+			_mm_setr_pd(frac0, FIXED_TO_DOUBLE(cur))
+		));
+		resampleCache += 2;
+		RESAMPLE_ADVANCE(1)
+	}
+	if (i < toResample)
+	{
+		*resampleCache = (float) (
+			dCache[0] +
+			(dCache[1] - dCache[0]) * FIXED_TO_DOUBLE(cur)
+		);
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+void FAudio_INTERNAL_ResampleStereo_SSE2(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i;
+	const __m128 zero = _mm_setzero_ps();
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		_mm_storel_pi((__m64*) resampleCache, FAudio_INTERNAL_Lerp2_SSE2(
+			_mm_loadl_pi(zero, (const __m64*) dCache),
+			_mm_loadl_pi(zero, (const __m64*) (dCache + 2)),
+			_mm_set1_pd(FIXED_TO_DOUBLE(cur))
+		));
+		resampleCache += 2;
+		RESAMPLE_ADVANCE(2)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+void FAudio_INTERNAL_Resample6Channel_SSE2(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i;
+	__m128d frac;
+	__m128 cur0, next0, cur1, next1;
+	const __m128 zero = _mm_setzero_ps();
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		frac = _mm_set1_pd(FIXED_TO_DOUBLE(cur));
+		cur0 = _mm_loadu_ps(dCache);
+		cur1 = _mm_loadl_pi(zero, (const __m64*) (dCache + 4));
+		next0 = _mm_loadu_ps(dCache + 6);
+		next1 = _mm_loadl_pi(zero, (const __m64*) (dCache + 10));
+		_mm_storeu_ps(resampleCache, _mm_movelh_ps(
+			FAudio_INTERNAL_Lerp2_SSE2(cur0, next0, frac),
+			FAudio_INTERNAL_Lerp2_SSE2(
+				_mm_movehl_ps(cur0, cur0),
+				_mm_movehl_ps(next0, next0),
+				frac
+			)
+		));
+		_mm_storel_pi(
+			(__m64*) (resampleCache + 4),
+			FAudio_INTERNAL_Lerp2_SSE2(cur1, next1, frac)
+		);
+		resampleCache += 6;
+		RESAMPLE_ADVANCE(6)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+void FAudio_INTERNAL_Resample8Channel_SSE2(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i;
+	__m128d frac;
+	__m128 cur0, next0, cur1, next1;
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		frac = _mm_set1_pd(FIXED_TO_DOUBLE(cur));
+		cur0 = _mm_loadu_ps(dCache);
+		cur1 = _mm_loadu_ps(dCache + 4);
+		next0 = _mm_loadu_ps(dCache + 8);
+		next1 = _mm_loadu_ps(dCache + 12);
+		_mm_storeu_ps(resampleCache, _mm_movelh_ps(
+			FAudio_INTERNAL_Lerp2_SSE2(cur0, next0, frac),
+			FAudio_INTERNAL_Lerp2_SSE2(
+				_mm_movehl_ps(cur0, cur0),
+				_mm_movehl_ps(next0, next0),
+				frac
+			)
+		));
+		_mm_storeu_ps(resampleCache + 4, _mm_movelh_ps(
+			FAudio_INTERNAL_Lerp2_SSE2(cur1, next1, frac),
+			FAudio_INTERNAL_Lerp2_SSE2(
+				_mm_movehl_ps(cur1, cur1),
+				_mm_movehl_ps(next1, next1),
+				frac
+			)
+		));
+		resampleCache += 8;
+		RESAMPLE_ADVANCE(8)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+#endif /* HAVE_SSE2_INTRINSICS */
+
+#if HAVE_AVX_INTRINSICS
+/* Lerps all four lanes of cur/next */
+static inline FAUDIO_TARGET_AVX __m128 FAudio_INTERNAL_Lerp4_AVX(
+	__m128 cur,
+	__m128 next,
+	__m256d frac
+) {
+	const __m256d delta = _mm256_cvtps_pd(_mm_sub_ps(next, cur));
+	return _mm256_cvtpd_ps(_mm256_add_pd(
+		_mm256_cvtps_pd(cur),
+		_mm256_mul_pd(delta, frac)
+	));
+}
+
+FAUDIO_TARGET_AVX void FAudio_INTERNAL_ResampleMono_AVX(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i, j;
+	float *frames[4];
+	double fracs[4];
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+
+	/* Four frames at a time, one per lane */
+	for (i = 0; (i + 3) < toResample; i += 4)
+	{
+		for (j = 0; j < 4; j += 1)
+		{
+			frames[j] = dCache;
+			fracs[j] = FIXED_TO_DOUBLE(cur);
+			RESAMPLE_ADVANCE(1)
+		}
+		_mm_storeu_ps(resampleCache, FAudio_INTERNAL_Lerp4_AVX(
+			_mm_setr_ps(
+				frames[0][0],
+				frames[1][0],
+				frames[2][0],
+				frames[3][0]
+			),
+			_mm_setr_ps(
+				frames[0][1],
+				frames[1][1],
+				frames[2][1],
+				frames[3][1]
+			),
+			_mm256_loadu_pd(fracs)
+		));
+		resampleCache += 4;
+	}
+	for (; i < toResample; i += 1)
+	{
+		*resampleCache++ = (float) (
+			dCache[0] +
+			(dCache[1] - dCache[0]) * FIXED_TO_DOUBLE(cur)
+		);
+		RESAMPLE_ADVANCE(1)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+FAUDIO_TARGET_AVX void FAudio_INTERNAL_Resample6Channel_AVX(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i;
+	double frac;
+	const __m128 zero = _mm_setzero_ps();
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		frac = FIXED_TO_DOUBLE(cur);
+		_mm_storeu_ps(resampleCache, FAudio_INTERNAL_Lerp4_AVX(
+			_mm_loadu_ps(dCache),
+			_mm_loadu_ps(dCache + 6),
+			_mm256_set1_pd(frac)
+		));
+		_mm_storel_pi((__m64*) (resampleCache + 4), FAudio_INTERNAL_Lerp2_SSE2(
+			_mm_loadl_pi(zero, (const __m64*) (dCache + 4)),
+			_mm_loadl_pi(zero, (const __m64*) (dCache + 10)),
+			_mm_set1_pd(frac)
+		));
+		resampleCache += 6;
+		RESAMPLE_ADVANCE(6)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+FAUDIO_TARGET_AVX void FAudio_INTERNAL_Resample8Channel_AVX(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i;
+	__m256d frac;
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		frac = _mm256_set1_pd(FIXED_TO_DOUBLE(cur));
+		_mm_storeu_ps(resampleCache, FAudio_INTERNAL_Lerp4_AVX(
+			_mm_loadu_ps(dCache),
+			_mm_loadu_ps(dCache + 8),
+			frac
+		));
+		_mm_storeu_ps(resampleCache + 4, FAudio_INTERNAL_Lerp4_AVX(
+			_mm_loadu_ps(dCache + 4),
+			_mm_loadu_ps(dCache + 12),
+			frac
+		));
+		resampleCache += 8;
+		RESAMPLE_ADVANCE(8)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+#endif /* HAVE_AVX_INTRINSICS */
+
+#if HAVE_NEON_F64_INTRINSICS
+static inline float32x2_t FAudio_INTERNAL_Lerp2_NEON(
+	float32x2_t cur,
+	float32x2_t next,
+	float64x2_t frac
+) {
+	const float64x2_t delta = vcvt_f64_f32(vsub_f32(next, cur));
+	return vcvt_f32_f64(vaddq_f64(
+		vcvt_f64_f32(cur),
+		vmulq_f64(delta, frac)
+	));
+}
+
+void FAudio_INTERNAL_ResampleMono_NEON(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i;
+	float *first;
+	double frac0;
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+
+	/* Two frames at a time, one per lane */
+	for (i = 0; (i + 1) < toResample; i += 2)
+	{
+		first = dCache;
+		frac0 = FIXED_TO_DOUBLE(cur);
+		RESAMPLE_ADVANCE(1)
+		vst1_f32(resampleCache, FAudio_INTERNAL_Lerp2_NEON(
+			vset_lane_f32(dCache[0], vdup_n_f32(first[0]), 1),
+			vset_lane_f32(dCache[1], vdup_n_f32(first[1]), 1),
+			vsetq_lane_f64(FIXED_TO_DOUBLE(cur), vdupq_n_f64(frac0), 1)
+		));
+		resampleCache += 2;
+		RESAMPLE_ADVANCE(1)
+	}
+	if (i < toResample)
+	{
+		*resampleCache = (float) (
+			dCache[0] +
+			(dCache[1] - dCache[0]) * FIXED_TO_DOUBLE(cur)
+		);
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+void FAudio_INTERNAL_ResampleStereo_NEON(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i;
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		vst1_f32(resampleCache, FAudio_INTERNAL_Lerp2_NEON(
+			vld1_f32(dCache),
+			vld1_f32(dCache + 2),
+			vdupq_n_f64(FIXED_TO_DOUBLE(cur))
+		));
+		resampleCache += 2;
+		RESAMPLE_ADVANCE(2)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+void FAudio_INTERNAL_Resample6Channel_NEON(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i, j;
+	float64x2_t frac;
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		frac = vdupq_n_f64(FIXED_TO_DOUBLE(cur));
+		for (j = 0; j < 6; j += 2)
+		{
+			vst1_f32(resampleCache + j, FAudio_INTERNAL_Lerp2_NEON(
+				vld1_f32(dCache + j),
+				vld1_f32(dCache + j + 6),
+				frac
+			));
+		}
+		resampleCache += 6;
+		RESAMPLE_ADVANCE(6)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+void FAudio_INTERNAL_Resample8Channel_NEON(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i, j;
+	float64x2_t frac;
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		frac = vdupq_n_f64(FIXED_TO_DOUBLE(cur));
+		for (j = 0; j < 8; j += 2)
+		{
+			vst1_f32(resampleCache + j, FAudio_INTERNAL_Lerp2_NEON(
+				vld1_f32(dCache + j),
+				vld1_f32(dCache + j + 8),
+				frac
+			));
+		}
+		resampleCache += 8;
+		RESAMPLE_ADVANCE(8)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+#endif /* HAVE_NEON_F64_INTRINSICS */
+
+/* Polyphase Sinc Resamplers */
+
+/* Used by FAUDIO_VOICE_SINC_SRC voices. MixSource puts SINC_HISTORY frames
+ * from the previous pass in front of the decode cache, so output frame n reads
+ * cache frames n through n + SINC_TAPS - 1, centered on n + SINC_DELAY plus
+ * the fraction. That's the same lookahead as the linear resamplers, just
+ * delayed by SINC_DELAY frames.
+ *
+ * The kernel is a Blackman windowed sinc, tabulated at SINC_PHASES fractional
+ * offsets with a delta to the next phase for interpolating between them.
+ * Downsampling needs a lower cutoff, so there's one table per step range;
+ * they're built once and shared by every voice. As with the linear ones, the
+ * SIMD versions must match the scalar output exactly: the weights are lerped
+ * in single precision and the taps are summed into four partial sums (tap
+ * modulo 4), which are then added as (0 + 2) + (1 + 3).
+ */
 
-	/* Are we starting in the middle? */
-	midOffset = (curOffset % bsize);
+#define SINC_PHASE_BITS		6
+#define SINC_PHASES		(1 << SINC_PHASE_BITS)
+#define SINC_PHASE_SHIFT	(FIXED_PRECISION - SINC_PHASE_BITS)
+#define SINC_PHASE_MASK		((1ULL << SINC_PHASE_SHIFT) - 1)
+#define SINC_CUTOFF_COUNT	4
 
-	/* Read in each block directly to the decode cache */
-	while (samples > 0)
+static const double SINC_MAX_STEP[SINC_CUTOFF_COUNT] =
+{
+	1.0, 1.5, 2.0, 3.0
+};
+
+/* [cutoff][phase][0] is the kernel, [cutoff][phase][1] the delta to the next */
+static float sincTable[SINC_CUTOFF_COUNT][SINC_PHASES][2][SINC_TAPS];
+static uint8_t sincTableReady = 0;
+
+static void FAudio_INTERNAL_InitSincTables()
+{
+	const double pi = 3.14159265358979323846;
+	double kernel[SINC_PHASES + 1][SINC_TAPS];
+	double cutoff, x, sum;
+	uint32_t i, phase, tap;
+
+	if (sincTableReady)
 	{
-		copy = FAudio_min(samples, bsize - midOffset);
-		FAudio_INTERNAL_DecodeStereoMSADPCMBlock(
-			&buf,
-			blockCache,
-			format->nBlockAlign
+		return;
+	}
+
+	for (i = 0; i < SINC_CUTOFF_COUNT; i += 1)
+	{
+		/* A little under Nyquist, scaled down when decimating */
+		cutoff = 0.9 / SINC_MAX_STEP[i];
+		for (phase = 0; phase <= SINC_PHASES; phase += 1)
+		{
+			sum = 0.0;
+			for (tap = 0; tap < SINC_TAPS; tap += 1)
+			{
+				x = (
+					(double) tap -
+					SINC_DELAY -
+					(double) phase / SINC_PHASES
+				);
+				kernel[phase][tap] = (x == 0.0) ?
+					1.0 :
+					FAudio_sin(pi * cutoff * x) / (pi * cutoff * x);
+				kernel[phase][tap] *= (
+					0.42 +
+					0.5 * FAudio_cos(pi * x / (SINC_TAPS / 2)) +
+					0.08 * FAudio_cos(2.0 * pi * x / (SINC_TAPS / 2))
+				);
+				sum += kernel[phase][tap];
+			}
+
+			/* Unity gain at DC, whatever the phase */
+			for (tap = 0; tap < SINC_TAPS; tap += 1)
+			{
+				kernel[phase][tap] /= sum;
+			}
+		}
+		for (phase = 0; phase < SINC_PHASES; phase += 1)
+		{
+			for (tap = 0; tap < SINC_TAPS; tap += 1)
+			{
+				sincTable[i][phase][0][tap] = (float) kernel[phase][tap];
+				sincTable[i][phase][1][tap] = (float) (
+					kernel[phase + 1][tap] -
+					kernel[phase][tap]
+				);
+			}
+		}
+	}
+	sincTableReady = 1;
+}
+
+static inline const float* FAudio_INTERNAL_GetSincTable(uint64_t resampleStep)
+{
+	uint32_t i;
+	for (i = 0; i < (SINC_CUTOFF_COUNT - 1); i += 1)
+	{
+		if (resampleStep <= DOUBLE_TO_FIXED(SINC_MAX_STEP[i]))
+		{
+			break;
+		}
+	}
+	return sincTable[i][0][0];
+}
+
+/* Picks the phase for cur, and the fraction between it and the next */
+#define SINC_SELECT_PHASE \
+	kernel = table + (cur >> SINC_PHASE_SHIFT) * 2 * SINC_TAPS; \
+	frac = (float) (cur & SINC_PHASE_MASK) * (1.0f / (1 << SINC_PHASE_SHIFT));
+
+void FAudio_INTERNAL_ResampleSincGeneric_Scalar(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i, j, tap;
+	const float *table = FAudio_INTERNAL_GetSincTable(resampleStep);
+	const float *kernel;
+	float frac;
+	float weight[SINC_TAPS];
+	float sum[4];
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		SINC_SELECT_PHASE
+		for (tap = 0; tap < SINC_TAPS; tap += 1)
+		{
+			weight[tap] = kernel[tap] + kernel[SINC_TAPS + tap] * frac;
+		}
+		for (j = 0; j < channels; j += 1)
+		{
+			sum[0] = sum[1] = sum[2] = sum[3] = 0.0f;
+			for (tap = 0; tap < SINC_TAPS; tap += 1)
+			{
+				sum[tap & 3] += dCache[tap * channels + j] * weight[tap];
+			}
+			*resampleCache++ = (sum[0] + sum[2]) + (sum[1] + sum[3]);
+		}
+		RESAMPLE_ADVANCE(channels)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+#if HAVE_SSE2_INTRINSICS
+void FAudio_INTERNAL_ResampleSincMono_SSE2(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i, tap;
+	const float *table = FAudio_INTERNAL_GetSincTable(resampleStep);
+	const float *kernel;
+	float frac;
+	__m128 fracv, sum;
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		SINC_SELECT_PHASE
+		fracv = _mm_set1_ps(frac);
+
+		/* One partial sum per lane */
+		sum = _mm_setzero_ps();
+		for (tap = 0; tap < SINC_TAPS; tap += 4)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(
+				_mm_loadu_ps(dCache + tap),
+				_mm_add_ps(
+					_mm_loadu_ps(kernel + tap),
+					_mm_mul_ps(
+						_mm_loadu_ps(kernel + SINC_TAPS + tap),
+						fracv
+					)
+				)
+			));
+		}
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		_mm_store_ss(resampleCache++, sum);
+		RESAMPLE_ADVANCE(1)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+
+void FAudio_INTERNAL_ResampleSincGeneric_SSE2(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+) {
+	uint32_t i, j, tap;
+	const float *table = FAudio_INTERNAL_GetSincTable(resampleStep);
+	const float *kernel;
+	float frac;
+	__m128 fracv, weight, sum[4];
+	__m128 weights[SINC_TAPS];
+	float *src;
+	uint64_t cur = *resampleOffset & FIXED_FRACTION_MASK;
+	for (i = 0; i < toResample; i += 1)
+	{
+		SINC_SELECT_PHASE
+		fracv = _mm_set1_ps(frac);
+		for (tap = 0; tap < SINC_TAPS; tap += 4)
+		{
+			weight = _mm_add_ps(
+				_mm_loadu_ps(kernel + tap),
+				_mm_mul_ps(
+					_mm_loadu_ps(kernel + SINC_TAPS + tap),
+					fracv
+				)
+			);
+			weights[tap + 0] = _mm_shuffle_ps(weight, weight, _MM_SHUFFLE(0, 0, 0, 0));
+			weights[tap + 1] = _mm_shuffle_ps(weight, weight, _MM_SHUFFLE(1, 1, 1, 1));
+			weights[tap + 2] = _mm_shuffle_ps(weight, weight, _MM_SHUFFLE(2, 2, 2, 2));
+			weights[tap + 3] = _mm_shuffle_ps(weight, weight, _MM_SHUFFLE(3, 3, 3, 3));
+		}
+
+		/* One channel per lane, four at a time, then two, then one */
+		for (j = 0; (j + 4) <= channels; j += 4)
+		{
+			src = dCache + j;
+			sum[0] = sum[1] = sum[2] = sum[3] = _mm_setzero_ps();
+			for (tap = 0; tap < SINC_TAPS; tap += 1)
+			{
+				sum[tap & 3] = _mm_add_ps(sum[tap & 3], _mm_mul_ps(
+					_mm_loadu_ps(src),
+					weights[tap]
+				));
+				src += channels;
+			}
+			_mm_storeu_ps(resampleCache, _mm_add_ps(
+				_mm_add_ps(sum[0], sum[2]),
+				_mm_add_ps(sum[1], sum[3])
+			));
+			resampleCache += 4;
+		}
+		if ((j + 2) <= channels)
+		{
+			src = dCache + j;
+			sum[0] = sum[1] = sum[2] = sum[3] = _mm_setzero_ps();
+			for (tap = 0; tap < SINC_TAPS; tap += 1)
+			{
+				sum[tap & 3] = _mm_add_ps(sum[tap & 3], _mm_mul_ps(
+					_mm_loadl_pi(_mm_setzero_ps(), (const __m64*) src),
+					weights[tap]
+				));
+				src += channels;
+			}
+			_mm_storel_pi((__m64*) resampleCache, _mm_add_ps(
+				_mm_add_ps(sum[0], sum[2]),
+				_mm_add_ps(sum[1], sum[3])
+			));
+			resampleCache += 2;
+			j += 2;
+		}
+		if (j < channels)
+		{
+			src = dCache + j;
+			sum[0] = sum[1] = sum[2] = sum[3] = _mm_setzero_ps();
+			for (tap = 0; tap < SINC_TAPS; tap += 1)
+			{
+				sum[tap & 3] = _mm_add_ss(sum[tap & 3], _mm_mul_ss(
+					_mm_load_ss(src),
+					weights[tap]
+				));
+				src += channels;
+			}
+			_mm_store_ss(resampleCache, _mm_add_ss(
+				_mm_add_ss(sum[0], sum[2]),
+				_mm_add_ss(sum[1], sum[3])
+			));
+			resampleCache += 1;
+		}
+		RESAMPLE_ADVANCE(channels)
+	}
+	*resampleOffset += toResample * resampleStep;
+}
+#endif /* HAVE_SSE2_INTRINSICS */
+
+#undef SINC_SELECT_PHASE
+
+#undef RESAMPLE_ADVANCE
+
+/* Send Matrix Mixers */
+
+/* These take the effective gain matrix for a send (channel volumes, voice
+ * volume and output matrix already multiplied together) in the usual
+ * [dstChan * srcChans + srcChan] layout. Each output sample is accumulated
+ * in source channel order and clamped once, after every input channel has
+ * been added.
+ */
+
+void FAudio_INTERNAL_MixGeneric_Scalar(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
+) {
+	uint32_t i, co, ci;
+	float sample;
+	for (i = 0; i < toMix; i += 1, srcData += srcChans, dstData += dstChans)
+	for (co = 0; co < dstChans; co += 1)
+	{
+		sample = dstData[co];
+		for (ci = 0; ci < srcChans; ci += 1)
+		{
+			sample += srcData[ci] * coefficients[co * srcChans + ci];
+		}
+		dstData[co] = FAudio_clamp(
+			sample,
+			-FAUDIO_MAX_VOLUME_LEVEL,
+			FAUDIO_MAX_VOLUME_LEVEL
 		);
-		FAudio_INTERNAL_Convert_S16_To_F32(
-			blockCache + (midOffset * 2),
-			decodeCache,
-			copy * 2
+	}
+}
+
+#if HAVE_SSE2_INTRINSICS
+#define MIX_CLAMP(v) _mm_min_ps(_mm_max_ps(v, minVol), maxVol)
+
+void FAudio_INTERNAL_MixMonoToStereo_SSE2(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
+) {
+	uint32_t i;
+	__m128 in;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 minVol = _mm_set1_ps(-FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 maxVol = _mm_set1_ps(FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 gain = _mm_setr_ps(
+		coefficients[0], coefficients[1],
+		coefficients[0], coefficients[1]
+	);
+
+	/* Two frames at a time: L0 R0 L1 R1 */
+	for (i = 0; (i + 1) < toMix; i += 2, srcData += 2, dstData += 4)
+	{
+		in = _mm_loadl_pi(zero, (const __m64*) srcData);
+		in = _mm_unpacklo_ps(in, in);
+		_mm_storeu_ps(dstData, MIX_CLAMP(_mm_add_ps(
+			_mm_loadu_ps(dstData),
+			_mm_mul_ps(in, gain)
+		)));
+	}
+	if (i < toMix)
+	{
+		FAudio_INTERNAL_MixGeneric_Scalar(
+			1, 1, 2,
+			srcData,
+			dstData,
+			coefficients
 		);
-		decodeCache += copy * 2;
-		samples -= copy;
-		midOffset = 0;
 	}
 }
 
-/* Type Converters */
+void FAudio_INTERNAL_MixMonoTo6Channel_SSE2(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
+) {
+	uint32_t i;
+	__m128 in;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 minVol = _mm_set1_ps(-FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 maxVol = _mm_set1_ps(FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 gain0 = _mm_loadu_ps(coefficients);
+	const __m128 gain1 = _mm_loadl_pi(zero, (const __m64*) (coefficients + 4));
+
+	for (i = 0; i < toMix; i += 1, srcData += 1, dstData += 6)
+	{
+		in = _mm_set1_ps(srcData[0]);
+		_mm_storeu_ps(dstData, MIX_CLAMP(_mm_add_ps(
+			_mm_loadu_ps(dstData),
+			_mm_mul_ps(in, gain0)
+		)));
+		_mm_storel_pi((__m64*) (dstData + 4), MIX_CLAMP(_mm_add_ps(
+			_mm_loadl_pi(zero, (const __m64*) (dstData + 4)),
+			_mm_mul_ps(in, gain1)
+		)));
+	}
+}
 
-/* The SSE/NEON converters are based on SDL_audiotypecvt:
- * https://hg.libsdl.org/SDL/file/default/src/audio/SDL_audiotypecvt.c
- * The SSE/NEON detection comes from MojoAL:
- * https://hg.icculus.org/icculus/mojoAL/file/default/mojoal.c
- */
+void FAudio_INTERNAL_MixMonoTo8Channel_SSE2(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
+) {
+	uint32_t i;
+	__m128 in;
+	const __m128 minVol = _mm_set1_ps(-FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 maxVol = _mm_set1_ps(FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 gain0 = _mm_loadu_ps(coefficients);
+	const __m128 gain1 = _mm_loadu_ps(coefficients + 4);
 
-#if defined(__x86_64__)
-#define NEED_SCALAR_CONVERTER_FALLBACKS 0  /* x86_64 guarantees SSE2. */
-#elif __MACOSX__
-#define NEED_SCALAR_CONVERTER_FALLBACKS 0  /* Mac OS X/Intel guarantees SSE2. */
-#elif defined(__ARM_ARCH) && (__ARM_ARCH >= 8)
-#define NEED_SCALAR_CONVERTER_FALLBACKS 0  /* ARMv8+ promise NEON. */
-#elif defined(__APPLE__) && defined(__ARM_ARCH) && (__ARM_ARCH >= 7)
-#define NEED_SCALAR_CONVERTER_FALLBACKS 0  /* All Apple ARMv7 chips promise NEON support. */
-#else
-#define NEED_SCALAR_CONVERTER_FALLBACKS 1
-#endif
+	for (i = 0; i < toMix; i += 1, srcData += 1, dstData += 8)
+	{
+		in = _mm_set1_ps(srcData[0]);
+		_mm_storeu_ps(dstData, MIX_CLAMP(_mm_add_ps(
+			_mm_loadu_ps(dstData),
+			_mm_mul_ps(in, gain0)
+		)));
+		_mm_storeu_ps(dstData + 4, MIX_CLAMP(_mm_add_ps(
+			_mm_loadu_ps(dstData + 4),
+			_mm_mul_ps(in, gain1)
+		)));
+	}
+}
 
-/* Some platforms fail to define __ARM_NEON__, others need it or arm_neon.h will fail. */
-#if (defined(__ARM_ARCH) || defined(_M_ARM))
-#  if !NEED_SCALAR_CONVERTER_FALLBACKS && !defined(__ARM_NEON__)
-#    define __ARM_NEON__ 1
-#  endif
-#endif
+void FAudio_INTERNAL_MixStereoToStereo_SSE2(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
+) {
+	uint32_t i;
+	__m128 in, left, right;
+	const __m128 minVol = _mm_set1_ps(-FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 maxVol = _mm_set1_ps(FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 gainL = _mm_setr_ps(
+		coefficients[0], coefficients[2],
+		coefficients[0], coefficients[2]
+	);
+	const __m128 gainR = _mm_setr_ps(
+		coefficients[1], coefficients[3],
+		coefficients[1], coefficients[3]
+	);
 
-#ifdef __ARM_NEON__
-#include <arm_neon.h>
-#define HAVE_NEON_INTRINSICS 1
-#endif
+	/* Two frames at a time: L0 R0 L1 R1 */
+	for (i = 0; (i + 1) < toMix; i += 2, srcData += 4, dstData += 4)
+	{
+		in = _mm_loadu_ps(srcData);
+		left = _mm_shuffle_ps(in, in, _MM_SHUFFLE(2, 2, 0, 0));
+		right = _mm_shuffle_ps(in, in, _MM_SHUFFLE(3, 3, 1, 1));
+		_mm_storeu_ps(dstData, MIX_CLAMP(_mm_add_ps(
+			_mm_add_ps(
+				_mm_loadu_ps(dstData),
+				_mm_mul_ps(left, gainL)
+			),
+			_mm_mul_ps(right, gainR)
+		)));
+	}
+	if (i < toMix)
+	{
+		FAudio_INTERNAL_MixGeneric_Scalar(
+			1, 2, 2,
+			srcData,
+			dstData,
+			coefficients
+		);
+	}
+}
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-#define HAVE_SSE2_INTRINSICS 1
-#endif
+void FAudio_INTERNAL_MixStereoTo6Channel_SSE2(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
+) {
+	uint32_t i;
+	__m128 left, right;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 minVol = _mm_set1_ps(-FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 maxVol = _mm_set1_ps(FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 gainL0 = _mm_setr_ps(
+		coefficients[0], coefficients[2],
+		coefficients[4], coefficients[6]
+	);
+	const __m128 gainR0 = _mm_setr_ps(
+		coefficients[1], coefficients[3],
+		coefficients[5], coefficients[7]
+	);
+	const __m128 gainL1 = _mm_setr_ps(
+		coefficients[8], coefficients[10],
+		0.0f, 0.0f
+	);
+	const __m128 gainR1 = _mm_setr_ps(
+		coefficients[9], coefficients[11],
+		0.0f, 0.0f
+	);
 
-#define DIVBY128 0.0078125f
-#define DIVBY32768 0.000030517578125f
+	for (i = 0; i < toMix; i += 1, srcData += 2, dstData += 6)
+	{
+		left = _mm_set1_ps(srcData[0]);
+		right = _mm_set1_ps(srcData[1]);
+		_mm_storeu_ps(dstData, MIX_CLAMP(_mm_add_ps(
+			_mm_add_ps(
+				_mm_loadu_ps(dstData),
+				_mm_mul_ps(left, gainL0)
+			),
+			_mm_mul_ps(right, gainR0)
+		)));
+		_mm_storel_pi((__m64*) (dstData + 4), MIX_CLAMP(_mm_add_ps(
+			_mm_add_ps(
+				_mm_loadl_pi(zero, (const __m64*) (dstData + 4)),
+				_mm_mul_ps(left, gainL1)
+			),
+			_mm_mul_ps(right, gainR1)
+		)));
+	}
+}
 
-#if NEED_SCALAR_CONVERTER_FALLBACKS
-void FAudio_INTERNAL_Convert_U8_To_F32_Scalar(
-	const uint8_t *restrict src,
-	float *restrict dst,
-	uint32_t len
+void FAudio_INTERNAL_MixStereoTo8Channel_SSE2(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
 ) {
 	uint32_t i;
-	for (i = 0; i < len; i += 1)
+	__m128 left, right;
+	const __m128 minVol = _mm_set1_ps(-FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 maxVol = _mm_set1_ps(FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 gainL0 = _mm_setr_ps(
+		coefficients[0], coefficients[2],
+		coefficients[4], coefficients[6]
+	);
+	const __m128 gainR0 = _mm_setr_ps(
+		coefficients[1], coefficients[3],
+		coefficients[5], coefficients[7]
+	);
+	const __m128 gainL1 = _mm_setr_ps(
+		coefficients[8], coefficients[10],
+		coefficients[12], coefficients[14]
+	);
+	const __m128 gainR1 = _mm_setr_ps(
+		coefficients[9], coefficients[11],
+		coefficients[13], coefficients[15]
+	);
+
+	for (i = 0; i < toMix; i += 1, srcData += 2, dstData += 8)
 	{
-		*dst++ = (*src++ * DIVBY128) - 1.0f;
+		left = _mm_set1_ps(srcData[0]);
+		right = _mm_set1_ps(srcData[1]);
+		_mm_storeu_ps(dstData, MIX_CLAMP(_mm_add_ps(
+			_mm_add_ps(
+				_mm_loadu_ps(dstData),
+				_mm_mul_ps(left, gainL0)
+			),
+			_mm_mul_ps(right, gainR0)
+		)));
+		_mm_storeu_ps(dstData + 4, MIX_CLAMP(_mm_add_ps(
+			_mm_add_ps(
+				_mm_loadu_ps(dstData + 4),
+				_mm_mul_ps(left, gainL1)
+			),
+			_mm_mul_ps(right, gainR1)
+		)));
 	}
 }
 
-void FAudio_INTERNAL_Convert_S16_To_F32_Scalar(
-	const int16_t *restrict src,
-	float *restrict dst,
-	uint32_t len
+#undef MIX_CLAMP
+#endif /* HAVE_SSE2_INTRINSICS */
+
+#if HAVE_NEON_INTRINSICS
+#define MIX_CLAMP(v) vminq_f32(vmaxq_f32(v, minVol), maxVol)
+#define MIX_CLAMP2(v) vmin_f32(vmax_f32(v, vget_low_f32(minVol)), vget_low_f32(maxVol))
+
+void FAudio_INTERNAL_MixMonoToStereo_NEON(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
 ) {
 	uint32_t i;
-	for (i = 0; i < len; i += 1)
+	float32x2_t pair;
+	const float32x4_t minVol = vdupq_n_f32(-FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4_t maxVol = vdupq_n_f32(FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4_t gain = vcombine_f32(
+		vld1_f32(coefficients),
+		vld1_f32(coefficients)
+	);
+
+	/* Two frames at a time: L0 R0 L1 R1 */
+	for (i = 0; (i + 1) < toMix; i += 2, srcData += 2, dstData += 4)
 	{
-		*dst++ = *src++ * DIVBY32768;
+		pair = vld1_f32(srcData);
+		vst1q_f32(dstData, MIX_CLAMP(vaddq_f32(
+			vld1q_f32(dstData),
+			vmulq_f32(vcombine_f32(
+				vdup_lane_f32(pair, 0),
+				vdup_lane_f32(pair, 1)
+			), gain)
+		)));
+	}
+	if (i < toMix)
+	{
+		FAudio_INTERNAL_MixGeneric_Scalar(
+			1, 1, 2,
+			srcData,
+			dstData,
+			coefficients
+		);
 	}
 }
-#endif /* NEED_SCALAR_CONVERTER_FALLBACKS */
 
-#if HAVE_SSE2_INTRINSICS
-void FAudio_INTERNAL_Convert_U8_To_F32_SSE2(
-	const uint8_t *restrict src,
-	float *restrict dst,
-	uint32_t len
+void FAudio_INTERNAL_MixMonoTo6Channel_NEON(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
 ) {
-    int i;
-    src += len - 1;
-    dst += len - 1;
+	uint32_t i;
+	float32x4_t in;
+	const float32x4_t minVol = vdupq_n_f32(-FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4_t maxVol = vdupq_n_f32(FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4_t gain0 = vld1q_f32(coefficients);
+	const float32x2_t gain1 = vld1_f32(coefficients + 4);
 
-    /* Get dst aligned to 16 bytes (since buffer is growing, we don't have to worry about overreading from src) */
-    for (i = len; i && (((size_t) (dst-15)) & 15); --i, --src, --dst) {
-        *dst = (((float) *src) * DIVBY128) - 1.0f;
-    }
+	for (i = 0; i < toMix; i += 1, srcData += 1, dstData += 6)
+	{
+		in = vdupq_n_f32(srcData[0]);
+		vst1q_f32(dstData, MIX_CLAMP(vaddq_f32(
+			vld1q_f32(dstData),
+			vmulq_f32(in, gain0)
+		)));
+		vst1_f32(dstData + 4, MIX_CLAMP2(vadd_f32(
+			vld1_f32(dstData + 4),
+			vmul_f32(vget_low_f32(in), gain1)
+		)));
+	}
+}
 
-    src -= 15; dst -= 15;  /* adjust to read SSE blocks from the start. */
-    FAudio_assert(!i || ((((size_t) dst) & 15) == 0));
+void FAudio_INTERNAL_MixMonoTo8Channel_NEON(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
+) {
+	uint32_t i;
+	float32x4_t in;
+	const float32x4_t minVol = vdupq_n_f32(-FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4_t maxVol = vdupq_n_f32(FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4_t gain0 = vld1q_f32(coefficients);
+	const float32x4_t gain1 = vld1q_f32(coefficients + 4);
 
-    /* Make sure src is aligned too. */
-    if ((((size_t) src) & 15) == 0) {
-        /* Aligned! Do SSE blocks as long as we have 16 bytes available. */
-        const __m128i *mmsrc = (const __m128i *) src;
-        const __m128i zero = _mm_setzero_si128();
-        const __m128 divby128 = _mm_set1_ps(DIVBY128);
-        const __m128 minus1 = _mm_set1_ps(-1.0f);
-        while (i >= 16) {   /* 16 * 8-bit */
-            const __m128i bytes = _mm_load_si128(mmsrc);  /* get 16 uint8 into an XMM register. */
-            /* treat as int16, shift left to clear every other sint16, then back right with zero-extend. Now uint16. */
-            const __m128i shorts1 = _mm_srli_epi16(_mm_slli_epi16(bytes, 8), 8);
-            /* right-shift-zero-extend gets us uint16 with the other set of values. */
-            const __m128i shorts2 = _mm_srli_epi16(bytes, 8);
-            /* unpack against zero to make these int32, convert to float, multiply, add. Whew! */
-            /* Note that AVX2 can do floating point multiply+add in one instruction, fwiw. SSE2 cannot. */
-            const __m128 floats1 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(shorts1, zero)), divby128), minus1);
-            const __m128 floats2 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(shorts2, zero)), divby128), minus1);
-            const __m128 floats3 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(shorts1, zero)), divby128), minus1);
-            const __m128 floats4 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(shorts2, zero)), divby128), minus1);
-            /* Interleave back into correct order, store. */
-            _mm_store_ps(dst, _mm_unpacklo_ps(floats1, floats2));
-            _mm_store_ps(dst+4, _mm_unpackhi_ps(floats1, floats2));
-            _mm_store_ps(dst+8, _mm_unpacklo_ps(floats3, floats4));
-            _mm_store_ps(dst+12, _mm_unpackhi_ps(floats3, floats4));
-            i -= 16; mmsrc--; dst -= 16;
-        }
+	for (i = 0; i < toMix; i += 1, srcData += 1, dstData += 8)
+	{
+		in = vdupq_n_f32(srcData[0]);
+		vst1q_f32(dstData, MIX_CLAMP(vaddq_f32(
+			vld1q_f32(dstData),
+			vmulq_f32(in, gain0)
+		)));
+		vst1q_f32(dstData + 4, MIX_CLAMP(vaddq_f32(
+			vld1q_f32(dstData + 4),
+			vmulq_f32(in, gain1)
+		)));
+	}
+}
 
-        src = (const uint8_t *) mmsrc;
-    }
+void FAudio_INTERNAL_MixStereoToStereo_NEON(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
+) {
+	uint32_t i;
+	float32x2x2_t in;
+	const float32x4_t minVol = vdupq_n_f32(-FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4_t maxVol = vdupq_n_f32(FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x2x2_t gain = vld2_f32(coefficients);
+	const float32x4_t gainL = vcombine_f32(gain.val[0], gain.val[0]);
+	const float32x4_t gainR = vcombine_f32(gain.val[1], gain.val[1]);
+
+	/* Two frames at a time: L0 R0 L1 R1 */
+	for (i = 0; (i + 1) < toMix; i += 2, srcData += 4, dstData += 4)
+	{
+		in = vld2_f32(srcData);
+		vst1q_f32(dstData, MIX_CLAMP(vaddq_f32(
+			vaddq_f32(
+				vld1q_f32(dstData),
+				vmulq_f32(vcombine_f32(
+					vdup_lane_f32(in.val[0], 0),
+					vdup_lane_f32(in.val[0], 1)
+				), gainL)
+			),
+			vmulq_f32(vcombine_f32(
+				vdup_lane_f32(in.val[1], 0),
+				vdup_lane_f32(in.val[1], 1)
+			), gainR)
+		)));
+	}
+	if (i < toMix)
+	{
+		FAudio_INTERNAL_MixGeneric_Scalar(
+			1, 2, 2,
+			srcData,
+			dstData,
+			coefficients
+		);
+	}
+}
 
-    src += 15; dst += 15;  /* adjust for any scalar finishing. */
+void FAudio_INTERNAL_MixStereoTo6Channel_NEON(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
+) {
+	uint32_t i;
+	float32x4_t left, right;
+	const float32x4_t minVol = vdupq_n_f32(-FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4_t maxVol = vdupq_n_f32(FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4x2_t gain0 = vld2q_f32(coefficients);
+	const float32x2x2_t gain1 = vld2_f32(coefficients + 8);
 
-    /* Finish off any leftovers with scalar operations. */
-    while (i) {
-        *dst = (((float) *src) * DIVBY128) - 1.0f;
-        i--; src--; dst--;
-    }
+	for (i = 0; i < toMix; i += 1, srcData += 2, dstData += 6)
+	{
+		left = vdupq_n_f32(srcData[0]);
+		right = vdupq_n_f32(srcData[1]);
+		vst1q_f32(dstData, MIX_CLAMP(vaddq_f32(
+			vaddq_f32(
+				vld1q_f32(dstData),
+				vmulq_f32(left, gain0.val[0])
+			),
+			vmulq_f32(right, gain0.val[1])
+		)));
+		vst1_f32(dstData + 4, MIX_CLAMP2(vadd_f32(
+			vadd_f32(
+				vld1_f32(dstData + 4),
+				vmul_f32(vget_low_f32(left), gain1.val[0])
+			),
+			vmul_f32(vget_low_f32(right), gain1.val[1])
+		)));
+	}
 }
 
-void FAudio_INTERNAL_Convert_S16_To_F32_SSE2(
-	const int16_t *restrict src,
-	float *restrict dst,
-	uint32_t len
+void FAudio_INTERNAL_MixStereoTo8Channel_NEON(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
 ) {
-    int i;
-    src += len - 1;
-    dst += len - 1;
+	uint32_t i;
+	float32x4_t left, right;
+	const float32x4_t minVol = vdupq_n_f32(-FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4_t maxVol = vdupq_n_f32(FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4x2_t gain0 = vld2q_f32(coefficients);
+	const float32x4x2_t gain1 = vld2q_f32(coefficients + 8);
 
-    /* Get dst aligned to 16 bytes (since buffer is growing, we don't have to worry about overreading from src) */
-    for (i = len; i && (((size_t) (dst-7)) & 15); --i, --src, --dst) {
-        *dst = ((float) *src) * DIVBY32768;
-    }
+	for (i = 0; i < toMix; i += 1, srcData += 2, dstData += 8)
+	{
+		left = vdupq_n_f32(srcData[0]);
+		right = vdupq_n_f32(srcData[1]);
+		vst1q_f32(dstData, MIX_CLAMP(vaddq_f32(
+			vaddq_f32(
+				vld1q_f32(dstData),
+				vmulq_f32(left, gain0.val[0])
+			),
+			vmulq_f32(right, gain0.val[1])
+		)));
+		vst1q_f32(dstData + 4, MIX_CLAMP(vaddq_f32(
+			vaddq_f32(
+				vld1q_f32(dstData + 4),
+				vmulq_f32(left, gain1.val[0])
+			),
+			vmulq_f32(right, gain1.val[1])
+		)));
+	}
+}
 
-    src -= 7; dst -= 7;  /* adjust to read SSE blocks from the start. */
-    FAudio_assert(!i || ((((size_t) dst) & 15) == 0));
+#undef MIX_CLAMP2
+#undef MIX_CLAMP
+#endif /* HAVE_NEON_INTRINSICS */
 
-    /* Make sure src is aligned too. */
-    if ((((size_t) src) & 15) == 0) {
-        /* Aligned! Do SSE blocks as long as we have 16 bytes available. */
-        const __m128 divby32768 = _mm_set1_ps(DIVBY32768);
-        while (i >= 8) {   /* 8 * 16-bit */
-            const __m128i ints = _mm_load_si128((__m128i const *) src);  /* get 8 sint16 into an XMM register. */
-            /* treat as int32, shift left to clear every other sint16, then back right with sign-extend. Now sint32. */
-            const __m128i a = _mm_srai_epi32(_mm_slli_epi32(ints, 16), 16);
-            /* right-shift-sign-extend gets us sint32 with the other set of values. */
-            const __m128i b = _mm_srai_epi32(ints, 16);
-            /* Interleave these back into the right order, convert to float, multiply, store. */
-            _mm_store_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi32(a, b)), divby32768));
-            _mm_store_ps(dst+4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi32(a, b)), divby32768));
-            i -= 8; src -= 8; dst -= 8;
-        }
-    }
+/* SIMD Filters */
 
-    src += 7; dst += 7;  /* adjust for any scalar finishing. */
+/* The same recurrence as FAudio_INTERNAL_FilterVoice_Scalar, one channel per
+ * lane. Each channel still depends on its previous frame, so 5.1 and 7.1 run
+ * both halves in the same loop to keep two recurrences in flight. The output
+ * is picked with masks rather than a per-sample branch on filter->Type.
+ */
 
-    /* Finish off any leftovers with scalar operations. */
-    while (i) {
-        *dst = ((float) *src) * DIVBY32768;
-        i--; src--; dst--;
-    }
+#if HAVE_SSE2_INTRINSICS
+static inline __m128 FAudio_INTERNAL_LoadLanes_SSE2(
+	const float *src,
+	uint32_t lanes
+) {
+	switch (lanes)
+	{
+	case 1:
+		return _mm_load_ss(src);
+	case 2:
+		return _mm_castpd_ps(_mm_load_sd((const double*) src));
+	case 3:
+		return _mm_movelh_ps(
+			_mm_castpd_ps(_mm_load_sd((const double*) src)),
+			_mm_load_ss(src + 2)
+		);
+	default:
+		return _mm_loadu_ps(src);
+	}
 }
-#endif /* HAVE_SSE2_INTRINSICS */
 
-#if HAVE_NEON_INTRINSICS
-void FAudio_INTERNAL_Convert_U8_To_F32_NEON(
-	const uint8_t *restrict src,
-	float *restrict dst,
-	uint32_t len
+static inline void FAudio_INTERNAL_StoreLanes_SSE2(
+	float *dst,
+	__m128 value,
+	uint32_t lanes
 ) {
-    int i;
-    src += len - 1;
-    dst += len - 1;
+	switch (lanes)
+	{
+	case 1:
+		_mm_store_ss(dst, value);
+		break;
+	case 2:
+		_mm_store_sd((double*) dst, _mm_castps_pd(value));
+		break;
+	case 3:
+		_mm_store_sd((double*) dst, _mm_castps_pd(value));
+		_mm_store_ss(dst + 2, _mm_movehl_ps(value, value));
+		break;
+	default:
+		_mm_storeu_ps(dst, value);
+		break;
+	}
+}
 
-    /* Get dst aligned to 16 bytes (since buffer is growing, we don't have to worry about overreading from src) */
-    for (i = len; i && (((size_t) (dst-15)) & 15); --i, --src, --dst) {
-        *dst = (((float) *src) * DIVBY128) - 1.0f;
-    }
+#define FILTER_TYPE_MASK_SSE2(type) \
+	_mm_castsi128_ps(_mm_set1_epi32(-(int32_t) (filter->Type == type)))
+
+#define FILTER_STEP_SSE2(x, lowPass, bandPass) \
+	lowPass = _mm_add_ps(lowPass, _mm_mul_ps(frequency, bandPass)); \
+	highPass = _mm_sub_ps( \
+		_mm_sub_ps(x, lowPass), \
+		_mm_mul_ps(oneOverQ, bandPass) \
+	); \
+	bandPass = _mm_add_ps(_mm_mul_ps(frequency, highPass), bandPass); \
+	x = _mm_or_ps( \
+		_mm_or_ps( \
+			_mm_and_ps(lowPass, isLowPass), \
+			_mm_and_ps(bandPass, isBandPass) \
+		), \
+		_mm_or_ps( \
+			_mm_and_ps(highPass, isHighPass), \
+			_mm_and_ps(_mm_add_ps(highPass, lowPass), isNotch) \
+		) \
+	);
 
-    src -= 15; dst -= 15;  /* adjust to read NEON blocks from the start. */
-    FAudio_assert(!i || ((((size_t) dst) & 15) == 0));
+void FAudio_INTERNAL_FilterVoice_SSE2(
+	const FAudioFilterParameters *filter,
+	float *restrict filterState,
+	float *restrict samples,
+	uint32_t numSamples,
+	uint16_t numChannels
+) {
+	uint32_t j, ci, lanes;
+	float *frame;
+	const uint32_t bandOffset = FILTER_STATE_SIZE(numChannels) / 2;
+	const __m128 frequency = _mm_set1_ps(filter->Frequency);
+	const __m128 oneOverQ = _mm_set1_ps(filter->OneOverQ);
+	const __m128 isLowPass = FILTER_TYPE_MASK_SSE2(FAudioLowPassFilter);
+	const __m128 isBandPass = FILTER_TYPE_MASK_SSE2(FAudioBandPassFilter);
+	const __m128 isHighPass = FILTER_TYPE_MASK_SSE2(FAudioHighPassFilter);
+	const __m128 isNotch = FILTER_TYPE_MASK_SSE2(FAudioNotchFilter);
+	__m128 lowPass, bandPass, lowPass2, bandPass2, highPass, x, x2;
+
+	if (numChannels > FILTER_LANES && numChannels <= FILTER_LANES * 2)
+	{
+		lanes = numChannels - FILTER_LANES;
+		lowPass = _mm_loadu_ps(filterState);
+		bandPass = _mm_loadu_ps(filterState + bandOffset);
+		lowPass2 = _mm_loadu_ps(filterState + FILTER_LANES);
+		bandPass2 = _mm_loadu_ps(filterState + bandOffset + FILTER_LANES);
+		for (j = 0, frame = samples; j < numSamples; j += 1, frame += numChannels)
+		{
+			x = _mm_loadu_ps(frame);
+			x2 = FAudio_INTERNAL_LoadLanes_SSE2(frame + FILTER_LANES, lanes);
+			FILTER_STEP_SSE2(x, lowPass, bandPass)
+			FILTER_STEP_SSE2(x2, lowPass2, bandPass2)
+			_mm_storeu_ps(frame, x);
+			FAudio_INTERNAL_StoreLanes_SSE2(frame + FILTER_LANES, x2, lanes);
+		}
+		_mm_storeu_ps(filterState, lowPass);
+		_mm_storeu_ps(filterState + bandOffset, bandPass);
+		_mm_storeu_ps(filterState + FILTER_LANES, lowPass2);
+		_mm_storeu_ps(filterState + bandOffset + FILTER_LANES, bandPass2);
+		return;
+	}
 
-    /* Make sure src is aligned too. */
-    if ((((size_t) src) & 15) == 0) {
-        /* Aligned! Do NEON blocks as long as we have 16 bytes available. */
-        const uint8_t *mmsrc = (const uint8_t *) src;
-        const float32x4_t divby128 = vdupq_n_f32(DIVBY128);
-        const float32x4_t one = vdupq_n_f32(1.0f);
-        while (i >= 16) {   /* 16 * 8-bit */
-            const uint8x16_t bytes = vld1q_u8(mmsrc);  /* get 16 uint8 into a NEON register. */
-            const uint16x8_t uint16hi = vmovl_u8(vget_high_u8(bytes));  /* convert top 8 bytes to 8 uint16 */
-            const uint16x8_t uint16lo = vmovl_u8(vget_low_u8(bytes));   /* convert bottom 8 bytes to 8 uint16 */
-            /* split uint16 to two uint32, then convert to float, then multiply to normalize, subtract to adjust for sign, store. */
-            vst1q_f32(dst, vmlsq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(uint16hi))), divby128, one));
-            vst1q_f32(dst+4, vmlsq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(uint16hi))), divby128, one));
-            vst1q_f32(dst+8, vmlsq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(uint16lo))), divby128, one));
-            vst1q_f32(dst+12, vmlsq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(uint16lo))), divby128, one));
-            i -= 16; mmsrc -= 16; dst -= 16;
-        }
+	for (ci = 0; ci < numChannels; ci += FILTER_LANES)
+	{
+		lanes = FAudio_min(numChannels - ci, FILTER_LANES);
+		lowPass = _mm_loadu_ps(filterState + ci);
+		bandPass = _mm_loadu_ps(filterState + bandOffset + ci);
+		for (j = 0, frame = samples + ci; j < numSamples; j += 1, frame += numChannels)
+		{
+			x = FAudio_INTERNAL_LoadLanes_SSE2(frame, lanes);
+			FILTER_STEP_SSE2(x, lowPass, bandPass)
+			FAudio_INTERNAL_StoreLanes_SSE2(frame, x, lanes);
+		}
+		_mm_storeu_ps(filterState + ci, lowPass);
+		_mm_storeu_ps(filterState + bandOffset + ci, bandPass);
+	}
+}
 
-        src = (const uint8_t *) mmsrc;
-    }
+#undef FILTER_STEP_SSE2
+#undef FILTER_TYPE_MASK_SSE2
+#endif /* HAVE_SSE2_INTRINSICS */
 
-    src += 15; dst += 15;  /* adjust for any scalar finishing. */
+#if HAVE_NEON_INTRINSICS
+static inline float32x4_t FAudio_INTERNAL_LoadLanes_NEON(
+	const float *src,
+	uint32_t lanes
+) {
+	float32x4_t value = vdupq_n_f32(0.0f);
+	switch (lanes)
+	{
+	case 1:
+		return vld1q_lane_f32(src, value, 0);
+	case 2:
+		return vcombine_f32(vld1_f32(src), vdup_n_f32(0.0f));
+	case 3:
+		value = vcombine_f32(vld1_f32(src), vdup_n_f32(0.0f));
+		return vld1q_lane_f32(src + 2, value, 2);
+	default:
+		return vld1q_f32(src);
+	}
+}
 
-    /* Finish off any leftovers with scalar operations. */
-    while (i) {
-        *dst = (((float) *src) * DIVBY128) - 1.0f;
-        i--; src--; dst--;
-    }
+static inline void FAudio_INTERNAL_StoreLanes_NEON(
+	float *dst,
+	float32x4_t value,
+	uint32_t lanes
+) {
+	switch (lanes)
+	{
+	case 1:
+		vst1q_lane_f32(dst, value, 0);
+		break;
+	case 2:
+		vst1_f32(dst, vget_low_f32(value));
+		break;
+	case 3:
+		vst1_f32(dst, vget_low_f32(value));
+		vst1q_lane_f32(dst + 2, value, 2);
+		break;
+	default:
+		vst1q_f32(dst, value);
+		break;
+	}
 }
 
-void FAudio_INTERNAL_Convert_S16_To_F32_NEON(
-	const int16_t *restrict src,
-	float *restrict dst,
-	uint32_t len
+#define FILTER_TYPE_MASK_NEON(type) \
+	vdupq_n_u32((uint32_t) -(int32_t) (filter->Type == type))
+
+/* Separate multiplies and adds, vmlaq_f32 may fuse and round differently */
+#define FILTER_STEP_NEON(x, lowPass, bandPass) \
+	lowPass = vaddq_f32(lowPass, vmulq_f32(frequency, bandPass)); \
+	highPass = vsubq_f32( \
+		vsubq_f32(x, lowPass), \
+		vmulq_f32(oneOverQ, bandPass) \
+	); \
+	bandPass = vaddq_f32(vmulq_f32(frequency, highPass), bandPass); \
+	x = vreinterpretq_f32_u32(vorrq_u32( \
+		vorrq_u32( \
+			vandq_u32(vreinterpretq_u32_f32(lowPass), isLowPass), \
+			vandq_u32(vreinterpretq_u32_f32(bandPass), isBandPass) \
+		), \
+		vorrq_u32( \
+			vandq_u32(vreinterpretq_u32_f32(highPass), isHighPass), \
+			vandq_u32( \
+				vreinterpretq_u32_f32(vaddq_f32(highPass, lowPass)), \
+				isNotch \
+			) \
+		) \
+	));
+
+void FAudio_INTERNAL_FilterVoice_NEON(
+	const FAudioFilterParameters *filter,
+	float *restrict filterState,
+	float *restrict samples,
+	uint32_t numSamples,
+	uint16_t numChannels
 ) {
-    int i;
-    src += len - 1;
-    dst += len - 1;
+	uint32_t j, ci, lanes;
+	float *frame;
+	const uint32_t bandOffset = FILTER_STATE_SIZE(numChannels) / 2;
+	const float32x4_t frequency = vdupq_n_f32(filter->Frequency);
+	const float32x4_t oneOverQ = vdupq_n_f32(filter->OneOverQ);
+	const uint32x4_t isLowPass = FILTER_TYPE_MASK_NEON(FAudioLowPassFilter);
+	const uint32x4_t isBandPass = FILTER_TYPE_MASK_NEON(FAudioBandPassFilter);
+	const uint32x4_t isHighPass = FILTER_TYPE_MASK_NEON(FAudioHighPassFilter);
+	const uint32x4_t isNotch = FILTER_TYPE_MASK_NEON(FAudioNotchFilter);
+	float32x4_t lowPass, bandPass, lowPass2, bandPass2, highPass, x, x2;
+
+	if (numChannels > FILTER_LANES && numChannels <= FILTER_LANES * 2)
+	{
+		lanes = numChannels - FILTER_LANES;
+		lowPass = vld1q_f32(filterState);
+		bandPass = vld1q_f32(filterState + bandOffset);
+		lowPass2 = vld1q_f32(filterState + FILTER_LANES);
+		bandPass2 = vld1q_f32(filterState + bandOffset + FILTER_LANES);
+		for (j = 0, frame = samples; j < numSamples; j += 1, frame += numChannels)
+		{
+			x = vld1q_f32(frame);
+			x2 = FAudio_INTERNAL_LoadLanes_NEON(frame + FILTER_LANES, lanes);
+			FILTER_STEP_NEON(x, lowPass, bandPass)
+			FILTER_STEP_NEON(x2, lowPass2, bandPass2)
+			vst1q_f32(frame, x);
+			FAudio_INTERNAL_StoreLanes_NEON(frame + FILTER_LANES, x2, lanes);
+		}
+		vst1q_f32(filterState, lowPass);
+		vst1q_f32(filterState + bandOffset, bandPass);
+		vst1q_f32(filterState + FILTER_LANES, lowPass2);
+		vst1q_f32(filterState + bandOffset + FILTER_LANES, bandPass2);
+		return;
+	}
 
-    /* Get dst aligned to 16 bytes (since buffer is growing, we don't have to worry about overreading from src) */
-    for (i = len; i && (((size_t) (dst-7)) & 15); --i, --src, --dst) {
-        *dst = ((float) *src) * DIVBY32768;
-    }
+	for (ci = 0; ci < numChannels; ci += FILTER_LANES)
+	{
+		lanes = FAudio_min(numChannels - ci, FILTER_LANES);
+		lowPass = vld1q_f32(filterState + ci);
+		bandPass = vld1q_f32(filterState + bandOffset + ci);
+		for (j = 0, frame = samples + ci; j < numSamples; j += 1, frame += numChannels)
+		{
+			x = FAudio_INTERNAL_LoadLanes_NEON(frame, lanes);
+			FILTER_STEP_NEON(x, lowPass, bandPass)
+			FAudio_INTERNAL_StoreLanes_NEON(frame, x, lanes);
+		}
+		vst1q_f32(filterState + ci, lowPass);
+		vst1q_f32(filterState + bandOffset + ci, bandPass);
+	}
+}
 
-    src -= 7; dst -= 7;  /* adjust to read NEON blocks from the start. */
-    FAudio_assert(!i || ((((size_t) dst) & 15) == 0));
+#undef FILTER_STEP_NEON
+#undef FILTER_TYPE_MASK_NEON
+#endif /* HAVE_NEON_INTRINSICS */
 
-    /* Make sure src is aligned too. */
-    if ((((size_t) src) & 15) == 0) {
-        /* Aligned! Do NEON blocks as long as we have 16 bytes available. */
-        const float32x4_t divby32768 = vdupq_n_f32(DIVBY32768);
-        while (i >= 8) {   /* 8 * 16-bit */
-            const int16x8_t ints = vld1q_s16((int16_t const *) src);  /* get 8 sint16 into a NEON register. */
-            /* split int16 to two int32, then convert to float, then multiply to normalize, store. */
-            vst1q_f32(dst, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(ints))), divby32768));
-            vst1q_f32(dst+4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(ints))), divby32768));
-            i -= 8; src -= 8; dst -= 8;
-        }
-    }
+/* Volume */
 
-    src += 7; dst += 7;  /* adjust for any scalar finishing. */
+void FAudio_INTERNAL_ApplyVolume_Scalar(
+	float *restrict samples,
+	uint32_t numSamples,
+	float volume
+) {
+	uint32_t i;
+	for (i = 0; i < numSamples; i += 1)
+	{
+		samples[i] *= volume;
+		samples[i] = FAudio_clamp(
+			samples[i],
+			-FAUDIO_MAX_VOLUME_LEVEL,
+			FAUDIO_MAX_VOLUME_LEVEL
+		);
+	}
+}
 
-    /* Finish off any leftovers with scalar operations. */
-    while (i) {
-        *dst = ((float) *src) * DIVBY32768;
-        i--; src--; dst--;
-    }
+#if HAVE_SSE2_INTRINSICS
+void FAudio_INTERNAL_ApplyVolume_SSE2(
+	float *restrict samples,
+	uint32_t numSamples,
+	float volume
+) {
+	uint32_t i;
+	const __m128 vol = _mm_set1_ps(volume);
+	const __m128 minVol = _mm_set1_ps(-FAUDIO_MAX_VOLUME_LEVEL);
+	const __m128 maxVol = _mm_set1_ps(FAUDIO_MAX_VOLUME_LEVEL);
+	for (i = 0; i + 4 <= numSamples; i += 4)
+	{
+		_mm_storeu_ps(samples + i, _mm_min_ps(_mm_max_ps(
+			_mm_mul_ps(_mm_loadu_ps(samples + i), vol),
+			minVol
+		), maxVol));
+	}
+	FAudio_INTERNAL_ApplyVolume_Scalar(samples + i, numSamples - i, volume);
+}
+#endif /* HAVE_SSE2_INTRINSICS */
+
+#if HAVE_AVX_INTRINSICS
+FAUDIO_TARGET_AVX void FAudio_INTERNAL_ApplyVolume_AVX(
+	float *restrict samples,
+	uint32_t numSamples,
+	float volume
+) {
+	uint32_t i;
+	const __m256 vol = _mm256_set1_ps(volume);
+	const __m256 minVol = _mm256_set1_ps(-FAUDIO_MAX_VOLUME_LEVEL);
+	const __m256 maxVol = _mm256_set1_ps(FAUDIO_MAX_VOLUME_LEVEL);
+	for (i = 0; i + 8 <= numSamples; i += 8)
+	{
+		_mm256_storeu_ps(samples + i, _mm256_min_ps(_mm256_max_ps(
+			_mm256_mul_ps(_mm256_loadu_ps(samples + i), vol),
+			minVol
+		), maxVol));
+	}
+	FAudio_INTERNAL_ApplyVolume_Scalar(samples + i, numSamples - i, volume);
+}
+#endif /* HAVE_AVX_INTRINSICS */
+
+#if HAVE_NEON_INTRINSICS
+void FAudio_INTERNAL_ApplyVolume_NEON(
+	float *restrict samples,
+	uint32_t numSamples,
+	float volume
+) {
+	uint32_t i;
+	const float32x4_t vol = vdupq_n_f32(volume);
+	const float32x4_t minVol = vdupq_n_f32(-FAUDIO_MAX_VOLUME_LEVEL);
+	const float32x4_t maxVol = vdupq_n_f32(FAUDIO_MAX_VOLUME_LEVEL);
+	for (i = 0; i + 4 <= numSamples; i += 4)
+	{
+		vst1q_f32(samples + i, vminq_f32(vmaxq_f32(
+			vmulq_f32(vld1q_f32(samples + i), vol),
+			minVol
+		), maxVol));
+	}
+	FAudio_INTERNAL_ApplyVolume_Scalar(samples + i, numSamples - i, volume);
 }
 #endif /* HAVE_NEON_INTRINSICS */
 
-void FAudio_INTERNAL_InitConverterFunctions(uint8_t hasSSE2, uint8_t hasNEON)
+/* Kernel Table */
+
+FAudioKernelTable FAudio_INTERNAL_Kernels;
+
+static const char *FAudio_INTERNAL_KernelLevelNames[] =
 {
+	"scalar",
+	"sse2",
+	"avx",
+	"avx2",
+	"neon"
+};
+
+void FAudio_INTERNAL_InitKernels(
+	uint8_t hasSSE2,
+	uint8_t hasAVX,
+	uint8_t hasAVX2,
+	uint8_t hasNEON
+) {
+	static uint8_t kernelsReady = 0;
+	FAudioKernelLevel level;
+	const char *hint;
+	uint32_t i;
+
+	/* The CPU is not going to change, so only do this once per process */
+	if (kernelsReady)
+	{
+		return;
+	}
+	FAudio_INTERNAL_InitSincTables();
+
+	/* Best level this build and this CPU can both do... */
+	level = FAUDIO_KERNEL_SCALAR;
 #if HAVE_SSE2_INTRINSICS
 	if (hasSSE2)
 	{
-		FAudio_INTERNAL_Convert_U8_To_F32 = FAudio_INTERNAL_Convert_U8_To_F32_SSE2;
-		FAudio_INTERNAL_Convert_S16_To_F32 = FAudio_INTERNAL_Convert_S16_To_F32_SSE2;
-		return;
+		level = FAUDIO_KERNEL_SSE2;
+#if HAVE_AVX_INTRINSICS
+		if (hasAVX)
+		{
+			level = FAUDIO_KERNEL_AVX;
+#if HAVE_AVX2_INTRINSICS
+			if (hasAVX2)
+			{
+				level = FAUDIO_KERNEL_AVX2;
+			}
+#endif
+		}
+#endif
 	}
 #endif
 #if HAVE_NEON_INTRINSICS
 	if (hasNEON)
 	{
-		FAudio_INTERNAL_Convert_U8_To_F32 = FAudio_INTERNAL_Convert_U8_To_F32_NEON;
-		FAudio_INTERNAL_Convert_S16_To_F32 = FAudio_INTERNAL_Convert_S16_To_F32_NEON;
-		return;
+		level = FAUDIO_KERNEL_NEON;
 	}
 #endif
-#if NEED_SCALAR_CONVERTER_FALLBACKS
-	FAudio_INTERNAL_Convert_U8_To_F32 = FAudio_INTERNAL_Convert_U8_To_F32_Scalar;
-	FAudio_INTERNAL_Convert_S16_To_F32 = FAudio_INTERNAL_Convert_S16_To_F32_Scalar;
-#else
-	FAudio_assert(0 && "Need converter functions!");
+
+	/* ... unless FAUDIO_SIMD asks for something lower, for A/B testing.
+	 * Anything the CPU can't actually run is ignored.
+	 */
+	hint = FAudio_getenv("FAUDIO_SIMD");
+	if (hint != NULL)
+	{
+		for (i = 0; i <= FAUDIO_KERNEL_NEON; i += 1)
+		{
+			if (FAudio_strcmp(hint, FAudio_INTERNAL_KernelLevelNames[i]) != 0)
+			{
+				continue;
+			}
+			if (	i == FAUDIO_KERNEL_SCALAR ||
+				(level != FAUDIO_KERNEL_NEON && i <= level) ||
+				(level == FAUDIO_KERNEL_NEON && i == level)	)
+			{
+				level = (FAudioKernelLevel) i;
+			}
+			break;
+		}
+	}
+	FAudio_INTERNAL_FillKernelTable(&FAudio_INTERNAL_Kernels, level);
+	kernelsReady = 1;
+}
+
+void FAudio_INTERNAL_FillKernelTable(
+	FAudioKernelTable *k,
+	FAudioKernelLevel level
+) {
+	k->level = level;
+
+	/* Everything has a scalar version to fall back on */
+	k->convertU8ToF32 = FAudio_INTERNAL_Convert_U8_To_F32_Scalar;
+	k->convertS16ToF32 = FAudio_INTERNAL_Convert_S16_To_F32_Scalar;
+	k->decodeMSADPCMBlocks = FAudio_INTERNAL_DecodeMSADPCMBlocks_Scalar;
+	k->resampleGeneric = FAudio_INTERNAL_ResampleGeneric_Scalar;
+	k->resampleMono = FAudio_INTERNAL_ResampleMono_Scalar;
+	k->resampleStereo = FAudio_INTERNAL_ResampleGeneric_Scalar;
+	k->resample6Channel = FAudio_INTERNAL_ResampleGeneric_Scalar;
+	k->resample8Channel = FAudio_INTERNAL_ResampleGeneric_Scalar;
+	k->resampleSincMono = FAudio_INTERNAL_ResampleSincGeneric_Scalar;
+	k->resampleSincGeneric = FAudio_INTERNAL_ResampleSincGeneric_Scalar;
+	k->filterVoice = FAudio_INTERNAL_FilterVoice_Scalar;
+	k->mixGeneric = FAudio_INTERNAL_MixGeneric_Scalar;
+	k->mixMonoToStereo = FAudio_INTERNAL_MixGeneric_Scalar;
+	k->mixMonoTo6Channel = FAudio_INTERNAL_MixGeneric_Scalar;
+	k->mixMonoTo8Channel = FAudio_INTERNAL_MixGeneric_Scalar;
+	k->mixStereoToStereo = FAudio_INTERNAL_MixGeneric_Scalar;
+	k->mixStereoTo6Channel = FAudio_INTERNAL_MixGeneric_Scalar;
+	k->mixStereoTo8Channel = FAudio_INTERNAL_MixGeneric_Scalar;
+	k->applyVolume = FAudio_INTERNAL_ApplyVolume_Scalar;
+
+	/* Each x86 level builds on the one below it */
+#if HAVE_SSE2_INTRINSICS
+	if (level >= FAUDIO_KERNEL_SSE2 && level <= FAUDIO_KERNEL_AVX2)
+	{
+		k->convertU8ToF32 = FAudio_INTERNAL_Convert_U8_To_F32_SSE2;
+		k->convertS16ToF32 = FAudio_INTERNAL_Convert_S16_To_F32_SSE2;
+		k->decodeMSADPCMBlocks = FAudio_INTERNAL_DecodeMSADPCMBlocks_SSE2;
+		k->resampleMono = FAudio_INTERNAL_ResampleMono_SSE2;
+		k->resampleStereo = FAudio_INTERNAL_ResampleStereo_SSE2;
+		k->resample6Channel = FAudio_INTERNAL_Resample6Channel_SSE2;
+		k->resample8Channel = FAudio_INTERNAL_Resample8Channel_SSE2;
+		k->resampleSincMono = FAudio_INTERNAL_ResampleSincMono_SSE2;
+		k->resampleSincGeneric = FAudio_INTERNAL_ResampleSincGeneric_SSE2;
+		k->filterVoice = FAudio_INTERNAL_FilterVoice_SSE2;
+		k->mixMonoToStereo = FAudio_INTERNAL_MixMonoToStereo_SSE2;
+		k->mixMonoTo6Channel = FAudio_INTERNAL_MixMonoTo6Channel_SSE2;
+		k->mixMonoTo8Channel = FAudio_INTERNAL_MixMonoTo8Channel_SSE2;
+		k->mixStereoToStereo = FAudio_INTERNAL_MixStereoToStereo_SSE2;
+		k->mixStereoTo6Channel = FAudio_INTERNAL_MixStereoTo6Channel_SSE2;
+		k->mixStereoTo8Channel = FAudio_INTERNAL_MixStereoTo8Channel_SSE2;
+		k->applyVolume = FAudio_INTERNAL_ApplyVolume_SSE2;
+	}
+#endif
+#if HAVE_AVX_INTRINSICS
+	if (level >= FAUDIO_KERNEL_AVX && level <= FAUDIO_KERNEL_AVX2)
+	{
+		k->resampleMono = FAudio_INTERNAL_ResampleMono_AVX;
+		k->resample6Channel = FAudio_INTERNAL_Resample6Channel_AVX;
+		k->resample8Channel = FAudio_INTERNAL_Resample8Channel_AVX;
+		k->applyVolume = FAudio_INTERNAL_ApplyVolume_AVX;
+	}
+#endif
+#if HAVE_AVX2_INTRINSICS
+	if (level == FAUDIO_KERNEL_AVX2)
+	{
+		k->convertU8ToF32 = FAudio_INTERNAL_Convert_U8_To_F32_AVX2;
+		k->convertS16ToF32 = FAudio_INTERNAL_Convert_S16_To_F32_AVX2;
+	}
+#endif
+#if HAVE_NEON_INTRINSICS
+	if (level == FAUDIO_KERNEL_NEON)
+	{
+		k->convertU8ToF32 = FAudio_INTERNAL_Convert_U8_To_F32_NEON;
+		k->convertS16ToF32 = FAudio_INTERNAL_Convert_S16_To_F32_NEON;
+		k->decodeMSADPCMBlocks = FAudio_INTERNAL_DecodeMSADPCMBlocks_NEON;
+		k->filterVoice = FAudio_INTERNAL_FilterVoice_NEON;
+		k->mixMonoToStereo = FAudio_INTERNAL_MixMonoToStereo_NEON;
+		k->mixMonoTo6Channel = FAudio_INTERNAL_MixMonoTo6Channel_NEON;
+		k->mixMonoTo8Channel = FAudio_INTERNAL_MixMonoTo8Channel_NEON;
+		k->mixStereoToStereo = FAudio_INTERNAL_MixStereoToStereo_NEON;
+		k->mixStereoTo6Channel = FAudio_INTERNAL_MixStereoTo6Channel_NEON;
+		k->mixStereoTo8Channel = FAudio_INTERNAL_MixStereoTo8Channel_NEON;
+		k->applyVolume = FAudio_INTERNAL_ApplyVolume_NEON;
+#if HAVE_NEON_F64_INTRINSICS
+		k->resampleMono = FAudio_INTERNAL_ResampleMono_NEON;
+		k->resampleStereo = FAudio_INTERNAL_ResampleStereo_NEON;
+		k->resample6Channel = FAudio_INTERNAL_Resample6Channel_NEON;
+		k->resample8Channel = FAudio_INTERNAL_Resample8Channel_NEON;
+#endif
+	}
 #endif
 }
@@ -28,6 +28,7 @@
 #include "FAPOBase.h"
 
 #ifdef FAUDIO_UNKNOWN_PLATFORM
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -44,6 +45,7 @@
 #define FAudio_strlen(ptr) strlen(ptr)
 #define FAudio_strcmp(str1, str2) strcmp(str1, str2)
 #define FAudio_strlcpy(ptr1, ptr2, size) strlcpy(ptr1, ptr2, size)
+#define FAudio_snprintf snprintf
 
 #define FAudio_pow(x, y) pow(x, y)
 #define FAudio_log10(x) log10(x)
@@ -63,6 +65,7 @@
 #define FAudio_fabsf(x) fabsf(x)
 
 #define FAudio_assert assert
+#define FAudio_getenv(name) getenv(name)
 #else
 #include <SDL_stdinc.h>
 #include <SDL_assert.h>
@@ -78,6 +81,7 @@
 #define FAudio_strlen(ptr) SDL_strlen(ptr)
 #define FAudio_strcmp(str1, str2) SDL_strcmp(str1, str2)
 #define FAudio_strlcpy(ptr1, ptr2, size) SDL_strlcpy(ptr1, ptr2, size)
+#define FAudio_snprintf SDL_snprintf
 
 #define FAudio_pow(x, y) SDL_pow(x, y)
 #define FAudio_log10(x) SDL_log10(x)
@@ -97,6 +101,7 @@
 #define FAudio_fabsf(x) SDL_fabsf(x)
 
 #define FAudio_assert SDL_assert
+#define FAudio_getenv(name) SDL_getenv(name)
 #endif
 
 /* Windows/Visual Studio cruft */
@@ -120,6 +125,7 @@
 
 typedef void* FAudioThread;
 typedef void* FAudioMutex;
+typedef void* FAudioSemaphore;
 typedef int32_t (FAUDIOCALL * FAudioThreadFunc)(void* data);
 typedef enum FAudioThreadPriority
 {
@@ -141,16 +147,73 @@ void LinkedList_AddEntry(
 	void* toAdd,
 	FAudioMutex lock
 );
-void LinkedList_PrependEntry(
+void LinkedList_RemoveEntry(
 	LinkedList **start,
+	void* toRemove,
+	FAudioMutex lock
+);
+
+/* Handle Tables */
+
+/* A handle table keeps its entries packed in one array, so hot loops walk
+ * contiguous memory rather than chasing list nodes. Each entry also gets a
+ * handle: the low bits pick a slot that tracks where the entry currently
+ * lives, the high bits hold that slot's generation, so a handle to a removed
+ * entry never resolves to whatever reused its slot.
+ *
+ * Removing an entry moves the last one into its place. The order only
+ * depends on the sequence of adds and removes, so walks stay deterministic.
+ *
+ * The lock passed to the table functions guards the table's layout. Walking
+ * the entries requires holding that lock too.
+ */
+
+#define HANDLETABLE_SLOT_BITS 20
+#define HANDLETABLE_SLOT_MASK ((1 << HANDLETABLE_SLOT_BITS) - 1)
+#define HANDLETABLE_GENERATION_MASK (0xFFFFFFFF >> HANDLETABLE_SLOT_BITS)
+#define HANDLETABLE_NO_SLOT 0xFFFFFFFF
+
+typedef struct HandleTableEntry
+{
+	void* entry;
+	uint32_t handle;
+	uint8_t active; /* Hot flag for the table's owner, starts at 0 */
+} HandleTableEntry;
+
+typedef struct HandleTable
+{
+	HandleTableEntry *entries;
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t *slots; /* Index into entries, or the next free slot */
+	uint32_t *generations;
+	uint32_t slotCount;
+	uint32_t freeSlot;
+} HandleTable;
+
+uint32_t HandleTable_AddEntry(
+	HandleTable *table,
 	void* toAdd,
 	FAudioMutex lock
 );
-void LinkedList_RemoveEntry(
-	LinkedList **start,
+void HandleTable_RemoveEntry(
+	HandleTable *table,
+	uint32_t handle,
+	FAudioMutex lock
+);
+void HandleTable_RemoveValue(
+	HandleTable *table,
 	void* toRemove,
 	FAudioMutex lock
 );
+void* HandleTable_GetEntry(HandleTable *table, uint32_t handle);
+void HandleTable_SetActive(
+	HandleTable *table,
+	uint32_t handle,
+	uint8_t active,
+	FAudioMutex lock
+);
+void HandleTable_Free(HandleTable *table);
 
 /* Internal FAudio Types */
 
@@ -161,24 +224,441 @@ typedef enum FAudioVoiceType
 	FAUDIO_VOICE_MASTER
 } FAudioVoiceType;
 
-typedef struct FAudioBufferEntry FAudioBufferEntry;
-struct FAudioBufferEntry
-{
-	FAudioBuffer buffer;
-	FAudioBufferEntry *next;
-};
-
 typedef void (FAUDIOCALL * FAudioDecodeCallback)(
+	FAudioVoice *voice,
 	FAudioBuffer *buffer,
 	uint32_t curOffset,
 	float *decodeCache,
-	uint32_t samples,
-	FAudioWaveFormatEx *format
+	uint32_t samples
+);
+
+typedef void (FAUDIOCALL * FAudioResampleCallback)(
+	float *restrict dCache,
+	float *restrict resampleCache,
+	uint64_t *resampleOffset,
+	uint64_t resampleStep,
+	uint64_t toResample,
+	uint8_t channels
+);
+
+typedef void (FAUDIOCALL * FAudioMixCallback)(
+	uint32_t toMix,
+	uint32_t srcChans,
+	uint32_t dstChans,
+	float *restrict srcData,
+	float *restrict dstData,
+	float *restrict coefficients
+);
+
+/* Filter state is planar: the low pass output of every channel, then the band
+ * pass output, each padded to FILTER_LANES so the SIMD filters can run one
+ * channel per lane. High pass and notch are not fed back, so are not kept.
+ */
+#define FILTER_LANES 4
+#define FILTER_STATE_SIZE(channels) \
+	(2 * (((channels) + FILTER_LANES - 1) & ~(FILTER_LANES - 1)))
+
+typedef void (FAUDIOCALL * FAudioFilterCallback)(
+	const FAudioFilterParameters *filter,
+	float *restrict filterState,
+	float *restrict samples,
+	uint32_t numSamples,
+	uint16_t numChannels
+);
+
+typedef void (FAUDIOCALL * FAudioVolumeCallback)(
+	float *restrict samples,
+	uint32_t numSamples,
+	float volume
 );
 
-typedef void* FAudioPlatformFixedRateSRC;
+/* Every DSP kernel that has more than one implementation, picked once per
+ * process by FAudio_INTERNAL_InitKernels from what the CPU supports.
+ */
+typedef enum FAudioKernelLevel
+{
+	FAUDIO_KERNEL_SCALAR,
+	FAUDIO_KERNEL_SSE2,
+	FAUDIO_KERNEL_AVX,
+	FAUDIO_KERNEL_AVX2,
+	FAUDIO_KERNEL_NEON
+} FAudioKernelLevel;
+
+typedef struct FAudioKernelTable
+{
+	FAudioKernelLevel level;
+
+	/* Converters */
+	void (*convertU8ToF32)(
+		const uint8_t *restrict src,
+		float *restrict dst,
+		uint32_t len
+	);
+	void (*convertS16ToF32)(
+		const int16_t *restrict src,
+		float *restrict dst,
+		uint32_t len
+	);
+
+	/* Decodes consecutive blocks starting at buf, never more than
+	 * MSADPCM_LANES / channels of them.
+	 */
+	void (*decodeMSADPCMBlocks)(
+		uint8_t *buf,
+		int16_t *restrict blockCache,
+		uint32_t blocks,
+		uint32_t align,
+		uint16_t channels
+	);
+
+	/* Resamplers */
+	FAudioResampleCallback resampleGeneric;
+	FAudioResampleCallback resampleMono;
+	FAudioResampleCallback resampleStereo;
+	FAudioResampleCallback resample6Channel;
+	FAudioResampleCallback resample8Channel;
+	FAudioResampleCallback resampleSincMono;
+	FAudioResampleCallback resampleSincGeneric;
+
+	/* Filters */
+	FAudioFilterCallback filterVoice;
+
+	/* Send mixers */
+	FAudioMixCallback mixGeneric;
+	FAudioMixCallback mixMonoToStereo;
+	FAudioMixCallback mixMonoTo6Channel;
+	FAudioMixCallback mixMonoTo8Channel;
+	FAudioMixCallback mixStereoToStereo;
+	FAudioMixCallback mixStereoTo6Channel;
+	FAudioMixCallback mixStereoTo8Channel;
+
+	/* Submix/master volume, clamped to FAUDIO_MAX_VOLUME_LEVEL */
+	FAudioVolumeCallback applyVolume;
+} FAudioKernelTable;
+
+/* Temp storage for processing, interleaved PCM32F */
+/* All three caches are carved out of one arena, each starting on a
+ * SCRATCH_ALIGNMENT boundary. The arena is only ever grown by API threads,
+ * see FAudio_INTERNAL_ReserveMixScratch, so the mixer never allocates.
+ */
+#define SCRATCH_ALIGNMENT 64
+typedef struct FAudioMixScratch
+{
+	uint32_t decodeSamples;
+	uint32_t resampleSamples;
+	uint32_t effectChainSamples;
+	void *arena;
+	float *decodeCache;
+	float *resampleCache;
+	float *effectChainCache;
+
+	/* Per-pass counters, summed up by FAudio_INTERNAL_UpdatePerformanceData */
+	uint32_t resamplerCount;
+	uint32_t matrixMixCount;
+} FAudioMixScratch;
+
+/* Parallel source mixing: the active sources are dealt out round-robin to a
+ * fixed number of partitions, each of which mixes into its own copy of every
+ * output bus. The partitions are summed in order afterward, so the output
+ * does not depend on how many threads picked up the partitions.
+ */
+#define MIX_PARTITIONS 16
+
+/* Voice callbacks made while mixing in parallel wait here, and the mixer
+ * makes them in queue order once the partitions are reduced. The storage is
+ * sized with the mix queue and never grows on the mixer: each partition gets
+ * MIX_EVENTS_PER_VOICE for every voice it can be dealt, plus room for one
+ * voice flushing a full buffer queue. Events past that are counted in
+ * eventOverflow and dropped.
+ */
+#define MIX_EVENTS_PER_VOICE 8
+#define MIX_PARTITION_EVENTS(queueCapacity) ( \
+	(((queueCapacity) + MIX_PARTITIONS - 1) / MIX_PARTITIONS) * \
+	MIX_EVENTS_PER_VOICE + \
+	FAUDIO_MAX_QUEUED_BUFFERS * 2 \
+)
+typedef enum FAudioVoiceEventType
+{
+	FAUDIO_EVENT_BUFFERSTART,
+	FAUDIO_EVENT_BUFFEREND,
+	FAUDIO_EVENT_LOOPEND,
+	FAUDIO_EVENT_STREAMEND,
+	FAUDIO_EVENT_PASSEND
+} FAudioVoiceEventType;
+
+typedef struct FAudioVoiceEvent
+{
+	FAudioVoiceEventType type;
+	FAudioSourceVoice *voice;
+	void *context;
+} FAudioVoiceEvent;
+
+typedef struct FAudioMixPartition
+{
+	float *bus;
+	uint8_t *busUsed;
+	uint32_t busSamples;
+	uint32_t busCount;
+	FAudioVoiceEvent *events;
+	uint32_t eventCount;
+	uint32_t eventCapacity;
+	uint32_t eventOverflow;
+} FAudioMixPartition;
+
+typedef void (*FAudioMixJob)(
+	FAudio *audio,
+	FAudioMixScratch *scratch,
+	uint32_t index
+);
+
+typedef struct FAudioMixWorker
+{
+	FAudio *audio;
+	FAudioThread thread;
+	FAudioMixScratch scratch;
+} FAudioMixWorker;
+
+/* Voice parameter changes are queued by the API and applied by the mixer at
+ * the start of its next pass, so the mixer never waits on a game thread.
+ * The ring is a bounded MPSC queue: producers claim cells by bumping
+ * commandHead, and whoever drains it holds commandLock.
+ *
+ * Commands are only ever applied between passes: the mixer drains the ring
+ * under scratchLock before it mixes, and an API thread that needs them
+ * applied right away takes commandLock and then scratchLock. Sends and
+ * effect chains are swapped in by commands too, so the mixer owns all of
+ * this state and reads it without taking any voice locks. Each cell keeps
+ * its own payload storage across laps; only the producer ever grows it.
+ */
+#define COMMAND_RING_SIZE 1024
+#define COMMAND_PAYLOAD_SIZE 128 /* An 8x4 matrix fits without growing */
+
+typedef enum FAudioCommandType
+{
+	FAUDIO_COMMAND_SETVOLUME,
+	FAUDIO_COMMAND_SETCHANNELVOLUMES,
+	FAUDIO_COMMAND_SETOUTPUTMATRIX,
+	FAUDIO_COMMAND_SETFILTERPARAMETERS,
+	FAUDIO_COMMAND_SETEFFECTPARAMETERS,
+	FAUDIO_COMMAND_SETFREQUENCYRATIO,
+	/* Only ever staged, the immediate versions lock directly */
+	FAUDIO_COMMAND_START,
+	FAUDIO_COMMAND_STOP,
+	FAUDIO_COMMAND_ENABLEEFFECT,
+	FAUDIO_COMMAND_DISABLEEFFECT,
+	FAUDIO_COMMAND_EXITLOOP,
+	/* A committed operation set, applied as one command */
+	FAUDIO_COMMAND_COMMIT,
+	/* Never staged, the API call waits for these to be applied */
+	FAUDIO_COMMAND_SETOUTPUTVOICES,
+	FAUDIO_COMMAND_SETEFFECTCHAIN
+} FAudioCommandType;
+
+typedef struct FAudioCommandBatch FAudioCommandBatch;
+typedef struct FAudioVoiceChange FAudioVoiceChange;
+
+typedef struct FAudioCommand
+{
+	int32_t sequence;
+	FAudioCommandType type;
+	FAudioVoice *voice;
+	uint32_t index; /* Send index, effect index or Start/Stop flags */
+	uint32_t operationSet;
+	union
+	{
+		float value;
+		FAudioFilterParameters filter;
+		struct
+		{
+			uint32_t offset; /* Staged commands: into the batch arena */
+			uint32_t size;
+		} block;
+		FAudioCommandBatch *batch;
+		FAudioVoiceChange *change;
+	} data;
+
+	/* Ring cells only */
+	uint8_t *payload;
+	uint32_t payloadCapacity;
+} FAudioCommand;
+
+/* Changes made with an OperationSet wait in the staging batch until
+ * CommitChanges moves them into a batch of their own and queues that as a
+ * single command. Payloads are copied into the batch's arena.
+ *
+ * The batches are allocated with the engine and grown on the API thread as
+ * voices, sends and effects come and go, to hold one change of everything
+ * (see FAudio_INTERNAL_ReserveStagedCommands), so staging doesn't allocate.
+ * Whoever applies a batch hands it back by clearing busy.
+ */
+#define COMMAND_BATCHES 4
+#define COMMAND_BATCH_SIZE 256
+#define COMMAND_BATCH_ARENA 4096
+#define STAGED_COMMANDS_PER_VOICE 8 /* Levels, filter, pitch, state */
+
+struct FAudioCommandBatch
+{
+	int32_t busy; /* Staging or queued */
+	FAudioCommand *commands;
+	uint32_t count;
+	uint32_t capacity;
+	uint8_t *arena;
+	uint32_t arenaUsed;
+	uint32_t arenaCapacity;
+};
+
+/* A voice's effect chain. The mixer accumulates profileTicks, and copies
+ * them to publishedTicks for GetProfile, see FAudioVoiceStats.
+ */
+typedef struct FAudioVoiceEffects
+{
+	uint32_t count;
+	FAudioEffectDescriptor *desc;
+	void **parameters;
+	uint32_t *parameterSizes;
+	uint32_t *parameterCapacities; /* Only grown by the API */
+	uint8_t *parameterUpdates;
+	uint8_t *inPlaceProcessing;
+	uint32_t maxChannels; /* Widest OutputChannels in the chain */
+#ifdef FAUDIO_PROFILE
+	uint64_t *profileTicks;
+	int32_t *publishedTicks; /* Two words per effect */
+#endif
+} FAudioVoiceEffects;
+
+/* SetOutputVoices and SetEffectChain build the voice's new arrays here, on
+ * their own thread, and queue a command pointing at it. Applying the command
+ * swaps them with the voice's, so once it is applied this holds the old
+ * arrays, for the API thread to free.
+ */
+struct FAudioVoiceChange
+{
+	uint8_t applied; /* Guarded by commandLock */
+
+	/* FAUDIO_COMMAND_SETOUTPUTVOICES */
+	FAudioVoiceSends sends;
+	float **mixSendCoefficients;
+	float **mixCoefficients;
+	FAudioMixCallback *sendMix;
+	uint32_t outputSamples;
+
+	/* FAUDIO_COMMAND_SETEFFECTCHAIN */
+	FAudioVoiceEffects effects;
+	uint32_t outputChannels;
+};
+
+/* What GetState and GetProfile report. The mixer copies these out as 32-bit
+ * atomic words after every pass, bumping statsSequence before and after, so
+ * it is odd mid-copy. Readers retry until it is even and unchanged around
+ * their own copy, so neither side ever waits on the other.
+ */
+typedef struct FAudioVoiceStats
+{
+	uint64_t samplesPlayed;
+#ifdef FAUDIO_PROFILE
+	FAudioVoiceProfile profile;
+#endif
+} FAudioVoiceStats;
+
+#define VOICE_STATS_WORDS (sizeof(FAudioVoiceStats) / sizeof(int32_t))
+
+/* Profiling, see FAudioVoice_GetProfile. All of this compiles to nothing
+ * unless FAUDIO_PROFILE is defined.
+ */
+#ifdef FAUDIO_PROFILE
+#define PROFILE_MARK(stamp) stamp = FAudio_timecounter()
+#define PROFILE_STAGE(total, stamp) \
+	{ \
+		uint64_t profileNow = FAudio_timecounter(); \
+		total += profileNow - stamp; \
+		stamp = profileNow; \
+	}
+#else
+#define PROFILE_MARK(stamp)
+#define PROFILE_STAGE(total, stamp)
+#endif
+
+/* Tracing, see FAudio_StartTrace. Events go into a ring that overwrites
+ * the oldest entry when full, so recording never blocks or allocates. A
+ * cell's sequence is pos + 1 once it holds the event claimed at pos. Writers
+ * claim a cell by swapping its sequence to TRACE_CELL_BUSY, and drop their
+ * event instead of waiting if another writer holds it or has already put a
+ * newer event there.
+ */
+#define TRACE_MIN_EVENTS 1024
+#define TRACE_EVENT_JSON_MAX 256
+#define TRACE_CELL_BUSY -1
+
+typedef struct FAudioTraceEvent
+{
+	int32_t sequence;
+	char phase; /* 'B', 'E' or 'i', as in the Chrome trace format */
+	const char *name; /* Always a string literal */
+	const void *object;
+	uint64_t thread;
+	uint64_t time;
+} FAudioTraceEvent;
+
+/* Allocated once by the first StartTrace and published with a CAS, so the
+ * mask always travels with the events it describes.
+ */
+typedef struct FAudioTraceRing
+{
+	uint32_t mask;
+	FAudioTraceEvent *events; /* Follows the ring in the same block */
+} FAudioTraceRing;
+
+#define TRACE_BEGIN(audio, name, object) \
+	FAudio_INTERNAL_Trace(audio, name, object, 'B')
+#define TRACE_END(audio, name, object) \
+	FAudio_INTERNAL_Trace(audio, name, object, 'E')
+#define TRACE_INSTANT(audio, name, object) \
+	FAudio_INTERNAL_Trace(audio, name, object, 'i')
+
+/* MSADPCM blocks are decoded this many channels at a time, so a mono voice
+ * decodes up to four blocks at once and a stereo voice up to two.
+ */
+#define MSADPCM_LANES 4
+
+/* Shared MSADPCM block cache, see FAudio_SetDecodeCacheSize. Entries are
+ * keyed by the address of the encoded block, and keep a copy of it that is
+ * compared on every hit, so reused buffer memory never returns stale PCM.
+ * The PCM and the encoded copy follow the entry in its pool slot.
+ *
+ * The hash also picks one of several shards, each with its own lock, LRU
+ * list and share of the entries, so mix workers rarely wait on each other.
+ * Each shard's pool is allocated by the API whenever the size changes or a
+ * voice needs bigger slots, and swapped in under that shard's lock with the
+ * newest entries copied over, so the mixer only ever recycles entries.
+ */
+#define DECODE_CACHE_BITS 10
+#define DECODE_CACHE_BUCKETS (1 << DECODE_CACHE_BITS)
+#define DECODE_CACHE_SHARD_BITS 4
+#define DECODE_CACHE_SHARDS (1 << DECODE_CACHE_SHARD_BITS)
+
+typedef struct FAudioDecodeCacheEntry FAudioDecodeCacheEntry;
+struct FAudioDecodeCacheEntry
+{
+	const uint8_t *src;
+	uint16_t align;
+	uint16_t channels;
+	int16_t *pcm;
+	uint8_t *encoded;
+	FAudioDecodeCacheEntry *hashNext; /* Or the next free entry */
+	FAudioDecodeCacheEntry *newer;
+	FAudioDecodeCacheEntry *older;
+};
 
-typedef float FAudioFilterState[4];
+typedef struct FAudioDecodeCacheShard
+{
+	FAudioDecodeCacheEntry *buckets[DECODE_CACHE_BUCKETS / DECODE_CACHE_SHARDS];
+	FAudioDecodeCacheEntry *newest;
+	FAudioDecodeCacheEntry *oldest;
+	FAudioDecodeCacheEntry *free;
+	uint8_t *pool;
+	uint32_t slotBytes; /* 0 while the cache is off */
+	FAudioMutex lock;
+} FAudioDecodeCacheShard;
 
 /* Public FAudio Types */
 
@@ -187,25 +667,133 @@ struct FAudio
 	uint8_t version;
 	uint8_t active;
 	uint32_t refcount;
+	uint8_t initialized; /* Initialize took a platform ref */
+	uint32_t initFlags;
 	uint32_t updateSize;
-	uint32_t submixStages;
 	FAudioMasteringVoice *master;
-	LinkedList *sources;
-	LinkedList *submixes;
-	LinkedList *callbacks;
-	FAudioMutex sourceLock;
+	HandleTable sources;
+	HandleTable submixes;
+	HandleTable callbacks;
+	FAudioMutex sourceLock; /* Held while sources are mixed */
+	FAudioMutex sourceTableLock; /* Guards the sources table layout */
 	FAudioMutex submixLock;
 	FAudioMutex callbackLock;
 	FAudioWaveFormatExtensible *mixFormat;
 
-	/* Temp storage for processing, interleaved PCM32F */
+	/* Active sources for this update, copied from the sources table.
+	 * Sized by FAudio_INTERNAL_AddSourceVoice, never by the mixer.
+	 */
+	FAudioSourceVoice **mixQueue;
+	uint32_t mixQueueCount;
+	uint32_t mixQueueCapacity;
+
+	/* Submix execution plan: submixPlan is sorted by processing stage,
+	 * then split into tasks that share no output voices. Stage i runs
+	 * tasks [submixStageTasks[i], submixStageTasks[i + 1]), and task j
+	 * mixes submixPlan[submixTasks[j]] up to submixPlan[submixTasks[j + 1]].
+	 */
+	FAudioSubmixVoice **submixPlan;
+	uint32_t *submixTasks;
+	uint32_t *submixStageTasks;
+	uint32_t submixStageCount;
+
 	#define EXTRA_DECODE_PADDING 2
-	uint32_t decodeSamples;
-	uint32_t resampleSamples;
-	uint32_t effectChainSamples;
-	float *decodeCache;
-	float *resampleCache;
-	float *effectChainCache;
+	#define SINC_TAPS 16
+	#define SINC_HISTORY (SINC_TAPS - EXTRA_DECODE_PADDING)
+	#define SINC_DELAY (SINC_TAPS / 2 - 1)
+	FAudioMixScratch scratch;
+	FAudioMutex scratchLock; /* Held by the mixer for the whole pass */
+
+	/* Parallel source mixing, see FAudio_SetEngineThreadCount */
+	uint32_t threadCount;
+	uint8_t workerQuit;
+	FAudioMixWorker *workers;
+	FAudioSemaphore workerStart;
+	FAudioSemaphore workerDone;
+	FAudioMutex workerLock;
+	FAudioMixJob job;
+	uint32_t jobCount;
+	uint32_t nextJob;
+	uint32_t jobStage;
+	FAudioMixPartition partitions[MIX_PARTITIONS];
+	FAudioVoiceEvent *partitionEvents; /* Backs every partition's events */
+	uint32_t droppedVoiceEvents; /* Total eventOverflow, for debugging */
+	uint32_t busCount;
+	uint32_t busSamples;
+
+	/* Queued voice parameter changes, see FAudio_INTERNAL_PushCommand */
+	FAudioCommand *commands;
+	uint8_t *commandPayloads;
+	int32_t commandHead;
+	uint32_t commandTail;
+	FAudioMutex commandLock;
+	FAudioVoice *dirtyVoices; /* Levels changed by the drain in progress */
+
+	/* Deferred operation sets, see FAudio_CommitChanges. The reserve is
+	 * what one change to every live voice needs, guarded by stagingLock.
+	 */
+	FAudioCommandBatch batches[COMMAND_BATCHES];
+	FAudioCommandBatch *staged;
+	uint32_t stagingReserveCommands;
+	uint32_t stagingReserveBytes;
+	FAudioMutex stagingLock;
+
+	/* Performance data: the mixer accumulates into perfPending and hands
+	 * it over whenever it can take perfLock without waiting.
+	 */
+	FAudioPerformanceData perfPending;
+	FAudioPerformanceData perfData;
+	uint64_t perfLastQuery;
+	FAudioMutex perfLock;
+
+	/* Shared MSADPCM block cache, see FAudio_SetDecodeCacheSize */
+	FAudioDecodeCacheShard decodeCache[DECODE_CACHE_SHARDS];
+	FAudioMutex decodeCacheLock; /* Serializes resizes, not the mixer */
+	uint32_t decodeCacheSize;
+	uint32_t decodeCacheSlotBytes; /* PCM plus encoded copy, per entry */
+
+	/* Parked source voices, see FAudio_SetSourceVoicePoolSize */
+	FAudioSourceVoice **voicePool;
+	uint32_t voicePoolCount;
+	uint32_t voicePoolSize;
+	FAudioMutex voicePoolLock;
+
+	/* Voice virtualization, see FAudio_SetVirtualVoiceThreshold.
+	 * Negative when disabled. Guarded by sourceLock.
+	 */
+	float virtualThreshold;
+
+	/* Load governor, see FAudio_SetLoadGovernor. governorLoad is the
+	 * smoothed share of the quantum the update took, mixer only. The rest
+	 * is guarded by sourceLock.
+	 */
+	#define GOVERNOR_SHED_RESAMPLER 1
+	#define GOVERNOR_SHED_FILTERS 2
+	#define GOVERNOR_SHED_VIRTUAL 3 /* Up to GOVERNOR_MAX_LEVEL */
+	#define GOVERNOR_MAX_LEVEL 5
+	#define GOVERNOR_SMOOTHING 0.25f
+	#define GOVERNOR_HOLD_PASSES 4
+	#define GOVERNOR_CALM_LOAD 0.75f
+	#define GOVERNOR_CALM_PASSES 32
+	float governorMaxLoad; /* 0 when disabled */
+	float governorLoad;
+	uint32_t governorLevel; /* GOVERNOR_SHED_*, or higher */
+	uint32_t governorHold; /* Passes until the level may change again */
+	uint32_t governorCalm; /* Passes spent well under governorMaxLoad */
+
+	/* Timeline tracing, see FAudio_StartTrace */
+	int32_t tracing;
+	void *traceRing; /* FAudioTraceRing*, atomic */
+	int32_t traceHead;
+	uint32_t traceStart;
+	uint64_t traceStartTime;
+
+	/* Pull mode, see FAudio_Render. pullCache holds one quantum, of which
+	 * the frames before pullOffset have already been handed out.
+	 */
+	FAudioWaveFormatExtensible pullFormat;
+	float *pullCache;
+	uint32_t pullOffset;
 };
 
 struct FAudioVoice
@@ -214,21 +802,20 @@ struct FAudioVoice
 	uint32_t flags;
 	FAudioVoiceType type;
 
+	/* The sends and effects are swapped in by commands, see
+	 * FAudioVoiceChange. API threads read the sends under volumeLock,
+	 * which SetOutputVoices holds until its change is in.
+	 */
 	FAudioVoiceSends sends;
 	float **sendCoefficients;
-	struct
-	{
-		uint32_t count;
-		FAudioEffectDescriptor *desc;
-		void **parameters;
-		uint32_t *parameterSizes;
-		uint8_t *parameterUpdates;
-		uint8_t *inPlaceProcessing;
-	} effects;
+	float **mixCoefficients;
+	uint8_t mixCoefficientsDirty; /* On audio->dirtyVoices */
+	FAudioVoice *nextDirty;
+	float mixPeak; /* Largest mixCoefficient, for virtualization */
+	FAudioMixCallback *sendMix;
+	FAudioVoiceEffects effects;
 	FAudioFilterParameters filter;
-	FAudioFilterState *filterState;
-	FAudioMutex sendLock;
-	FAudioMutex effectLock;
+	float *filterState; /* FILTER_STATE_SIZE floats */
 	FAudioMutex filterLock;
 
 	float volume;
@@ -236,6 +823,31 @@ struct FAudioVoice
 	uint32_t outputChannels;
 	FAudioMutex volumeLock;
 
+#ifdef FAUDIO_PROFILE
+	FAudioVoiceProfile profile; /* Mixer only, published in stats */
+#endif
+	int32_t statsSequence;
+	int32_t stats[VOICE_STATS_WORDS];
+
+	/* The mixer's copy of the levels and filter. The API thread only
+	 * changes these through the command queue.
+	 */
+	float mixVolume;
+	float *mixChannelVolume;
+	float **mixSendCoefficients;
+	FAudioFilterParameters mixFilter;
+
+	/* Handle in audio->sources or audio->submixes */
+	uint32_t handle;
+
+	/* This voice's share of the staging reserve, guarded by stagingLock */
+	uint32_t stagingCommands;
+	uint32_t stagingBytes;
+
+	/* Partition bus layout, only used by submix/master voices */
+	uint32_t busIndex;
+	uint32_t busOffset;
+
 	union
 	{
 		struct
@@ -245,9 +857,12 @@ struct FAudioVoice
 			uint32_t resampleSamples;
 
 			/* Resampler */
+			FAudioResampleCallback resample;
+			FAudioResampleCallback linearResample;
 			float resampleFreqRatio;
 			uint64_t resampleStep;
 			uint64_t resampleOffset;
+			float *sincHistory; /* FAUDIO_VOICE_SINC_SRC only */
 			uint64_t curBufferOffsetDec;
 			uint32_t curBufferOffset;
 
@@ -255,13 +870,38 @@ struct FAudioVoice
 			float maxFreqRatio;
 			FAudioWaveFormatEx format; /* TODO: WaveFormatExtensible! */
 			FAudioDecodeCallback decode;
+
+			/* MSADPCM only: the last decoded blocks, up to
+			 * MSADPCM_LANES channels' worth, and the encoded block
+			 * the first one came from. NULL whenever the buffer
+			 * changes.
+			 */
+			int16_t *blockCache;
+			uint8_t *blockCacheSrc;
+			uint32_t blockCacheCount;
 			FAudioVoiceCallback *callback;
 
 			/* Dynamic */
 			uint8_t active;
+			int32_t priority; /* Atomic, read by the mixer */
 			float freqRatio;
-			uint64_t totalSamples;
-			FAudioBufferEntry *bufferList;
+			float mixFreqRatio;
+			uint64_t totalSamples; /* Mixer only */
+
+			/* Buffer queue, a ring of FAUDIO_MAX_QUEUED_BUFFERS.
+			 * The API submits at bufferHead, the mixer consumes at
+			 * bufferTail. Flushes and loop exits are requests the
+			 * consumer picks up; bufferLock only serializes the API
+			 * side and is never taken by the mixer.
+			 */
+			FAudioBuffer *bufferQueue;
+			int32_t bufferHead;
+			int32_t bufferTail;
+			int32_t bufferFlush; /* Everything before this is flushed */
+			int32_t bufferExitLoop;
+			uint8_t bufferIdle; /* Mixer only: no buffer started yet */
+			uint8_t virtualized; /* Mixer only: DSP skipped last pass */
+			uint8_t filterShed; /* Mixer only: governor skipped the filter */
 			FAudioMutex bufferLock;
 		} src;
 		struct
@@ -270,7 +910,15 @@ struct FAudioVoice
 			uint32_t inputSamples;
 			uint32_t outputSamples;
 			float *inputCache;
-			FAudioPlatformFixedRateSRC resampler;
+
+			/* Fixed-rate SRC, skipped when resampleStep is one.
+			 * The history holds the last input frame of the previous
+			 * update, to lerp across the update boundary.
+			 */
+			FAudioResampleCallback resample;
+			uint64_t resampleStep;
+			uint64_t resampleOffset;
+			float *resampleHistory;
 
 			/* Read-only */
 			uint32_t inputChannels;
@@ -292,28 +940,121 @@ struct FAudioVoice
 /* Internal Functions */
 
 void FAudio_INTERNAL_UpdateEngine(FAudio *audio, float *output);
-void FAudio_INTERNAL_ResizeDecodeCache(FAudio *audio, uint32_t size);
-void FAudio_INTERNAL_ResizeResampleCache(FAudio *audio, uint32_t size);
-void FAudio_INTERNAL_ResizeEffectChainCache(FAudio *audio, uint32_t samples);
+void FAudio_INTERNAL_InitPullMode(FAudio *audio);
+void FAudio_INTERNAL_ReserveMixScratch(
+	FAudio *audio,
+	uint32_t decodeSamples,
+	uint32_t resampleSamples,
+	uint32_t effectChainSamples
+);
+void FAudio_INTERNAL_ReserveEffectChain(
+	FAudioVoice *voice,
+	const FAudioEffectChain *pEffectChain,
+	uint32_t frames
+);
+void FAudio_INTERNAL_StartMixWorkers(FAudio *audio, uint32_t threadCount);
+void FAudio_INTERNAL_StopMixWorkers(FAudio *audio);
+void FAudio_INTERNAL_BuildSubmixPlan(FAudio *audio);
+void FAudio_INTERNAL_LayoutMixBuses(FAudio *audio);
+void FAudio_INTERNAL_AddSubmixVoice(
+	FAudio *audio,
+	FAudioSubmixVoice *voice
+);
+void FAudio_INTERNAL_RemoveSubmixVoice(FAudioSubmixVoice *voice);
+void FAudio_INTERNAL_AddSourceVoice(
+	FAudio *audio,
+	FAudioSourceVoice *voice
+);
+void FAudio_INTERNAL_InitSubmixSRC(FAudioSubmixVoice *voice);
+void FAudio_INTERNAL_PushCommand(
+	FAudio *audio,
+	FAudioCommand *command,
+	const void *payload
+);
+void FAudio_INTERNAL_UpdateMixCoefficients(FAudioVoice *voice);
+void FAudio_INTERNAL_LockCommands(FAudio *audio);
+void FAudio_INTERNAL_UnlockCommands(FAudio *audio);
+void FAudio_INTERNAL_QueueVoiceChange(FAudio *audio, FAudioCommand *command);
+void FAudio_INTERNAL_ReadVoiceStats(
+	FAudioVoice *voice,
+	FAudioVoiceStats *stats,
+	uint64_t *effectTicks,
+	uint32_t effectCount
+);
+void FAudio_INTERNAL_FlushCommands(FAudio *audio);
+void FAudio_INTERNAL_FlushSourceBuffers(
+	FAudioSourceVoice *voice,
+	FAudioMixPartition *partition,
+	uint8_t keepCurrent
+);
+void FAudio_INTERNAL_SubmitCommand(
+	FAudio *audio,
+	FAudioCommand *command,
+	const void *payload,
+	uint32_t OperationSet
+);
+uint32_t FAudio_INTERNAL_CommitCommands(FAudio *audio, uint32_t OperationSet);
+void FAudio_INTERNAL_DiscardStagedCommands(FAudio *audio, FAudioVoice *voice);
+void FAudio_INTERNAL_AllocCommands(FAudio *audio);
+void FAudio_INTERNAL_ReserveStagedCommands(
+	FAudioVoice *voice,
+	uint8_t release
+);
+void FAudio_INTERNAL_ReserveEffectParameters(
+	FAudioVoice *voice,
+	uint32_t index,
+	uint32_t size
+);
+void FAudio_INTERNAL_FreeCommands(FAudio *audio);
+void FAudio_INTERNAL_SetDecodeCacheSize(FAudio *audio, uint32_t size);
+void FAudio_INTERNAL_ReserveDecodeCache(FAudio *audio, uint32_t slotBytes);
+void FAudio_INTERNAL_Trace(
+	FAudio *audio,
+	const char *name,
+	const void *object,
+	char phase
+);
+uint32_t FAudio_INTERNAL_WriteTraceJSON(
+	FAudio *audio,
+	char *buffer,
+	uint32_t bufferSize
+);
 void FAudio_INTERNAL_SetDefaultMatrix(
 	float *matrix,
 	uint32_t srcChannels,
 	uint32_t dstChannels
 );
 void FAudio_INTERNAL_AllocEffectChain(
-	FAudioVoice *voice,
+	FAudioVoiceEffects *effects,
 	const FAudioEffectChain *pEffectChain
 );
-void FAudio_INTERNAL_FreeEffectChain(FAudioVoice *voice);
-void FAudio_INTERNAL_InitConverterFunctions(uint8_t hasSSE2, uint8_t hasNEON);
+void FAudio_INTERNAL_FreeEffectChain(FAudioVoiceEffects *effects);
+void FAudio_INTERNAL_FreeSends(FAudioVoice *voice);
+void FAudio_INTERNAL_SetSourceVoicePoolSize(FAudio *audio, uint32_t size);
+uint8_t FAudio_INTERNAL_PoolSourceVoice(FAudioSourceVoice *voice);
+FAudioSourceVoice* FAudio_INTERNAL_TakePooledVoice(
+	FAudio *audio,
+	const FAudioWaveFormatEx *format,
+	uint32_t flags
+);
+void FAudio_INTERNAL_InitKernels(
+	uint8_t hasSSE2,
+	uint8_t hasAVX,
+	uint8_t hasAVX2,
+	uint8_t hasNEON
+);
+void FAudio_INTERNAL_FillKernelTable(
+	FAudioKernelTable *k,
+	FAudioKernelLevel level
+);
 
 #define DECODE_FUNC(type) \
 	extern void FAudio_INTERNAL_Decode##type( \
+		FAudioVoice *voice, \
 		FAudioBuffer *buffer, \
 		uint32_t curOffset, \
 		float *decodeCache, \
-		uint32_t samples, \
-		FAudioWaveFormatEx *format \
+		uint32_t samples \
 	);
 DECODE_FUNC(PCM8)
 DECODE_FUNC(PCM16)
@@ -322,10 +1063,12 @@ DECODE_FUNC(MonoMSADPCM)
 DECODE_FUNC(StereoMSADPCM)
 #undef DECODE_FUNC
 
+extern FAudioKernelTable FAudio_INTERNAL_Kernels;
+
 /* Platform Functions */
 
-void FAudio_PlatformAddRef(void);
-void FAudio_PlatformRelease(void);
+void FAudio_PlatformAddRef(uint8_t useDevice);
+void FAudio_PlatformRelease(uint8_t useDevice);
 void FAudio_PlatformInit(FAudio *audio, uint32_t deviceIndex);
 void FAudio_PlatformQuit(FAudio *audio);
 void FAudio_PlatformStart(FAudio *audio);
@@ -337,20 +1080,6 @@ void FAudio_PlatformGetDeviceDetails(
 	FAudioDeviceDetails *details
 );
 
-FAudioPlatformFixedRateSRC FAudio_PlatformInitFixedRateSRC(
-	uint32_t channels,
-	uint32_t inputRate,
-	uint32_t outputRate
-);
-void FAudio_PlatformCloseFixedRateSRC(FAudioPlatformFixedRateSRC resampler);
-uint32_t FAudio_PlatformResample(
-	FAudioPlatformFixedRateSRC resampler,
-	float *input,
-	uint32_t inLen,
-	float *output,
-	uint32_t outLen
-);
-
 /* Threading */
 
 FAudioThread FAudio_PlatformCreateThread(
@@ -364,11 +1093,36 @@ FAudioMutex FAudio_PlatformCreateMutex(void);
 void FAudio_PlatformDestroyMutex(FAudioMutex mutex);
 void FAudio_PlatformLockMutex(FAudioMutex mutex);
 void FAudio_PlatformUnlockMutex(FAudioMutex mutex);
+uint8_t FAudio_PlatformTryLockMutex(FAudioMutex mutex);
+FAudioSemaphore FAudio_PlatformCreateSemaphore(uint32_t initialValue);
+void FAudio_PlatformDestroySemaphore(FAudioSemaphore semaphore);
+void FAudio_PlatformWaitSemaphore(FAudioSemaphore semaphore);
+void FAudio_PlatformSignalSemaphore(FAudioSemaphore semaphore);
+uint64_t FAudio_PlatformGetThreadID(void);
 void FAudio_sleep(uint32_t ms);
 
+/* Atomics */
+
+int32_t FAudio_PlatformAtomicGet(int32_t *value);
+void FAudio_PlatformAtomicSet(int32_t *value, int32_t newValue);
+uint8_t FAudio_PlatformAtomicCAS(
+	int32_t *value,
+	int32_t oldValue,
+	int32_t newValue
+);
+int32_t FAudio_PlatformAtomicAdd(int32_t *value, int32_t amount);
+void* FAudio_PlatformAtomicGetPtr(void **value);
+uint8_t FAudio_PlatformAtomicCASPtr(
+	void **value,
+	void *oldValue,
+	void *newValue
+);
+
 /* Time */
 
 uint32_t FAudio_timems(void);
+uint64_t FAudio_timecounter(void);
+uint64_t FAudio_timefrequency(void);
 
 /* Easy Macros */
 
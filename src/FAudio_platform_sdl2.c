@@ -36,13 +36,13 @@ typedef struct FAudioPlatformDevice
 	uint32_t bufferSize;
 	SDL_AudioDeviceID device;
 	FAudioWaveFormatExtensible format;
-	LinkedList *engineList;
+	HandleTable engineList;
 	FAudioMutex engineLock;
 } FAudioPlatformDevice;
 
 /* Globals */
 
-LinkedList *devlist = NULL;
+HandleTable devlist;
 FAudioMutex devlock = NULL;
 
 /* Mixer Thread */
@@ -50,28 +50,35 @@ FAudioMutex devlock = NULL;
 void FAudio_INTERNAL_MixCallback(void *userdata, Uint8 *stream, int len)
 {
 	FAudioPlatformDevice *device = (FAudioPlatformDevice*) userdata;
-	LinkedList *audio;
+	uint32_t i;
 
 	FAudio_zero(stream, len);
-	audio = device->engineList;
-	while (audio != NULL)
+	FAudio_PlatformLockMutex(device->engineLock);
+	for (i = 0; i < device->engineList.count; i += 1)
 	{
 		FAudio_INTERNAL_UpdateEngine(
-			(FAudio*) audio->entry,
+			(FAudio*) device->engineList.entries[i].entry,
 			(float*) stream
 		);
-		audio = audio->next;
 	}
+	FAudio_PlatformUnlockMutex(device->engineLock);
 }
 
 /* Platform Functions */
 
-void FAudio_PlatformAddRef()
+void FAudio_PlatformAddRef(uint8_t useDevice)
 {
-	/* SDL tracks ref counts for each subsystem */
-	SDL_InitSubSystem(SDL_INIT_AUDIO);
-	FAudio_INTERNAL_InitConverterFunctions(
+	/* SDL tracks ref counts for each subsystem. Pull mode engines never
+	 * open a device, so they leave the audio subsystem alone.
+	 */
+	if (useDevice)
+	{
+		SDL_InitSubSystem(SDL_INIT_AUDIO);
+	}
+	FAudio_INTERNAL_InitKernels(
 		SDL_HasSSE2(),
+		SDL_HasAVX(),
+		SDL_HasAVX2(),
 		SDL_HasNEON()
 	);
 	if (devlock == NULL)
@@ -80,15 +87,18 @@ void FAudio_PlatformAddRef()
 	}
 }
 
-void FAudio_PlatformRelease()
+void FAudio_PlatformRelease(uint8_t useDevice)
 {
 	/* SDL tracks ref counts for each subsystem */
-	SDL_QuitSubSystem(SDL_INIT_AUDIO);
+	if (useDevice)
+	{
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+	}
 }
 
 void FAudio_PlatformInit(FAudio *audio, uint32_t deviceIndex)
 {
-	LinkedList *deviceList;
+	uint32_t i;
 	FAudioPlatformDevice *device;
 	SDL_AudioSpec want, have;
 	const char *name;
@@ -96,44 +106,43 @@ void FAudio_PlatformInit(FAudio *audio, uint32_t deviceIndex)
 	/* Use the device that the engine tells us to use, then check to see if
 	 * another instance has opened the device.
 	 */
+	device = NULL;
 	if (deviceIndex == 0)
 	{
 		name = NULL;
-		deviceList = devlist;
-		while (deviceList != NULL)
+		for (i = 0; i < devlist.count; i += 1)
 		{
-			if (((FAudioPlatformDevice*) deviceList->entry)->name == NULL)
+			if (((FAudioPlatformDevice*) devlist.entries[i].entry)->name == NULL)
 			{
+				device = (FAudioPlatformDevice*) devlist.entries[i].entry;
 				break;
 			}
-			deviceList = deviceList->next;
 		}
 	}
 	else
 	{
 		name = SDL_GetAudioDeviceName(deviceIndex - 1, 0);
-		deviceList = devlist;
-		while (deviceList != NULL)
+		for (i = 0; i < devlist.count; i += 1)
 		{
-			if (FAudio_strcmp(((FAudioPlatformDevice*) deviceList->entry)->name, name) == 0)
+			if (FAudio_strcmp(((FAudioPlatformDevice*) devlist.entries[i].entry)->name, name) == 0)
 			{
+				device = (FAudioPlatformDevice*) devlist.entries[i].entry;
 				break;
 			}
-			deviceList = deviceList->next;
 		}
 	}
 
 	/* Create a new device if the requested one is not in use yet */
-	if (deviceList == NULL)
+	if (device == NULL)
 	{
 		/* Allocate a new device container*/
 		device = (FAudioPlatformDevice*) FAudio_malloc(
 			sizeof(FAudioPlatformDevice)
 		);
 		device->name = name;
-		device->engineList = NULL;
+		FAudio_zero(&device->engineList, sizeof(HandleTable));
 		device->engineLock = FAudio_PlatformCreateMutex();
-		LinkedList_AddEntry(
+		HandleTable_AddEntry(
 			&device->engineList,
 			audio,
 			device->engineLock
@@ -158,11 +167,12 @@ void FAudio_PlatformInit(FAudio *audio, uint32_t deviceIndex)
 		);
 		if (device->device == 0)
 		{
-			LinkedList_RemoveEntry(
+			HandleTable_RemoveValue(
 				&device->engineList,
 				audio,
 				device->engineLock
 			);
+			HandleTable_Free(&device->engineList);
 			FAudio_PlatformDestroyMutex(device->engineLock);
 			FAudio_free(device);
 			SDL_Log("%s\n", SDL_GetError());
@@ -229,12 +239,10 @@ void FAudio_PlatformInit(FAudio *audio, uint32_t deviceIndex)
 		audio->master->master.inputSampleRate = have.freq;
 
 		/* Add to the device list */
-		LinkedList_AddEntry(&devlist, device, devlock);
+		HandleTable_AddEntry(&devlist, device, devlock);
 	}
 	else /* Just add us to the existing device */
 	{
-		device = (FAudioPlatformDevice*) deviceList->entry;
-
 		/* But give us the output format first! */
 		audio->updateSize = device->bufferSize;
 		audio->mixFormat = &device->format;
@@ -245,7 +253,7 @@ void FAudio_PlatformInit(FAudio *audio, uint32_t deviceIndex)
 		audio->master->master.inputSampleRate =
 			device->format.Format.nSamplesPerSec;
 
-		LinkedList_AddEntry(
+		HandleTable_AddEntry(
 			&device->engineList,
 			audio,
 			device->engineLock
@@ -253,100 +261,70 @@ void FAudio_PlatformInit(FAudio *audio, uint32_t deviceIndex)
 	}
 }
 
-void FAudio_PlatformQuit(FAudio *audio)
+static FAudioPlatformDevice* FAudio_INTERNAL_FindDevice(FAudio *audio)
 {
+	uint32_t i, j;
 	FAudioPlatformDevice *device;
-	LinkedList *dev, *entry;
-	uint8_t found = 0;
 
-	dev = devlist;
-	while (dev != NULL)
+	for (i = 0; i < devlist.count; i += 1)
 	{
-		device = (FAudioPlatformDevice*) dev->entry;
-		entry = device->engineList;
-		while (entry != NULL)
+		device = (FAudioPlatformDevice*) devlist.entries[i].entry;
+		for (j = 0; j < device->engineList.count; j += 1)
 		{
-			if (entry->entry == audio)
+			if (((FAudio*) device->engineList.entries[j].entry) == audio)
 			{
-				found = 1;
-				break;
+				return device;
 			}
-			entry = entry->next;
 		}
+	}
+	return NULL;
+}
 
-		if (found)
-		{
-			LinkedList_RemoveEntry(
-				&device->engineList,
-				audio,
-				device->engineLock
-			);
+void FAudio_PlatformQuit(FAudio *audio)
+{
+	FAudioPlatformDevice *device = FAudio_INTERNAL_FindDevice(audio);
+	if (device == NULL)
+	{
+		return;
+	}
 
-			if (device->engineList == NULL)
-			{
-				SDL_CloseAudioDevice(
-					device->device
-				);
-				LinkedList_RemoveEntry(
-					&devlist,
-					device,
-					devlock
-				);
-				FAudio_PlatformDestroyMutex(device->engineLock);
-				FAudio_free(device);
-			}
+	HandleTable_RemoveValue(
+		&device->engineList,
+		audio,
+		device->engineLock
+	);
 
-			return;
-		}
-		dev = dev->next;
+	if (device->engineList.count == 0)
+	{
+		SDL_CloseAudioDevice(
+			device->device
+		);
+		HandleTable_RemoveValue(
+			&devlist,
+			device,
+			devlock
+		);
+		HandleTable_Free(&device->engineList);
+		FAudio_PlatformDestroyMutex(device->engineLock);
+		FAudio_free(device);
 	}
 }
 
 void FAudio_PlatformStart(FAudio *audio)
 {
-	LinkedList *dev, *entry;
-
-	dev = devlist;
-	while (dev != NULL)
+	FAudioPlatformDevice *device = FAudio_INTERNAL_FindDevice(audio);
+	if (device != NULL)
 	{
-		entry = ((FAudioPlatformDevice*) dev->entry)->engineList;
-		while (entry != NULL)
-		{
-			if (((FAudio*) entry->entry) == audio)
-			{
-				SDL_PauseAudioDevice(
-					((FAudioPlatformDevice*) dev->entry)->device,
-					0
-				);
-				return;
-			}
-			entry = entry->next;
-		}
-		dev = dev->next;
+		SDL_PauseAudioDevice(device->device, 0);
 	}
 }
 
 void FAudio_PlatformStop(FAudio *audio)
 {
-	LinkedList *dev, *entry;
-
-	dev = devlist;
-	while (dev != NULL)
+	FAudioPlatformDevice *device = FAudio_INTERNAL_FindDevice(audio);
+	if (device != NULL)
 	{
-		entry = ((FAudioPlatformDevice*) dev->entry)->engineList;
-		while (entry != NULL)
-		{
-			if (((FAudio*) entry->entry) == audio)
-			{
-				SDL_PauseAudioDevice(
-					((FAudioPlatformDevice*) dev->entry)->device,
-					1
-				);
-				return;
-			}
-			entry = entry->next;
-		}
-		dev = dev->next;
+		SDL_PauseAudioDevice(device->device, 1);
 	}
 }
 
@@ -403,42 +381,6 @@ void FAudio_PlatformGetDeviceDetails(
 	);
 }
 
-FAudioPlatformFixedRateSRC FAudio_PlatformInitFixedRateSRC(
-	uint32_t channels,
-	uint32_t inputRate,
-	uint32_t outputRate
-) {
-	return (FAudioPlatformFixedRateSRC) SDL_NewAudioStream(
-		AUDIO_F32,
-		channels,
-		inputRate,
-		AUDIO_F32,
-		channels,
-		outputRate
-	);
-}
-
-void FAudio_PlatformCloseFixedRateSRC(FAudioPlatformFixedRateSRC resampler)
-{
-	SDL_FreeAudioStream((SDL_AudioStream*) resampler);
-}
-
-uint32_t FAudio_PlatformResample(
-	FAudioPlatformFixedRateSRC resampler,
-	float *input,
-	uint32_t inLen,
-	float *output,
-	uint32_t outLen
-) {
-	SDL_AudioStream *stream = (SDL_AudioStream*) resampler;
-	SDL_AudioStreamPut(stream, input, inLen * sizeof(float));
-	return SDL_AudioStreamGet(
-		stream,
-		output,
-		outLen * sizeof(float)
-	) / sizeof(float);
-}
-
 /* Threading */
 
 FAudioThread FAudio_PlatformCreateThread(
@@ -463,6 +405,11 @@ void FAudio_PlatformThreadPriority(FAudioThreadPriority priority)
 	SDL_SetThreadPriority((SDL_ThreadPriority) priority);
 }
 
+uint64_t FAudio_PlatformGetThreadID()
+{
+	return (uint64_t) SDL_ThreadID();
+}
+
 FAudioMutex FAudio_PlatformCreateMutex()
 {
 	return (FAudioMutex) SDL_CreateMutex();
@@ -483,11 +430,74 @@ void FAudio_PlatformUnlockMutex(FAudioMutex mutex)
 	SDL_UnlockMutex((SDL_mutex*) mutex);
 }
 
+uint8_t FAudio_PlatformTryLockMutex(FAudioMutex mutex)
+{
+	return SDL_TryLockMutex((SDL_mutex*) mutex) == 0;
+}
+
+FAudioSemaphore FAudio_PlatformCreateSemaphore(uint32_t initialValue)
+{
+	return (FAudioSemaphore) SDL_CreateSemaphore(initialValue);
+}
+
+void FAudio_PlatformDestroySemaphore(FAudioSemaphore semaphore)
+{
+	SDL_DestroySemaphore((SDL_sem*) semaphore);
+}
+
+void FAudio_PlatformWaitSemaphore(FAudioSemaphore semaphore)
+{
+	SDL_SemWait((SDL_sem*) semaphore);
+}
+
+void FAudio_PlatformSignalSemaphore(FAudioSemaphore semaphore)
+{
+	SDL_SemPost((SDL_sem*) semaphore);
+}
+
 void FAudio_sleep(uint32_t ms)
 {
 	SDL_Delay(ms);
 }
 
+/* Atomics */
+
+int32_t FAudio_PlatformAtomicGet(int32_t *value)
+{
+	return SDL_AtomicGet((SDL_atomic_t*) value);
+}
+
+void FAudio_PlatformAtomicSet(int32_t *value, int32_t newValue)
+{
+	SDL_AtomicSet((SDL_atomic_t*) value, newValue);
+}
+
+uint8_t FAudio_PlatformAtomicCAS(
+	int32_t *value,
+	int32_t oldValue,
+	int32_t newValue
+) {
+	return SDL_AtomicCAS((SDL_atomic_t*) value, oldValue, newValue);
+}
+
+int32_t FAudio_PlatformAtomicAdd(int32_t *value, int32_t amount)
+{
+	return SDL_AtomicAdd((SDL_atomic_t*) value, amount);
+}
+
+void* FAudio_PlatformAtomicGetPtr(void **value)
+{
+	return SDL_AtomicGetPtr(value);
+}
+
+uint8_t FAudio_PlatformAtomicCASPtr(
+	void **value,
+	void *oldValue,
+	void *newValue
+) {
+	return SDL_AtomicCASPtr(value, oldValue, newValue);
+}
+
 /* Time */
 
 uint32_t FAudio_timems()
@@ -495,6 +505,16 @@ uint32_t FAudio_timems()
 	return SDL_GetTicks();
 }
 
+uint64_t FAudio_timecounter()
+{
+	return SDL_GetPerformanceCounter();
+}
+
+uint64_t FAudio_timefrequency()
+{
+	return SDL_GetPerformanceFrequency();
+}
+
 /* FAudio I/O */
 
 FAudioIOStream* FAudio_fopen(const char *path)
@@ -123,6 +123,9 @@ void XNA_SongKill()
 FAUDIOAPI void XNA_SongInit()
 {
 	FAudioCreate(&songAudio, 0, FAUDIO_DEFAULT_PROCESSOR);
+
+	/* Songs are played back to back, usually in the same format */
+	FAudio_SetSourceVoicePoolSize(songAudio, 1);
 	FAudio_CreateMasteringVoice(
 		songAudio,
 		&songMaster,
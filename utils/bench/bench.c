@@ -0,0 +1,425 @@
+/* FAudio - XAudio Reimplementation for FNA
+ *
+ * Copyright (c) 2011-2018 Ethan Lee, Luigi Auriemma, and the MonoGame Team
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ * claim that you wrote the original software. If you use this software in a
+ * product, an acknowledgment in the product documentation would be
+ * appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ * misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Ethan "flibitijibibo" Lee <flibitijibibo@flibitijibibo.com>
+ *
+ */
+
+/* Mixer throughput benchmark. Runs the engine in pull mode, so no audio
+ * device is needed, and prints one CSV row per case to stdout:
+ *
+ *	bench [quanta per case] [engine thread count]
+ */
+
+#include <FAudio.h>
+#include <FAudioFX.h>
+#include <FAPO.h>
+#include <SDL.h>
+
+#define SAMPLE_RATE 48000
+#define OUTPUT_CHANNELS 2
+#define ADPCM_SAMPLES_PER_BLOCK 128
+
+typedef enum BenchFormat
+{
+	BENCH_PCM8,
+	BENCH_PCM16,
+	BENCH_FLOAT,
+	BENCH_MSADPCM
+} BenchFormat;
+
+static const char *formatNames[] =
+{
+	"pcm8",
+	"pcm16",
+	"float",
+	"msadpcm"
+};
+
+typedef struct BenchCase
+{
+	const char *name;
+	uint32_t voices;
+	BenchFormat format;
+	uint16_t channels;
+	float ratio;
+	uint8_t filter;
+	uint32_t effects; /* Reverbs in each source voice's chain */
+	uint32_t depth; /* Submixes between the sources and the master */
+} BenchCase;
+
+static const BenchCase cases[] =
+{
+	/* Voice count */
+	{ "voices",	1,	BENCH_PCM16,	1, 1.0f, 0, 0, 0 },
+	{ "voices",	10,	BENCH_PCM16,	1, 1.0f, 0, 0, 0 },
+	{ "voices",	100,	BENCH_PCM16,	1, 1.0f, 0, 0, 0 },
+	{ "voices",	500,	BENCH_PCM16,	1, 1.0f, 0, 0, 0 },
+	{ "voices",	1000,	BENCH_PCM16,	1, 1.0f, 0, 0, 0 },
+	{ "voices",	2000,	BENCH_PCM16,	1, 1.0f, 0, 0, 0 },
+
+	/* Source format and frequency ratio */
+	{ "format",	256,	BENCH_PCM8,	1, 1.0f, 0, 0, 0 },
+	{ "format",	256,	BENCH_PCM8,	2, 1.0f, 0, 0, 0 },
+	{ "format",	256,	BENCH_PCM16,	1, 1.0f, 0, 0, 0 },
+	{ "format",	256,	BENCH_PCM16,	2, 1.0f, 0, 0, 0 },
+	{ "format",	256,	BENCH_FLOAT,	1, 1.0f, 0, 0, 0 },
+	{ "format",	256,	BENCH_FLOAT,	2, 1.0f, 0, 0, 0 },
+	{ "format",	256,	BENCH_MSADPCM,	1, 1.0f, 0, 0, 0 },
+	{ "format",	256,	BENCH_MSADPCM,	2, 1.0f, 0, 0, 0 },
+	{ "format",	256,	BENCH_PCM8,	1, 1.5f, 0, 0, 0 },
+	{ "format",	256,	BENCH_PCM8,	2, 1.5f, 0, 0, 0 },
+	{ "format",	256,	BENCH_PCM16,	1, 1.5f, 0, 0, 0 },
+	{ "format",	256,	BENCH_PCM16,	2, 1.5f, 0, 0, 0 },
+	{ "format",	256,	BENCH_FLOAT,	1, 1.5f, 0, 0, 0 },
+	{ "format",	256,	BENCH_FLOAT,	2, 1.5f, 0, 0, 0 },
+	{ "format",	256,	BENCH_MSADPCM,	1, 1.5f, 0, 0, 0 },
+	{ "format",	256,	BENCH_MSADPCM,	2, 1.5f, 0, 0, 0 },
+
+	/* Voice filter */
+	{ "filter",	256,	BENCH_PCM16,	1, 1.0f, 1, 0, 0 },
+	{ "filter",	256,	BENCH_PCM16,	2, 1.0f, 1, 0, 0 },
+	{ "filter",	256,	BENCH_PCM16,	1, 1.5f, 1, 0, 0 },
+
+	/* Effect chains */
+	{ "effects",	32,	BENCH_PCM16,	2, 1.0f, 0, 0, 0 },
+	{ "effects",	32,	BENCH_PCM16,	2, 1.0f, 0, 1, 0 },
+	{ "effects",	32,	BENCH_PCM16,	2, 1.0f, 0, 2, 0 },
+	{ "effects",	32,	BENCH_PCM16,	2, 1.0f, 0, 4, 0 },
+
+	/* Submix depth */
+	{ "submix",	256,	BENCH_PCM16,	1, 1.0f, 0, 0, 1 },
+	{ "submix",	256,	BENCH_PCM16,	1, 1.0f, 0, 0, 2 },
+	{ "submix",	256,	BENCH_PCM16,	1, 1.0f, 0, 0, 4 },
+	{ "submix",	256,	BENCH_PCM16,	1, 1.0f, 0, 0, 8 }
+};
+
+/* Deterministic noise, so every run decodes the exact same data */
+static uint32_t noiseState = 0x12345678;
+static uint32_t Noise()
+{
+	noiseState = noiseState * 1664525 + 1013904223;
+	return noiseState >> 8;
+}
+
+static void MakeSource(
+	BenchFormat format,
+	uint16_t channels,
+	FAudioWaveFormatEx *fmt,
+	FAudioBuffer *buffer
+) {
+	uint32_t i, frames, blocks;
+	uint8_t *data;
+
+	/* One second of audio, looped forever */
+	frames = SAMPLE_RATE;
+	fmt->wFormatTag = 1;
+	fmt->nChannels = channels;
+	fmt->nSamplesPerSec = SAMPLE_RATE;
+	fmt->cbSize = 0;
+	if (format == BENCH_PCM8)
+	{
+		fmt->wBitsPerSample = 8;
+	}
+	else if (format == BENCH_PCM16)
+	{
+		fmt->wBitsPerSample = 16;
+	}
+	else if (format == BENCH_FLOAT)
+	{
+		fmt->wFormatTag = 3;
+		fmt->wBitsPerSample = 32;
+	}
+
+	if (format == BENCH_MSADPCM)
+	{
+		fmt->wFormatTag = 2;
+		fmt->wBitsPerSample = 4;
+		fmt->nBlockAlign = ((ADPCM_SAMPLES_PER_BLOCK / 2) + 6) * channels;
+		fmt->cbSize = 32;
+		blocks = frames / ADPCM_SAMPLES_PER_BLOCK;
+		fmt->nAvgBytesPerSec = (
+			fmt->nBlockAlign *
+			SAMPLE_RATE /
+			ADPCM_SAMPLES_PER_BLOCK
+		);
+		buffer->AudioBytes = blocks * fmt->nBlockAlign;
+		data = (uint8_t*) SDL_malloc(buffer->AudioBytes);
+		for (i = 0; i < buffer->AudioBytes; i += 1)
+		{
+			data[i] = (uint8_t) Noise();
+		}
+
+		/* Valid preambles: predictor < 7, sane delta */
+		for (i = 0; i < blocks; i += 1)
+		{
+			uint8_t *block = data + (i * fmt->nBlockAlign);
+			block[0] = (uint8_t) (i % 7);
+			if (channels == 2)
+			{
+				block[1] = (uint8_t) ((i + 3) % 7);
+				block[2] = 64;
+				block[3] = 0;
+				block[4] = 64;
+				block[5] = 0;
+			}
+			else
+			{
+				block[1] = 64;
+				block[2] = 0;
+			}
+		}
+	}
+	else
+	{
+		fmt->nBlockAlign = channels * (fmt->wBitsPerSample / 8);
+		fmt->nAvgBytesPerSec = SAMPLE_RATE * fmt->nBlockAlign;
+		buffer->AudioBytes = frames * fmt->nBlockAlign;
+		data = (uint8_t*) SDL_malloc(buffer->AudioBytes);
+		if (format == BENCH_FLOAT)
+		{
+			for (i = 0; i < frames * channels; i += 1)
+			{
+				((float*) data)[i] = (
+					(float) (Noise() & 0xFFFF) / 32768.0f
+				) - 1.0f;
+			}
+		}
+		else
+		{
+			for (i = 0; i < buffer->AudioBytes; i += 1)
+			{
+				data[i] = (uint8_t) Noise();
+			}
+		}
+	}
+
+	buffer->Flags = 0;
+	buffer->pAudioData = data;
+	buffer->PlayBegin = 0;
+	buffer->PlayLength = 0;
+	buffer->LoopBegin = 0;
+	buffer->LoopLength = 0;
+	buffer->LoopCount = FAUDIO_LOOP_INFINITE;
+	buffer->pContext = NULL;
+}
+
+static void RunCase(const BenchCase *bc, uint32_t quanta, uint32_t threads)
+{
+	FAudio *audio;
+	FAudioMasteringVoice *master;
+	FAudioSubmixVoice *submixes[8];
+	FAudioSourceVoice **voices;
+	FAudioADPCMWaveFormat *fmt;
+	FAudioBuffer buffer;
+	FAudioSendDescriptor send;
+	FAudioVoiceSends sends;
+	FAudioEffectDescriptor effects[4];
+	FAudioEffectChain chain;
+	FAudioFilterParameters filter;
+	FAPO *reverb;
+	float *output;
+	uint32_t i, j, frames;
+	uint64_t start, elapsed;
+	double seconds, nsPerVoice;
+
+	FAudioCreate(&audio, FAUDIO_PULL_MODE, FAUDIO_DEFAULT_PROCESSOR);
+	if (threads > 0)
+	{
+		FAudio_SetEngineThreadCount(audio, threads);
+	}
+	FAudio_CreateMasteringVoice(
+		audio,
+		&master,
+		OUTPUT_CHANNELS,
+		SAMPLE_RATE,
+		0,
+		0,
+		NULL
+	);
+
+	/* Submix chain, built from the master outwards. The sources feed the
+	 * last one, which has to be processed first.
+	 */
+	sends.SendCount = 1;
+	sends.pSends = &send;
+	send.Flags = 0;
+	for (i = 0; i < bc->depth; i += 1)
+	{
+		send.pOutputVoice = (i == 0) ? master : submixes[i - 1];
+		FAudio_CreateSubmixVoice(
+			audio,
+			&submixes[i],
+			OUTPUT_CHANNELS,
+			SAMPLE_RATE,
+			0,
+			bc->depth - i,
+			&sends,
+			NULL
+		);
+	}
+	send.pOutputVoice = (bc->depth == 0) ?
+		master :
+		submixes[bc->depth - 1];
+
+	/* Sources */
+	fmt = (FAudioADPCMWaveFormat*) SDL_malloc(
+		sizeof(FAudioADPCMWaveFormat) +
+		sizeof(FAudioADPCMCoefSet) * 7
+	);
+	MakeSource(bc->format, bc->channels, &fmt->wfx, &buffer);
+	fmt->wSamplesPerBlock = ADPCM_SAMPLES_PER_BLOCK;
+	fmt->wNumCoef = 7;
+	fmt->aCoef[0].iCoef1 = 256;	fmt->aCoef[0].iCoef2 = 0;
+	fmt->aCoef[1].iCoef1 = 512;	fmt->aCoef[1].iCoef2 = -256;
+	fmt->aCoef[2].iCoef1 = 0;	fmt->aCoef[2].iCoef2 = 0;
+	fmt->aCoef[3].iCoef1 = 192;	fmt->aCoef[3].iCoef2 = 64;
+	fmt->aCoef[4].iCoef1 = 240;	fmt->aCoef[4].iCoef2 = 0;
+	fmt->aCoef[5].iCoef1 = 460;	fmt->aCoef[5].iCoef2 = -208;
+	fmt->aCoef[6].iCoef1 = 392;	fmt->aCoef[6].iCoef2 = -232;
+
+	filter.Type = FAudioLowPassFilter;
+	filter.Frequency = 0.5f;
+	filter.OneOverQ = 1.0f;
+
+	voices = (FAudioSourceVoice**) SDL_malloc(
+		sizeof(FAudioSourceVoice*) * bc->voices
+	);
+	for (i = 0; i < bc->voices; i += 1)
+	{
+		for (j = 0; j < bc->effects; j += 1)
+		{
+			FAudioCreateReverb(&reverb, 0);
+			effects[j].pEffect = reverb;
+			effects[j].InitialState = 1;
+			effects[j].OutputChannels = bc->channels;
+		}
+		chain.EffectCount = bc->effects;
+		chain.pEffectDescriptors = effects;
+
+		FAudio_CreateSourceVoice(
+			audio,
+			&voices[i],
+			&fmt->wfx,
+			bc->filter ? FAUDIO_VOICE_USEFILTER : 0,
+			FAUDIO_DEFAULT_FREQ_RATIO,
+			NULL,
+			&sends,
+			(bc->effects > 0) ? &chain : NULL
+		);
+
+		/* The voices hold their own references now */
+		for (j = 0; j < bc->effects; j += 1)
+		{
+			effects[j].pEffect->Release(effects[j].pEffect);
+		}
+
+		if (bc->filter)
+		{
+			FAudioVoice_SetFilterParameters(
+				voices[i],
+				&filter,
+				FAUDIO_COMMIT_NOW
+			);
+		}
+		if (bc->ratio != 1.0f)
+		{
+			FAudioSourceVoice_SetFrequencyRatio(
+				voices[i],
+				bc->ratio,
+				FAUDIO_COMMIT_NOW
+			);
+		}
+		FAudioSourceVoice_SubmitSourceBuffer(voices[i], &buffer, NULL);
+		FAudioSourceVoice_Start(voices[i], 0, FAUDIO_COMMIT_NOW);
+	}
+
+	/* Warm up the caches, then time whole quanta */
+	frames = SAMPLE_RATE / 100;
+	output = (float*) SDL_malloc(
+		sizeof(float) * frames * OUTPUT_CHANNELS
+	);
+	for (i = 0; i < 10; i += 1)
+	{
+		FAudio_Render(audio, output, frames);
+	}
+	start = SDL_GetPerformanceCounter();
+	for (i = 0; i < quanta; i += 1)
+	{
+		FAudio_Render(audio, output, frames);
+	}
+	elapsed = SDL_GetPerformanceCounter() - start;
+	seconds = (double) elapsed / (double) SDL_GetPerformanceFrequency();
+	nsPerVoice = seconds * 1000000000.0 / quanta / bc->voices;
+
+	printf(
+		"%s,%u,%s,%u,%.2f,%u,%u,%u,%u,%u,%.6f,%.1f,%.1f,%.2f\n",
+		bc->name,
+		bc->voices,
+		formatNames[bc->format],
+		bc->channels,
+		bc->ratio,
+		bc->filter,
+		bc->effects,
+		bc->depth,
+		threads,
+		quanta,
+		seconds,
+		quanta / seconds,
+		nsPerVoice,
+		(quanta / 100.0) / seconds
+	);
+	fflush(stdout);
+
+	for (i = 0; i < bc->voices; i += 1)
+	{
+		FAudioVoice_DestroyVoice(voices[i]);
+	}
+	for (i = bc->depth; i > 0; i -= 1)
+	{
+		FAudioVoice_DestroyVoice(submixes[i - 1]);
+	}
+	FAudioVoice_DestroyVoice(master);
+	FAudio_Release(audio);
+	SDL_free(output);
+	SDL_free(voices);
+	SDL_free((void*) buffer.pAudioData);
+	SDL_free(fmt);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t i, quanta, threads;
+
+	quanta = (argc > 1) ? SDL_atoi(argv[1]) : 200;
+	threads = (argc > 2) ? SDL_atoi(argv[2]) : 0;
+
+	printf(
+		"case,voices,format,channels,ratio,filter,effects,depth,"
+		"threads,quanta,seconds,quanta_per_sec,ns_per_voice,realtime\n"
+	);
+	for (i = 0; i < SDL_arraysize(cases); i += 1)
+	{
+		RunCase(&cases[i], quanta, threads);
+	}
+	return 0;
+}
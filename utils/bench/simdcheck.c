@@ -0,0 +1,412 @@
+/* FAudio - XAudio Reimplementation for FNA
+ *
+ * Copyright (c) 2011-2018 Ethan Lee, Luigi Auriemma, and the MonoGame Team
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ * claim that you wrote the original software. If you use this software in a
+ * product, an acknowledgment in the product documentation would be
+ * appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ * misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Ethan "flibitijibibo" Lee <flibitijibibo@flibitijibibo.com>
+ *
+ */
+
+/* Scalar vs. SIMD kernel comparison. Runs every DSP kernel at each SIMD level
+ * this build and CPU can do (FAUDIO_SIMD lowers the ceiling, as it does for
+ * the engine) on the same noise as the scalar kernel, and prints one CSV row
+ * per kernel and level with the largest difference and both timings:
+ *
+ *	simdcheck [iterations]
+ *
+ * The SIMD kernels are meant to match the scalar ones bit for bit, so any
+ * difference at all is a failure and the exit code is 1.
+ */
+
+#include <FAudio_internal.h> /* DO NOT INCLUDE THIS IN REAL CODE! */
+#include <SDL.h>
+
+#define FRAMES 480 /* One 10ms update at 48KHz */
+#define MAX_CHANNELS 8
+#define MAX_SAMPLES (FRAMES * MAX_CHANNELS)
+
+/* Deterministic noise, so every level sees the exact same input */
+static uint32_t noiseState = 0x12345678;
+static uint32_t Noise()
+{
+	noiseState = noiseState * 1664525 + 1013904223;
+	return noiseState >> 8;
+}
+static float NoiseFloat()
+{
+	return ((float) (Noise() & 0xFFFF) / 32768.0f) - 1.0f;
+}
+
+/* Inputs, filled once. Resampler input gets room for the sinc taps. */
+static uint8_t inputU8[MAX_SAMPLES];
+static int16_t inputS16[MAX_SAMPLES];
+static float inputF32[(FRAMES * 3 + SINC_TAPS + 2) * MAX_CHANNELS];
+static float inputCoefficients[MAX_CHANNELS * MAX_CHANNELS];
+static uint8_t inputMonoMSADPCM[MSADPCM_LANES * 70];
+static uint8_t inputStereoMSADPCM[MSADPCM_LANES * 70];
+
+/* Output, big enough for everything (MSADPCM is 4 * 128 samples) */
+#define OUTPUT_SIZE (FRAMES * MAX_CHANNELS)
+
+typedef struct CheckCase
+{
+	const char *name;
+	/* Runs the kernel from k into out, copying in the input first for
+	 * the kernels that work in place or add to their output.
+	 */
+	void (*run)(
+		const FAudioKernelTable *k,
+		const struct CheckCase *cc,
+		float *out
+	);
+	uint32_t srcChannels;
+	uint32_t dstChannels;
+	double ratio;
+	FAudioFilterType filterType;
+} CheckCase;
+
+static void RunConvertU8(
+	const FAudioKernelTable *k,
+	const CheckCase *cc,
+	float *out
+) {
+	/* Odd start and length, for the unaligned head and tail */
+	k->convertU8ToF32(inputU8 + 1, out, MAX_SAMPLES - 3);
+}
+
+static void RunConvertS16(
+	const FAudioKernelTable *k,
+	const CheckCase *cc,
+	float *out
+) {
+	k->convertS16ToF32(inputS16 + 1, out, MAX_SAMPLES - 3);
+}
+
+static void RunDecodeMSADPCM(
+	const FAudioKernelTable *k,
+	const CheckCase *cc,
+	float *out
+) {
+	int16_t pcm[MSADPCM_LANES * 128];
+	const uint32_t channels = cc->srcChannels;
+	const uint32_t blocks = MSADPCM_LANES / channels;
+	uint32_t i;
+
+	/* Blocks are 128 frames, one after another like in a real buffer */
+	k->decodeMSADPCMBlocks(
+		(channels == 2) ? inputStereoMSADPCM : inputMonoMSADPCM,
+		pcm,
+		blocks,
+		70 * channels,
+		(uint16_t) channels
+	);
+	for (i = 0; i < MSADPCM_LANES * 128; i += 1)
+	{
+		out[i] = (float) pcm[i];
+	}
+}
+
+static FAudioResampleCallback GetResampler(
+	const FAudioKernelTable *k,
+	const char *name
+) {
+	if (SDL_strcmp(name, "resampleGeneric") == 0) return k->resampleGeneric;
+	if (SDL_strcmp(name, "resampleMono") == 0) return k->resampleMono;
+	if (SDL_strcmp(name, "resampleStereo") == 0) return k->resampleStereo;
+	if (SDL_strcmp(name, "resample6Channel") == 0) return k->resample6Channel;
+	if (SDL_strcmp(name, "resample8Channel") == 0) return k->resample8Channel;
+	if (SDL_strcmp(name, "resampleSincMono") == 0) return k->resampleSincMono;
+	return k->resampleSincGeneric;
+}
+
+static void RunResample(
+	const FAudioKernelTable *k,
+	const CheckCase *cc,
+	float *out
+) {
+	/* 32.32 fixed point, starting partway into a frame */
+	uint64_t offset = 0x40000000;
+	GetResampler(k, cc->name)(
+		inputF32,
+		out,
+		&offset,
+		(uint64_t) (cc->ratio * 4294967296.0),
+		FRAMES,
+		(uint8_t) cc->srcChannels
+	);
+}
+
+static void RunFilter(
+	const FAudioKernelTable *k,
+	const CheckCase *cc,
+	float *out
+) {
+	static float state[FILTER_STATE_SIZE(MAX_CHANNELS)];
+	FAudioFilterParameters filter;
+
+	filter.Type = cc->filterType;
+	filter.Frequency = 0.3f;
+	filter.OneOverQ = 0.7f;
+	SDL_memset(state, '\0', sizeof(state));
+	SDL_memcpy(out, inputF32, sizeof(float) * FRAMES * cc->srcChannels);
+	k->filterVoice(
+		&filter,
+		state,
+		out,
+		FRAMES,
+		(uint16_t) cc->srcChannels
+	);
+}
+
+static FAudioMixCallback GetMixer(
+	const FAudioKernelTable *k,
+	const CheckCase *cc
+) {
+	if (cc->srcChannels == 1 && cc->dstChannels == 2) return k->mixMonoToStereo;
+	if (cc->srcChannels == 1 && cc->dstChannels == 6) return k->mixMonoTo6Channel;
+	if (cc->srcChannels == 1 && cc->dstChannels == 8) return k->mixMonoTo8Channel;
+	if (cc->srcChannels == 2 && cc->dstChannels == 2) return k->mixStereoToStereo;
+	if (cc->srcChannels == 2 && cc->dstChannels == 6) return k->mixStereoTo6Channel;
+	if (cc->srcChannels == 2 && cc->dstChannels == 8) return k->mixStereoTo8Channel;
+	return k->mixGeneric;
+}
+
+static void RunMix(
+	const FAudioKernelTable *k,
+	const CheckCase *cc,
+	float *out
+) {
+	/* Sends add to what is already on the bus */
+	SDL_memcpy(out, inputF32 + 1, sizeof(float) * FRAMES * cc->dstChannels);
+	GetMixer(k, cc)(
+		FRAMES,
+		cc->srcChannels,
+		cc->dstChannels,
+		inputF32,
+		out,
+		inputCoefficients
+	);
+}
+
+static void RunApplyVolume(
+	const FAudioKernelTable *k,
+	const CheckCase *cc,
+	float *out
+) {
+	/* Odd length, for the tail */
+	SDL_memcpy(out, inputF32, sizeof(float) * (MAX_SAMPLES - 1));
+	k->applyVolume(out, MAX_SAMPLES - 1, 0.75f);
+}
+
+static const CheckCase cases[] =
+{
+	{ "convertU8ToF32",		RunConvertU8,		1, 1, 1.0 },
+	{ "convertS16ToF32",		RunConvertS16,		1, 1, 1.0 },
+	{ "decodeMSADPCMBlocks",	RunDecodeMSADPCM,	1, 1, 1.0 },
+	{ "decodeMSADPCMBlocks",	RunDecodeMSADPCM,	2, 2, 1.0 },
+	{ "resampleGeneric",		RunResample,		3, 3, 1.5 },
+	{ "resampleMono",		RunResample,		1, 1, 1.5 },
+	{ "resampleMono",		RunResample,		1, 1, 0.37 },
+	{ "resampleStereo",		RunResample,		2, 2, 1.5 },
+	{ "resampleStereo",		RunResample,		2, 2, 0.37 },
+	{ "resample6Channel",		RunResample,		6, 6, 1.5 },
+	{ "resample8Channel",		RunResample,		8, 8, 1.5 },
+	{ "resampleSincMono",		RunResample,		1, 1, 1.5 },
+	{ "resampleSincMono",		RunResample,		1, 1, 0.37 },
+	{ "resampleSincGeneric",	RunResample,		2, 2, 1.5 },
+	{ "resampleSincGeneric",	RunResample,		6, 6, 2.9 },
+	{ "filterVoice",		RunFilter,		1, 1, 1.0, FAudioLowPassFilter },
+	{ "filterVoice",		RunFilter,		2, 2, 1.0, FAudioBandPassFilter },
+	{ "filterVoice",		RunFilter,		6, 6, 1.0, FAudioHighPassFilter },
+	{ "filterVoice",		RunFilter,		8, 8, 1.0, FAudioNotchFilter },
+	{ "mixGeneric",			RunMix,			3, 5, 1.0 },
+	{ "mixMonoToStereo",		RunMix,			1, 2, 1.0 },
+	{ "mixMonoTo6Channel",		RunMix,			1, 6, 1.0 },
+	{ "mixMonoTo8Channel",		RunMix,			1, 8, 1.0 },
+	{ "mixStereoToStereo",		RunMix,			2, 2, 1.0 },
+	{ "mixStereoTo6Channel",	RunMix,			2, 6, 1.0 },
+	{ "mixStereoTo8Channel",	RunMix,			2, 8, 1.0 },
+	{ "applyVolume",		RunApplyVolume,		1, 1, 1.0 }
+};
+
+static void MakeMSADPCM(uint8_t *data, uint16_t channels)
+{
+	const uint32_t align = 70 * channels;
+	uint32_t i;
+	uint8_t *block;
+
+	for (i = 0; i < MSADPCM_LANES * 70; i += 1)
+	{
+		data[i] = (uint8_t) Noise();
+	}
+
+	/* Valid preambles: predictor < 7, sane delta */
+	for (i = 0; i < MSADPCM_LANES / channels; i += 1)
+	{
+		block = data + (i * align);
+		block[0] = (uint8_t) (i % 7);
+		if (channels == 2)
+		{
+			block[1] = (uint8_t) ((i + 3) % 7);
+			block[2] = 64;
+			block[3] = 0;
+			block[4] = 64;
+			block[5] = 0;
+		}
+		else
+		{
+			block[1] = 64;
+			block[2] = 0;
+		}
+	}
+}
+
+static const char *levelNames[] =
+{
+	"scalar",
+	"sse2",
+	"avx",
+	"avx2",
+	"neon"
+};
+
+static double TimeCase(
+	const FAudioKernelTable *k,
+	const CheckCase *cc,
+	float *out,
+	uint32_t iterations
+) {
+	uint64_t start;
+	uint32_t i;
+
+	start = SDL_GetPerformanceCounter();
+	for (i = 0; i < iterations; i += 1)
+	{
+		cc->run(k, cc, out);
+	}
+	return (
+		(double) (SDL_GetPerformanceCounter() - start) *
+		1000000000.0 /
+		(double) SDL_GetPerformanceFrequency() /
+		iterations
+	);
+}
+
+int main(int argc, char **argv)
+{
+	FAudio *audio;
+	FAudioKernelTable scalar, simd;
+	FAudioKernelLevel best, level;
+	float *expected, *actual;
+	double diff, maxDiff, scalarNs, simdNs;
+	uint32_t i, iterations, failures, j;
+	uint8_t mismatch;
+
+	iterations = (argc > 1) ? SDL_atoi(argv[1]) : 1000;
+
+	/* The engine picks the best level the build and CPU can do */
+	FAudioCreate(&audio, FAUDIO_PULL_MODE, FAUDIO_DEFAULT_PROCESSOR);
+	best = FAudio_INTERNAL_Kernels.level;
+	FAudio_INTERNAL_FillKernelTable(&scalar, FAUDIO_KERNEL_SCALAR);
+
+	for (i = 0; i < MAX_SAMPLES; i += 1)
+	{
+		inputU8[i] = (uint8_t) Noise();
+		inputS16[i] = (int16_t) Noise();
+	}
+	for (i = 0; i < SDL_arraysize(inputF32); i += 1)
+	{
+		inputF32[i] = NoiseFloat();
+	}
+	for (i = 0; i < SDL_arraysize(inputCoefficients); i += 1)
+	{
+		inputCoefficients[i] = NoiseFloat();
+	}
+
+	MakeMSADPCM(inputMonoMSADPCM, 1);
+	MakeMSADPCM(inputStereoMSADPCM, 2);
+
+	expected = (float*) SDL_malloc(sizeof(float) * OUTPUT_SIZE);
+	actual = (float*) SDL_malloc(sizeof(float) * OUTPUT_SIZE);
+
+	printf(
+		"kernel,src_channels,dst_channels,ratio,level,"
+		"max_diff,scalar_ns,simd_ns,speedup\n"
+	);
+	failures = 0;
+	for (level = FAUDIO_KERNEL_SSE2; level <= FAUDIO_KERNEL_NEON; level += 1)
+	{
+		/* x86 levels build on each other, NEON stands alone */
+		if (	(best == FAUDIO_KERNEL_NEON && level != FAUDIO_KERNEL_NEON) ||
+			(best != FAUDIO_KERNEL_NEON && level > best)	)
+		{
+			continue;
+		}
+		FAudio_INTERNAL_FillKernelTable(&simd, level);
+
+		for (i = 0; i < SDL_arraysize(cases); i += 1)
+		{
+			SDL_memset(expected, '\0', sizeof(float) * OUTPUT_SIZE);
+			SDL_memset(actual, '\0', sizeof(float) * OUTPUT_SIZE);
+			cases[i].run(&scalar, &cases[i], expected);
+			cases[i].run(&simd, &cases[i], actual);
+
+			maxDiff = 0.0;
+			mismatch = 0;
+			for (j = 0; j < OUTPUT_SIZE; j += 1)
+			{
+				if (expected[j] != actual[j])
+				{
+					diff = SDL_fabs(expected[j] - actual[j]);
+					maxDiff = SDL_max(diff, maxDiff);
+					mismatch = 1;
+				}
+			}
+			failures += mismatch;
+
+			scalarNs = TimeCase(&scalar, &cases[i], expected, iterations);
+			simdNs = TimeCase(&simd, &cases[i], actual, iterations);
+			printf(
+				"%s,%u,%u,%.2f,%s,%g,%.1f,%.1f,%.2f\n",
+				cases[i].name,
+				cases[i].srcChannels,
+				cases[i].dstChannels,
+				cases[i].ratio,
+				levelNames[level],
+				maxDiff,
+				scalarNs,
+				simdNs,
+				scalarNs / simdNs
+			);
+			fflush(stdout);
+		}
+	}
+
+	SDL_free(expected);
+	SDL_free(actual);
+	FAudio_Release(audio);
+
+	if (failures > 0)
+	{
+		fprintf(stderr, "SIMD output differs from scalar!\n");
+		return 1;
+	}
+	return 0;
+}